@@ -1,7 +1,7 @@
 /** @file
  *
- * Declares template class BasicNode, which provides a Message-passing utility for IP protocols
- * based on Boost.Asio.
+ * Declares template class BasicNode, which provides a Message-passing utility for IP and
+ * UNIX-domain protocols based on Boost.Asio.
  *
  * See the note on BasicNode for instantiation information.
  */
@@ -9,37 +9,68 @@
 #define crisp_comms_BasicNode_hh 1
 
 
+#include <crisp/comms/CompactControl.hh>
 #include <crisp/comms/Configuration.hh>
+#include <crisp/comms/ConfigurationDiskCache.hh>
 #include <crisp/comms/Message.hh>
 #include <crisp/comms/MessageDispatcher.hh>
+#include <crisp/comms/NodeMetrics.hh>
+#include <crisp/comms/OutgoingQueue.hh>
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/SensorHistory.hh>
+#include <crisp/comms/SensorPoll.hh>
 #include <crisp/comms/common.hh>
 
 #include <crisp/util/Scheduler.hh>
 #include <crisp/util/WorkerObject.hh>
-#include <crisp/util/SharedQueue.hh>
 #include <crisp/util/Signal.hh>
 
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/spawn.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/ip/tcp.hpp>
-
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace crisp
 {
   namespace comms
   {
+    namespace detail
+    {
+      struct StampedPrefix;
+    }
 
-    /** Basic Message node for use with Boost.Asio and IP-based protocols.
+    /** Basic Message node for use with Boost.Asio and IP-based or UNIX-domain protocols.
      *
      * @note By default, this template's implementation header is not included;
      * `extern template` declarations are used instead to reduce compile
-     * overhead.  If you need a BasicNode instantiation that does *not* match
-     * `BasicNode<boost::asio::ip::tcp>`, you must
+     * overhead.  If you need a BasicNode instantiation other than
+     * `BasicNode<boost::asio::ip::tcp>`, `BasicNode<boost::asio::ip::udp>`, or (where
+     * supported) `BasicNode<boost::asio::local::stream_protocol>`, you must
      *
      *    #include <crisp/comms/bits/BasicNode.tcc>
      *
      * prior to the place of instantiation.
+     *
+     * Nodes for datagram protocols (e.g. `BasicNode<boost::asio::ip::udp>`) pack as many
+     * queued messages as fit into each datagram, and drop any MODULE_CONTROL message that
+     * arrives in a datagram older than one already received.  Handshake and configuration
+     * messages are instead sent over a small reliable channel, one at a time, and are
+     * retransmitted until the remote node acknowledges them.  Every datagram carries a session
+     * ID that its sender picks when it launches, so that when the remote node restarts, this
+     * one forgets the sequence numbers it had seen from it.
      */
     template < typename _Protocol >
     class BasicNode : protected crisp::util::WorkerObject
@@ -49,6 +80,30 @@ namespace crisp
       typedef typename Protocol::socket Socket;
       typedef crisp::util::Signal<void(const BasicNode&)> DisconnectSignal;
 
+      /** Whether the node's protocol is datagram-oriented (e.g. UDP) rather than
+          stream-oriented (e.g. TCP).  */
+      static constexpr bool UsesDatagrams =
+        std::is_same<Socket, boost::asio::basic_datagram_socket<Protocol> >::value;
+
+      /** Parameters controlling how queued outgoing messages are coalesced into a single
+       * gathered write.
+       */
+      struct BatchingParameters
+      {
+        /** Maximum number of messages per write.  A value of 1 disables coalescing. */
+        size_t max_messages;
+
+        /** Number of bytes after which no more messages are added to a write.  A single message
+            larger than this is still sent in one piece. */
+        size_t max_bytes;
+
+        /** Longest time the send loop may hold back an incomplete batch waiting for more
+            messages to arrive.  When zero (the default), a write is issued as soon as the
+            queue is empty, so batching only happens when messages are produced faster than
+            they can be written.  */
+        std::chrono::microseconds max_delay;
+      };
+
     private:
       friend class MessageDispatcher<BasicNode>;
       /** Connected socket used for communication. */
@@ -63,8 +118,24 @@ namespace crisp
        */
       std::weak_ptr<crisp::util::ScheduledAction> m_halt_action;
 
-      crisp::util::SharedQueue<Message>
-        m_outgoing_queue;         /**< Outgoing message queue. */
+      OutgoingQueue m_outgoing_queue; /**< Outgoing message queue. */
+
+      /** Strand on which the send loop runs.  Wake-ups are posted here, so that they can't
+          slip in between the send loop finding the outgoing queue empty and starting to wait
+          for more messages.  */
+      boost::asio::io_service::strand m_send_strand;
+
+      /** Outgoing-message coalescing parameters.  Read and written on `m_send_strand` only;
+          see `set_batching`.  */
+      BatchingParameters m_batching;
+
+      /** Timer on which the send loop waits (indefinitely) when the outgoing queue is empty.
+          It's woken by cancelling the wait.  */
+      boost::asio::steady_timer m_send_wake_timer;
+
+      /** Set by the send loop just before it waits on `m_send_wake_timer`, and cleared by
+          whichever thread takes responsibility for waking it.  */
+      std::atomic<bool> m_send_waiting;
 
       /** Whether the node's `halt` method has been called. */
       std::atomic_flag m_halting;
@@ -83,6 +154,98 @@ namespace crisp
           emitting it twice (send AND receive loops can both trigger a halt).  */
       std::atomic_flag m_disconnect_emitted;
 
+      /** @name Reliable-channel state (datagram protocols only)
+       *
+       * The receive loop records acknowledgements, and acknowledgements it owes the remote
+       * node, here; the send loop acts on them.
+       *
+       * @{
+       */
+      std::atomic<uint32_t> m_reliable_acked;     /**< Highest sequence number acknowledged by the remote node. */
+      std::atomic<uint32_t> m_reliable_ack_due;   /**< Sequence number to acknowledge to the remote node. */
+      std::atomic<bool> m_reliable_ack_pending;   /**< Whether `m_reliable_ack_due` has yet to be sent. */
+      /**@}*/
+
+      /** @name Control-staleness state (datagram protocols only)
+       *
+       * For each module ID, the sequence number of the newest DATA datagram from which a
+       * MODULE_CONTROL message for that module was delivered.  Cleared when a new session
+       * starts.  Receive loop only.
+       *
+       * @{
+       */
+      uint32_t m_control_sequence[256];
+      std::bitset<256> m_control_received; /**< Module IDs with an entry in `m_control_sequence`. */
+      /**@}*/
+
+      /** Number of received MODULE_CONTROL messages dropped as stale (datagram protocols only). */
+      std::atomic<size_t> m_num_stale_dropped;
+
+      /** Traffic counters and gauges; see `get_metrics`. */
+      NodeMetrics m_metrics;
+
+      /** Handle to the scheduled periodic action that prints the node's metrics, if any. */
+      std::weak_ptr<crisp::util::PeriodicAction> m_metrics_dump_action;
+
+      /** @name Message-stamping state
+       *
+       * See `request_message_stamps`.
+       *
+       * @{
+       */
+      bool m_stamps_requested;          /**< Whether the local node asks for stamps. */
+      std::atomic<bool> m_stamping;     /**< Whether outgoing messages are being stamped. */
+      uint32_t m_stamp_sequence[MESSAGE_TYPE_COUNT]; /**< Last sequence number sent, by type
+                                                          (send loop only). */
+      /**@}*/
+
+      /** @name Compact-control state
+       *
+       * See `request_compact_control`.
+       *
+       * @{
+       */
+      bool m_compact_requested;         /**< Whether the local node asks for compact controls. */
+      std::atomic<bool> m_compacting;   /**< Whether outgoing controls are being compacted. */
+      CompactControlCodec m_compact_encoder; /**< Send loop only. */
+      CompactControlCodec m_compact_decoder; /**< Receive loop only. */
+
+      /** Copy of the configuration used to compact and expand controls, so that the send and
+          receive loops never read `configuration` while user code replaces it.  Accessed
+          with `std::atomic_load` and `std::atomic_store`.  */
+      std::shared_ptr<const Configuration> m_compact_configuration;
+      /**@}*/
+
+      /** @name Configuration-fetching state
+       *
+       * See `request_configuration`.
+       *
+       * @{
+       */
+      std::unique_ptr<ConfigurationDiskCache> m_configuration_cache; /**< On-disk cache, if any. */
+      std::atomic<uint64_t> m_remote_configuration_digest; /**< From the remote handshake. */
+      std::atomic<bool> m_remote_handshake_received;
+      std::atomic<bool> m_configuration_requested; /**< Whether `request_configuration` has been
+                                                        called, but not yet acted on.  */
+      /**@}*/
+
+      /** Sensors polled at a single interval, and the action that polls them. */
+      struct PollGroup
+      {
+        SensorPoll poll;
+        std::weak_ptr<crisp::util::PeriodicAction> action;
+      };
+
+      /** @name Sensor-polling state
+       *
+       * See `poll_sensor`.
+       *
+       * @{
+       */
+      std::mutex m_poll_mutex;
+      std::map<crisp::util::Scheduler::Slot::Duration, PollGroup> m_poll_groups; /**< By interval. */
+      /**@}*/
+
     public:
       /** Public "node-is-halting-or-stopped" flag. */
       const std::atomic<bool>& stopped;
@@ -100,13 +263,23 @@ namespace crisp
        *     declared by the connected slave node, once it has been received.
        *
        *   * When `role` is `NodeRole::SLAVE`, this contains the local interface
-       *     configuration.
+       *     configuration.  Replies to configuration queries are cached (see
+       *     `MessageDispatcher::configuration_cache`), so install a different configuration
+       *     with `set_configuration`, or call `dispatcher.configuration_cache.invalidate()`
+       *     after changing this one in place.
+       *
+       * Compact controls (see `request_compact_control`) are converted using a copy of this
+       * object, so the send and receive loops never read it after `launch`.
        */
       Configuration configuration;
 
       /** Message dispatcher and user-set callbacks container.  Provides  */
       MessageDispatcher<BasicNode> dispatcher;
 
+      /** Pool from which the node allocates message buffers, both for received messages and
+          for messages constructed by `send`.  May be shared between nodes.  */
+      const crisp::util::RefTraits<crisp::util::BufferPool>::stored_ref buffer_pool;
+
 
       /** Initialize a node using the given socket and role.
        *
@@ -115,8 +288,16 @@ namespace crisp
        *
        * @param _role Role to request when performing the initial handshake with the remote
        *     node.
+       *
+       * @param _buffer_pool Buffer pool to use.  If null (the default), the node creates a
+       *     pool of its own.
+       *
+       * @param _num_worker_threads Number of threads to launch to service the node's socket,
+       *     timers and asynchronously-dispatched message handlers.
        */
-      BasicNode(Socket&& _socket, NodeRole _role);
+      BasicNode(Socket&& _socket, NodeRole _role,
+                crisp::util::RefTraits<crisp::util::BufferPool>::stored_ref _buffer_pool = nullptr,
+                size_t _num_worker_threads = NODE_DEFAULT_WORKER_THREADS);
 
       virtual ~BasicNode();
 
@@ -146,7 +327,10 @@ namespace crisp
 
 
       /** Enqueue an outgoing message.  The message will be sent once all previously-queued outgoing
-       * messages have been sent.
+       * messages have been sent, unless its type uses `QueuePolicy::LATEST_VALUE` (see
+       * `set_queue_policy`), in which case it may replace an unsent message in the queue.
+       *
+       * This method never blocks, and may be called from any thread.
        *
        * @param m Message to send.
        */
@@ -160,6 +344,212 @@ namespace crisp
        */
       void send(Message&& m);
 
+      /** Encode a message-body object (Handshake, ModuleControl, etc.) into a message, using a
+       * body buffer from the node's buffer pool, and enqueue it for sending.
+       *
+       * @param body Message body to send.
+       */
+      template < typename _T,
+                 typename _U = typename std::remove_cv<typename std::remove_reference<_T>::type>::type,
+                 typename _Enable = typename std::enable_if<std::is_class<_U>::value &&
+                                                          !std::is_same<_U, Message>::value>::type >
+      inline void
+      send(_T&& body)
+      {
+        EncodeResult result ( EncodeResult::SUCCESS );
+        Message m ( std::forward<_T>(body), buffer_pool.get(), &result );
+        if ( result != EncodeResult::SUCCESS )
+          {
+            m_metrics.record_encode_error();
+            fprintf(stderr, "[0x%x][Node] Failed to encode %s message: %s\n", THREAD_ID,
+                    detail::get_type_info(m.header.type).name, encode_result_to_string(result));
+            return;
+          }
+        send(std::move(m));
+      }
+
+      /** Replace the node's interface configuration, discard the cached reply to
+          configuration queries, and reconfigure the sensor history if one is kept.  See
+          `configuration`.  */
+      inline void
+      set_configuration(const Configuration& config)
+      { configuration = config;
+        dispatcher.configuration_cache.invalidate();
+        if ( dispatcher.sensor_history )
+          dispatcher.sensor_history->configure(configuration); }
+
+      /** Set the parameters used to coalesce outgoing messages into gathered writes.  The
+       * change is made on the send loop's strand, so it takes effect at the start of a later
+       * batch, never part-way through one.  By default, writes carry up to 16 messages or 16
+       * KiB and are never held back.
+       *
+       * @param parameters New coalescing parameters.
+       */
+      inline void
+      set_batching(const BatchingParameters& parameters)
+      { m_send_strand.post([this, parameters]() { m_batching = parameters; }); }
+
+      /** Set the queueing policy used for outgoing messages of a given type.  By default,
+       * MODULE_CONTROL messages use `QueuePolicy::LATEST_VALUE` -- so that over a slow link,
+       * the remote node receives the most recent control values instead of a backlog of stale
+       * ones -- and all other types use `QueuePolicy::FIFO`.
+       *
+       * @param type Message type to set the policy for.
+       *
+       * @param policy Policy to use for messages of type @p type sent from now on.
+       */
+      inline void
+      set_queue_policy(MessageType type, QueuePolicy policy)
+      { m_outgoing_queue.set_policy(type, policy); }
+
+      /** Get the queueing policy used for outgoing messages of a given type. */
+      inline QueuePolicy
+      get_queue_policy(MessageType type) const
+      { return m_outgoing_queue.get_policy(type); }
+
+      /** Get the number of outgoing messages that were dropped, unsent, because a newer
+          message replaced them under the `QueuePolicy::LATEST_VALUE` policy.  */
+      inline size_t
+      get_num_coalesced() const
+      { return m_outgoing_queue.get_num_coalesced(); }
+
+      /** Get the number of received MODULE_CONTROL messages that were dropped because a newer
+          one for the same module had already arrived.  Always zero for stream protocols.  */
+      inline size_t
+      get_num_stale_dropped() const
+      { return m_num_stale_dropped.load(std::memory_order_relaxed); }
+
+      /** Ask for messages between this node and the remote node to be stamped with per-type
+       * sequence numbers, send times, and the time they spent in the sender's outgoing queue
+       * (see `Message::Stamp`), so that each node's metrics show the link's loss, reordering
+       * and latency separately from queueing delay.
+       *
+       * The request is made in the node's handshake, so this must be called before `launch`.
+       * Stamping starts, in each direction, once the sending node has received the other's
+       * handshake, and only if both nodes asked for it.  SYNC messages are never stamped, and
+       * on datagram protocols neither are messages sent on the reliable channel.
+       *
+       * @param enable Whether to ask for stamps.
+       */
+      inline void
+      request_message_stamps(bool enable = true)
+      { m_stamps_requested = enable; }
+
+      /** Check whether outgoing messages are being stamped.  See `request_message_stamps`. */
+      inline bool
+      message_stamps_active() const
+      { return m_stamping.load(std::memory_order_relaxed); }
+
+      /** Ask for MODULE_CONTROL messages between this node and the remote node to be sent in
+       * compact form (MODULE_CONTROL_COMPACT; see `CompactControlCodec`).  Conversion happens
+       * as messages are written and read, so dispatchers and handlers only ever see plain
+       * MODULE_CONTROL messages -- though the metrics count messages by their type on the wire.
+       *
+       * Over stream protocols, controls are delta-encoded against the last values sent for
+       * each input, with periodic keyframes; controls that arrive after a corrupt message,
+       * before the next keyframe, are dropped rather than expanded against the wrong values.
+       * Over datagram protocols, where messages may be lost or reordered, each is encoded on
+       * its own.  As with `request_message_stamps`, this must be called before
+       * `launch`, and takes effect in each direction once the sending node has received the
+       * other's handshake -- and only if both nodes asked for it.
+       *
+       * Controls are converted using a copy of `configuration` taken at `launch`, and replaced
+       * by each configuration response received from the remote node; later changes made
+       * directly to `configuration` are not seen by the conversion.
+       *
+       * @param enable Whether to ask for compact controls.
+       */
+      inline void
+      request_compact_control(bool enable = true)
+      { m_compact_requested = enable; }
+
+      /** Check whether outgoing MODULE_CONTROL messages are being compacted.  See
+          `request_compact_control`.  */
+      inline bool
+      compact_control_active() const
+      { return m_compacting.load(std::memory_order_relaxed); }
+
+      /** Keep the configurations received from slave nodes in an on-disk cache, keyed by their
+       * digests, so that `request_configuration` can use a cached copy instead of querying the
+       * slave for it.  Call before `launch`.
+       *
+       * @param directory Directory in which to keep the cached configurations.
+       */
+      void
+      use_configuration_cache(const std::string& directory);
+
+      /** Fetch the remote node's interface configuration.  The configuration is delivered via
+       * `dispatcher.configuration_response.received`, as if the remote node had sent it.
+       *
+       * If a configuration cache is in use (see `use_configuration_cache`) and holds the
+       * configuration whose digest the remote node announced in its handshake, the cached
+       * copy is loaded; otherwise a CONFIGURATION_QUERY is sent.  If the remote node's
+       * handshake hasn't arrived yet, the request is acted on when it does.
+       */
+      void
+      request_configuration();
+
+      /** Record the readings in received SENSOR_DATA messages in a SensorHistory, so that
+       * consumers can query recent readings (and summaries of older ones) without keeping
+       * their own copies.  Readings are recorded by the receive loop as the messages are
+       * dispatched, from the same decoded batch passed to the `dispatcher.sensor_data`
+       * handlers (see `MessageDispatcher::sensor_history`).  Only sensors in a known
+       * configuration are recorded: `configuration` as it stands when this is called, and
+       * thereafter any configuration received from the remote node or installed with
+       * `set_configuration`.  Call before `launch`.
+       *
+       * @param capacity Number of entries to keep for each sensor, at each resolution.
+       */
+      void
+      keep_sensor_history(size_t capacity = SensorHistory::DefaultCapacity);
+
+      /** Get the store of received sensor readings, or null if `keep_sensor_history` hasn't
+          been called.  */
+      inline std::shared_ptr<const SensorHistory>
+      get_sensor_history() const
+      { return dispatcher.sensor_history; }
+
+      /** Poll a sensor on the remote node at regular intervals, replacing any interval
+       * previously set for it.  Sensors polled at the same interval are polled together, with
+       * a single SENSOR_POLL message (see `SensorPoll`), and the readings arrive as
+       * SENSOR_DATA.
+       *
+       * @param module_id ID of the module to which the sensor belongs.
+       *
+       * @param sensor_id ID of the sensor within its module.
+       *
+       * @param interval Interval at which to poll the sensor.
+       */
+      void
+      poll_sensor(uint8_t module_id, uint16_t sensor_id,
+                  crisp::util::Scheduler::Slot::Duration interval);
+
+      /** Stop polling a sensor.  See `poll_sensor`. */
+      void
+      stop_polling(uint8_t module_id, uint16_t sensor_id);
+
+      /** Take a snapshot of the node's traffic metrics: message and byte counts by type and
+       * direction, receive-error counts, the depth of the outgoing queue, and link statistics
+       * for stamped messages.  Never blocks.
+       */
+      inline NodeMetrics::Snapshot
+      get_metrics() const
+      { return m_metrics.snapshot(); }
+
+      /** Reset the node's metrics counters to zero. */
+      inline void
+      reset_metrics()
+      { m_metrics.reset(); }
+
+      /** Print the node's metrics at regular intervals, using `scheduler`.  Replaces any
+       * previously-requested dump.
+       *
+       * @param interval Interval between dumps.  Zero stops dumping.
+       *
+       * @param stream Stream to which to print.
+       */
+      void dump_metrics(std::chrono::milliseconds interval, FILE* stream = stderr);
+
       /** Register a function to be called when the connection ends.
        *
        * @param func The function to be called when the connection ends.
@@ -168,6 +558,9 @@ namespace crisp
       on_disconnect(typename DisconnectSignal::Function func);
 
     protected:
+      /** Wake the send loop if it's waiting for outgoing messages. */
+      void wake_send_loop();
+
       /** Send outgoing messages until the socket is closed.
        *
        * @param yield A Boost.Asio `yield_context`, used to enable resuming of this method from
@@ -175,20 +568,138 @@ namespace crisp
        */
       void send_loop(boost::asio::yield_context yield);
 
+      /** Send-loop implementation for stream protocols. */
+      void stream_send_loop(boost::asio::yield_context yield);
 
-      /** Read data from the socket until we find a valid sync message. */
-      bool resync(boost::asio::yield_context& yield);
+      /** Send-loop implementation for datagram protocols. */
+      void datagram_send_loop(boost::asio::yield_context yield);
 
 
-      /** Read incoming messages and insert them into the incoming-message queue.
+      /** Fill in the stamped header for an outgoing message, if it should be stamped.  Send
+       * loop only.
+       *
+       * @param m Message to be sent.
+       *
+       * @param prefix Header and stamp to send in place of @p m's header.
+       *
+       * @param now Current time, in microseconds of the steady clock.
+       *
+       * @return `true` if @p m should be sent stamped, or `false` if it should be sent as-is.
+       */
+      bool stamp(const Message& m, detail::StampedPrefix& prefix, uint64_t now);
+
+      /** Append an outgoing message's encoded form to a gather list, compacting and stamping
+       * it as negotiated with the remote node.  Send loop only.
+       *
+       * @param m Message to be sent.
+       *
+       * @param compacted Receives the compact form of @p m, if that's what is sent.
+       *
+       * @param prefix Receives the stamped header sent in place of the message's own, if it's
+       *     sent stamped; left untouched otherwise.
+       *
+       * @param buffers Gather list to which to append.
+       *
+       * @param stamping Whether to stamp the message.
+       *
+       * @param now Current time, in microseconds of the steady clock, if @p stamping is set.
+       *
+       * @param compact_config Configuration with which to compact the message if it is a
+       *     module control, or `nullptr` if controls are not being compacted.
+       */
+      void gather(const Message& m, Message& compacted, detail::StampedPrefix& prefix,
+                  std::vector<boost::asio::const_buffer>& buffers, bool stamping, uint64_t now,
+                  const Configuration* compact_config);
+
+      /** Fetch the remote node's configuration from the cache, or by querying for it.  See
+          `request_configuration`.  */
+      void fetch_configuration();
+
+      /** Store a received configuration in the configuration cache, if one is in use, and
+          pass it to `use_remote_configuration`.  */
+      void handle_configuration_response(const Message& m);
+
+      /** Decode the configuration in a configuration response, and publish it as the
+          dispatcher's `remote_configuration` (against which sensor data is decoded), to convert
+          compact controls (if they were asked for), and to make the sensor history's series
+          (if one is kept).  */
+      void use_remote_configuration(const Message& m);
+
+      /** Remove a sensor from whichever poll group it is in.  Call with `m_poll_mutex` held. */
+      void remove_from_poll_groups(uint8_t module_id, uint16_t sensor_id);
+
+      /** Convert a received MODULE_CONTROL_COMPACT message to MODULE_CONTROL form, in place.
+       * Receive loop only.
+       *
+       * @return `true` on success, or `false` (having counted a decode error) if the message
+       *     should be dropped.
+       */
+      bool expand_compact(Message& m);
+
+      /** Check a received handshake for the remote node's features, and start stamping and
+       * compacting outgoing messages as both nodes asked.  Receive loop only.
+       *
+       * @return `true` on success, or `false` (having counted a decode error) if the handshake
+       *     is too short to decode and should be dropped.
+       */
+      bool handle_remote_handshake(const Message& m);
+
+      /** Search received data, in place, for a sync message, discarding everything before it.
+       *
+       * @param buf Receive buffer.
+       *
+       * @param begin Offset of the first unparsed byte in @p buf.  On success, this is advanced
+       *     to just past the sync message; otherwise, to the last few bytes (which may be the
+       *     start of a sync message).
+       *
+       * @param end Offset just past the last received byte in @p buf.
+       *
+       * @param discarded Receives the number of bytes skipped, not counting the sync message
+       *     itself.
+       *
+       * @return `true` if a sync message was found.
+       */
+      static bool resync(const crisp::util::Buffer& buf, size_t& begin, size_t end,
+                         size_t& discarded);
+
+
+      /** Read incoming messages and dispatch them.  Each read takes as much data as the socket
+       * has available, and every complete message received is dispatched with its body
+       * referencing the receive buffer in place.
        *
        * @param yield A Boost.Asio `yield_context`, used to enable resuming of this method from
        *     asynchronous IO-completion handlers.
        */
       void receive_loop(boost::asio::yield_context yield);
+
+      /** Receive-loop implementation for stream protocols. */
+      void stream_receive_loop(boost::asio::yield_context yield);
+
+      /** Receive-loop implementation for datagram protocols. */
+      void datagram_receive_loop(boost::asio::yield_context yield);
+
+      /** Validate, and dispatch or drop, the messages packed in a received datagram.
+       *
+       * @param rdbuf Buffer holding the datagram.
+       *
+       * @param begin Offset of the first message in @p rdbuf.
+       *
+       * @param end Offset just past the end of the datagram.
+       *
+       * @param data Whether the datagram is a DATA datagram, whose MODULE_CONTROL messages are
+       *     dropped if a newer DATA datagram has already delivered one for the same module.
+       *
+       * @param sequence Sequence number of the datagram.
+       */
+      void dispatch_datagram(const boost::intrusive_ptr<crisp::util::Buffer>& rdbuf,
+                             size_t begin, size_t end, bool data, uint32_t sequence);
     };
 
     extern template class BasicNode<boost::asio::ip::tcp>;
+    extern template class BasicNode<boost::asio::ip::udp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    extern template class BasicNode<boost::asio::local::stream_protocol>;
+#endif
   }
 }
 
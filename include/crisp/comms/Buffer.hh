@@ -4,6 +4,7 @@
 #include <cstring>
 #include <cstdlib>
 #include <crisp/util/Buffer.hh>
+#include <crisp/util/BufferPool.hh>
 #include <crisp/comms/common.hh>
 
 namespace crisp
@@ -122,6 +123,15 @@ namespace crisp
       { offset = _offset; }
 
       MemoryEncodeBuffer(size_t size);
+
+      /** Construct an encode buffer with a scratch buffer taken from a pool.
+       *
+       * @param size Required buffer size.
+       *
+       * @param pool Pool from which to allocate the buffer.
+       */
+      MemoryEncodeBuffer(size_t size, crisp::util::BufferPool& pool);
+
       MemoryEncodeBuffer(Buffer* b);
       MemoryEncodeBuffer(char*& use_data, const size_t& use_length);
       virtual ~MemoryEncodeBuffer();
@@ -0,0 +1,124 @@
+/** @file
+ *
+ * Declares CompactControlCodec, which converts MODULE_CONTROL messages to and from the
+ * bandwidth-saving MODULE_CONTROL_COMPACT form.
+ */
+#ifndef crisp_comms_CompactControl_hh
+#define crisp_comms_CompactControl_hh 1
+
+#include <cstdint>
+#include <vector>
+
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/config.h>
+
+namespace crisp
+{
+  namespace comms
+  {
+    struct Configuration;
+
+    /** Encoder/decoder for the compact form of MODULE_CONTROL messages.
+     *
+     * A MODULE_CONTROL_COMPACT message body holds
+     *
+     *   - a flags byte (`FLAG_DELTA`, or zero),
+     *   - the module ID,
+     *   - the control's `input_ids` bit-field, as a varint,
+     *   - in delta mode only, a varint bit-field of the inputs whose values follow, and
+     *   - the values, in input-ID order: integer and boolean values as (zig-zag, where
+     *     signed) varints, and floating-point values as-is.
+     *
+     * In delta mode, an input whose value hasn't changed since the last message encoded for it
+     * is omitted (the decoder restores it), and integer values are sent as the difference from
+     * the last one.  Both ends update their last values from every compact message -- delta or
+     * not -- that they encode or decode, so delta mode is only used over stream protocols,
+     * where every message the encoder produces reaches the decoder in order.
+     *
+     * A delta message may only refer to inputs whose values the encoder has sent in full
+     * since its last keyframe, and the encoder starts a new keyframe for each module every
+     * `KeyframeInterval` messages (the next message for the module is then sent in full, as
+     * is the first to touch each of its inputs).  The decoder rejects delta messages that
+     * refer to inputs it hasn't been sent in full since it was last `reset` -- as it must be
+     * whenever messages may have been lost, e.g. after the stream is resynchronized -- so a
+     * lost message can't leave the two ends disagreeing for longer than a keyframe interval.
+     *
+     * Each direction of a connection needs its own codec, used by one thread at a time: the
+     * sending node's send loop encodes, and the receiving node's receive loop decodes.
+     * Controls with array, string, or wider-than-64-bit inputs are not compacted.
+     */
+    class CompactControlCodec
+    {
+    public:
+      /** Flag indicating that a compact body is delta-encoded. */
+      static constexpr uint8_t FLAG_DELTA = 1 << 0;
+
+      /** Number of compact messages the encoder sends for a module between keyframes. */
+      static constexpr uint16_t KeyframeInterval = 64;
+
+      CompactControlCodec();
+
+      /** Convert a MODULE_CONTROL message to compact form.
+       *
+       * @param in Message to convert.
+       *
+       * @param config Configuration describing the message's target module.
+       *
+       * @param delta Whether the message may be delta-encoded.
+       *
+       * @param pool Pool from which to allocate the compact body, if any.
+       *
+       * @param out Receives the compact message, on success.
+       *
+       * @return `true` if @p in was converted, or `false` if it must be sent as-is.
+       */
+      bool compact(const Message& in, const Configuration& config, bool delta,
+                   crisp::util::BufferPool* pool, Message& out);
+
+      /** Convert a MODULE_CONTROL_COMPACT message back to MODULE_CONTROL form.
+       *
+       * @param in Message to convert.
+       *
+       * @param config Configuration describing the message's target module.
+       *
+       * @param pool Pool from which to allocate the expanded body, if any.
+       *
+       * @param out Receives the expanded message, on success.
+       *
+       * @return `true` on success, or `false` if @p in is malformed, doesn't match
+       *     @p config, or is a delta from values this codec doesn't know.
+       */
+      bool expand(const Message& in, const Configuration& config,
+                  crisp::util::BufferPool* pool, Message& out);
+
+      /** Forget all previously-seen values, e.g. on reconnection or after messages may have
+          been lost.  */
+      void reset();
+
+    private:
+      /** Codec state for a single module. */
+      struct ModuleState
+      {
+        /** Last values by input ID.  Integer values are kept sign-extended, and
+            floating-point values as their bit patterns.  */
+        std::vector<uint64_t> last;
+
+        /** Inputs whose last values are shared with the other end: on the encoder, those
+            sent in full since the last keyframe; on the decoder, those received in full
+            since the last reset.  */
+        uint16_t known;
+
+        /** Messages encoded since the last keyframe (encoder only). */
+        uint16_t since_keyframe;
+      };
+
+      /** Find a module's state, creating it (with zero values, and none known) if
+          necessary.  */
+      ModuleState& module_state(uint8_t module_id);
+
+      std::vector<ModuleState> m_modules; /**< State by module ID. */
+    };
+  }
+}
+
+#endif  /* crisp_comms_CompactControl_hh */
@@ -21,6 +21,29 @@ namespace crisp
 {
   namespace comms
   {
+    /** Kinds of configuration item that can be found by name. */
+    ENUM_CLASS(NameKind, uint8_t,
+	       NONE,
+	       MODULE,
+	       INPUT,
+	       SENSOR);
+
+    /** Handle to a module, or to an input or sensor of a module, found by name.  Handles hold
+     * IDs rather than pointers, so they remain valid when the configuration is copied, moved, or
+     * decoded again from the same slave; use `Configuration::get_module`, `get_input` and
+     * `get_sensor` to resolve them.
+     */
+    struct __attribute__ (( packed, align(1) ))
+    NameHandle
+    {
+      NameKind kind;		/**< Kind of item referred to, or `NameKind::NONE` if not found. */
+      uint8_t module_id;	/**< ID of the module, or of the module containing the item. */
+      uint8_t item_id;		/**< ID of the input or sensor within its module. */
+
+      inline explicit operator bool() const
+      { return kind != NameKind::NONE; }
+    };
+
     struct __attribute__ (( packed, align(1) ))
     Configuration
     {
@@ -66,6 +89,7 @@ namespace crisp
       inline Module&
       add_module(_Args... args)
       { 
+        name_index.clear();
         ++num_modules;
         Module& out ( modules.emplace(args...) );
         out.id = next_module_id++;
@@ -83,11 +107,76 @@ namespace crisp
 #endif
       crisp::util::SArray<Module> modules;
 
+      /** Build the index used to find modules, inputs and sensors by name.  Called by `decode`;
+       * a configuration built with `add_module` should call it once all modules, inputs and
+       * sensors have been added.  Until then, lookups by name search the configuration
+       * linearly -- as they do again if inputs or sensors are added afterwards, until it is
+       * called again.  Renaming an item also calls for a new index.
+       */
+      void build_index();
+
+      /** Find a module by name.
+       *
+       * @return Handle to the module, which converts to `false` if there is no such module.
+       */
+      NameHandle
+      find_module(const char* module_name) const;
+
+      /** Find an input by its name and that of its module. */
+      NameHandle
+      find_input(const char* module_name, const char* input_name) const;
+
+      /** Find a sensor by its name and that of its module. */
+      NameHandle
+      find_sensor(const char* module_name, const char* sensor_name) const;
+
+      /** Get the module referred to by a handle (or containing the input or sensor it refers
+       * to), or `nullptr` if there is no such module in this configuration.
+       */
+      const Module*
+      get_module(NameHandle handle) const;
+
+      /** Get the input referred to by a handle, or `nullptr` if it isn't an input handle or
+          there is no such input in this configuration.  */
+      const ModuleInput<>*
+      get_input(NameHandle handle) const;
+
+      /** Get the sensor referred to by a handle, or `nullptr` if it isn't a sensor handle or
+          there is no such sensor in this configuration.  */
+      const Sensor<>*
+      get_sensor(NameHandle handle) const;
+
 #ifdef SWIG
       %immutable;
 #endif
       uint8_t
 	next_module_id;
+
+      /** Slot in the name index: a handle and the hash of the name it was found under. */
+      struct __attribute__ (( packed, align(1) ))
+      IndexEntry
+      {
+	uint32_t hash;
+	NameHandle handle;
+      };
+
+#ifdef SWIG
+      %immutable;
+#endif
+      /** Open-addressed (linear-probing) hash table of module, input and sensor names; its
+	  size is a power of two, and empty slots have handle kind `NameKind::NONE`.  */
+      crisp::util::SArray<IndexEntry> name_index;
+
+#ifdef SWIG
+      %immutable;
+#endif
+      /** Number of modules, inputs and sensors indexed in `name_index`.  The index is only
+	  used while the configuration still holds that many.  */
+      size_t indexed_items;
+
+    private:
+      NameHandle
+      find(NameKind kind, const char* module_name, const char* item_name) const;
     };
   }
 }
@@ -0,0 +1,63 @@
+/** @file
+ *
+ * Declares ConfigurationDiskCache, an on-disk store of the interface configurations a master
+ * node has received, keyed by configuration digest.
+ */
+#ifndef crisp_comms_ConfigurationDiskCache_hh
+#define crisp_comms_ConfigurationDiskCache_hh 1
+
+#include <cstdint>
+#include <string>
+
+#include <crisp/comms/Message.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    /** Directory of encoded configurations, keyed by digest (see
+     * `ConfigurationResponseCache::digest`).  Each configuration is stored in its wire
+     * encoding -- the body of the CONFIGURATION_RESPONSE message that carried it -- in a file
+     * named for its digest, so loading one is just a matter of reading the file and decoding
+     * it.  A file whose contents don't match its digest is ignored.
+     *
+     * Files are written by renaming a temporary file into place, so several processes may
+     * share a directory.
+     */
+    class ConfigurationDiskCache
+    {
+    public:
+      /** Constructor.
+       *
+       * @param directory Directory in which to keep the cached configurations.  It is created
+       *     (but not its parents) when first stored to, if necessary.
+       */
+      ConfigurationDiskCache(const std::string& directory);
+
+      /** Get the path of the file holding the configuration with a given digest. */
+      std::string path_for(uint64_t digest) const;
+
+      /** Load a cached configuration.
+       *
+       * @param digest Digest of the configuration wanted.
+       *
+       * @param out Receives the configuration, as a CONFIGURATION_RESPONSE message, on success.
+       *
+       * @return `true` if the configuration was found and intact.
+       */
+      bool load(uint64_t digest, Message& out) const;
+
+      /** Store a configuration under its digest.
+       *
+       * @param response CONFIGURATION_RESPONSE message carrying the configuration.
+       *
+       * @return `true` on success.
+       */
+      bool store(const Message& response) const;
+
+      const std::string directory;
+    };
+  }
+}
+
+#endif  /* crisp_comms_ConfigurationDiskCache_hh */
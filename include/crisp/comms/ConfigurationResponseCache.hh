@@ -0,0 +1,83 @@
+/** @file
+ *
+ * Declares ConfigurationResponseCache, which keeps the encoded CONFIGURATION_RESPONSE message
+ * for a node's configuration.
+ */
+#ifndef crisp_comms_ConfigurationResponseCache_hh
+#define crisp_comms_ConfigurationResponseCache_hh 1
+
+#include <cstdint>
+#include <mutex>
+
+#include <crisp/comms/Message.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    struct Configuration;
+
+    /** Cache of the CONFIGURATION_RESPONSE message for a configuration, so that answering a
+     * configuration query doesn't mean copying and re-encoding the whole configuration.  The
+     * cached message's body is shared by every copy of it that `get` returns.
+     *
+     * The cache doesn't watch the configuration for changes, so a cache hit costs no more than
+     * taking its lock.  Call `invalidate` after changing the configuration in any way (adding
+     * or renaming items, editing declarations, or installing a different configuration), so
+     * that the next call re-encodes it and computes a new digest;
+     * `BasicNode::set_configuration` does this for you.
+     *
+     * All methods are thread-safe.
+     */
+    class ConfigurationResponseCache
+    {
+    public:
+      ConfigurationResponseCache();
+
+      ConfigurationResponseCache(const ConfigurationResponseCache&) = delete;
+      ConfigurationResponseCache& operator =(const ConfigurationResponseCache&) = delete;
+
+      /** Get the CONFIGURATION_RESPONSE message for a configuration, encoding it if there is
+       * no cached message.
+       *
+       * @param config Configuration to describe.  The same object should be passed every
+       *     time.
+       *
+       * @return A copy of the cached message.
+       */
+      Message get(const Configuration& config);
+
+      /** Get the digest of a configuration's encoded form, encoding it if there is no cached
+       * message.  See `digest`.
+       *
+       * @param config Configuration to describe, as for `get`.
+       */
+      uint64_t get_digest(const Configuration& config);
+
+      /** Compute the digest of the configuration carried by a CONFIGURATION_RESPONSE message:
+       * the 64-bit FNV-1a hash of its body, or one if that is zero (so that zero can mean
+       * "unknown").  Identical configurations always have the same digest; the digest is wide
+       * enough that different ones practically never do, since a master uses whichever
+       * cached configuration matches.
+       *
+       * @param response CONFIGURATION_RESPONSE message.
+       */
+      static uint64_t digest(const Message& response);
+
+      /** Discard the cached message, so that the next call to `get` builds a new one even if
+          the configuration hasn't changed.  */
+      void invalidate();
+
+    private:
+      /** Build the cached message if there is none.  Call with `m_mutex` held. */
+      void refresh(const Configuration& config);
+
+      std::mutex m_mutex;
+      bool m_valid;
+      Message m_message;
+      uint64_t m_digest;
+    };
+  }
+}
+
+#endif  /* crisp_comms_ConfigurationResponseCache_hh */
@@ -27,8 +27,12 @@ namespace crisp
   {
     DataValue(DataDeclaration<>&& type);
 
-    /** Decode constructor. */
-    DataValue(const DataDeclaration<>& _data_type, DecodeBuffer& buf);
+    /** Decode constructor.
+     *
+     * @param copy If `false`, the value references the encoded data in @p buf instead of
+     *     copying it into newly-allocated storage; the buffer must then outlive this object.
+     */
+    DataValue(const DataDeclaration<>& _data_type, DecodeBuffer& buf, bool copy = true);
 
 #ifndef SWIG
     /** Move constructor. */
@@ -17,8 +17,17 @@ namespace crisp
 
       static constexpr MessageType Type = MessageType::HANDSHAKE;
 
+      /** Bit in `features` advertising that the sending node can receive stamped messages,
+	  and would like to (see `Message::Stamp`).  */
+      static constexpr uint8_t FEATURE_MESSAGE_STAMPS = 1 << 0;
+
+      /** Bit in `features` advertising that the sending node can receive MODULE_CONTROL
+	  messages in compact form, and would like to (see `CompactControlCodec`).  */
+      static constexpr uint8_t FEATURE_COMPACT_CONTROL = 1 << 1;
+
       Handshake();
-      Handshake(uint32_t _version, Role _role);
+      Handshake(uint32_t _version, Role _role, uint8_t _features = 0,
+		uint64_t _configuration_digest = 0);
 
       inline size_t
 	get_encoded_size() const { return sizeof(Handshake); }
@@ -27,10 +36,14 @@ namespace crisp
 	encode(MemoryEncodeBuffer& buffer) const
       { return buffer.write(this, sizeof(Handshake)); }
 
-      inline DecodeResult
-	decode(DecodeBuffer& buffer) const
-      { return buffer.read(this, sizeof(Handshake)); }
+      /** Decode a handshake.  Handshakes from nodes that predate the `features` or
+	  `configuration_digest` fields are accepted, with both fields zeroed whatever bytes
+	  follow `role`; anything shorter fails with `DecodeResult::BUFFER_UNDERFLOW`.  */
+      DecodeResult
+	decode(DecodeBuffer& buffer);
 
+      /** Decode a handshake as `decode` does, returning a zeroed handshake (which names no
+	  known protocol) if it is too short.  */
       static Handshake
 	decode_copy(DecodeBuffer& buffer);
 
@@ -41,6 +54,12 @@ namespace crisp
       uint32_t protocol;
       uint32_t version;
       Role role;
+      uint8_t features;		/**< Bitwise-OR of the `FEATURE_*` bits supported by the
+				   sending node. */
+      uint64_t configuration_digest; /**< For slave nodes, digest of the encoded interface
+					configuration (see `ConfigurationResponseCache::digest`),
+					so that a master can use a copy it has cached instead of
+					querying for it; zero if unknown.  */
     };
 
     ENUM_CLASS(HandshakeAcknowledge, uint8_t,
@@ -0,0 +1,119 @@
+/** @file
+ *
+ * Declares LoopbackLink, an in-process duplex link between two nodes.
+ */
+#ifndef crisp_comms_LoopbackLink_hh
+#define crisp_comms_LoopbackLink_hh 1
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+namespace crisp
+{
+  namespace comms
+  {
+    /** Connected pair of stream sockets for running two nodes (as
+     * `BasicNode<LoopbackLink::Protocol>`) in the same process, without the network stack.
+     *
+     * Without a delay, the two ends are simply a `socketpair`.  With one, each direction
+     * passes through a relay that holds every chunk of data it reads for exactly that long
+     * before writing it out, so that benchmarks can model link latency deterministically.
+     * Closing either end closes the other once any delayed data has been delivered.
+     *
+     * Example:
+     *
+     *     LoopbackLink link ( master_service, slave_service, std::chrono::milliseconds(5) );
+     *     BasicNode<LoopbackLink::Protocol>
+     *       master ( std::move(link.first), NodeRole::MASTER ),
+     *       slave ( std::move(link.second), NodeRole::SLAVE );
+     */
+    class LoopbackLink
+    {
+    public:
+      typedef boost::asio::local::stream_protocol Protocol;
+      typedef Protocol::socket Socket;
+
+      /** Create a link.
+       *
+       * @param first_service IO service for the `first` end's socket.
+       *
+       * @param second_service IO service for the `second` end's socket.
+       *
+       * @param delay One-way delay to apply in each direction.
+       */
+      LoopbackLink(boost::asio::io_service& first_service,
+                   boost::asio::io_service& second_service,
+                   std::chrono::microseconds delay = std::chrono::microseconds(0));
+
+      /** Destructor.  Calls `halt`. */
+      ~LoopbackLink();
+
+      LoopbackLink(const LoopbackLink&) = delete;
+      LoopbackLink& operator =(const LoopbackLink&) = delete;
+
+      /** Socket for one end of the link; move it into a node. */
+      Socket first;
+
+      /** Socket for the other end of the link. */
+      Socket second;
+
+      /** One-way delay applied in each direction. */
+      const std::chrono::microseconds delay;
+
+      /** Stop the delay relays (if any), discarding any data they hold.  Does not close
+          `first` or `second`.  */
+      void halt();
+
+    private:
+      /** One direction of a delayed link. */
+      struct Relay
+      {
+        Relay(boost::asio::io_service& service);
+
+        /** Chunk of data waiting to be written out. */
+        struct Chunk
+        {
+          std::chrono::steady_clock::time_point due;
+          std::vector<char> data;
+        };
+
+        Socket in;              /**< Socket from which data is read. */
+        Socket out;             /**< Socket to which data is written once due. */
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Chunk> chunks;
+        bool closed;            /**< Set when `in` reaches end-of-file or fails. */
+
+        std::thread reader;
+        std::thread writer;
+      };
+
+      /** Read from `relay.in` until end-of-file, queueing data for the writer thread. */
+      void read_loop(Relay& relay);
+
+      /** Write queued data to `relay.out` as it becomes due. */
+      void write_loop(Relay& relay);
+
+      /** IO service for the relays' sockets, which are only used synchronously. */
+      boost::asio::io_service m_io_service;
+
+      std::atomic<bool> m_halting;
+      Relay* m_relays[2];
+    };
+  }
+}
+
+#endif  /* BOOST_ASIO_HAS_LOCAL_SOCKETS */
+
+#endif  /* crisp_comms_LoopbackLink_hh */
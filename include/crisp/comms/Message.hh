@@ -5,6 +5,7 @@
 #include <cassert>
 #include <crisp/comms/Buffer.hh>
 #include <crisp/comms/common.hh>
+#include <crisp/util/BufferPool.hh>
 #include <crisp/util/checksum.hh>
 
 /** Message representation.  This class provides little to no encapsulation (not important for
@@ -23,11 +24,13 @@ namespace crisp
 	       CONFIGURATION_QUERY,
 	       CONFIGURATION_RESPONSE,
 	       SENSOR_DATA,
-	       MODULE_CONTROL
+	       MODULE_CONTROL,
+	       MODULE_CONTROL_COMPACT,	/**< MODULE_CONTROL in compact form; see CompactControlCodec. */
+	       SENSOR_POLL		/**< Request for sensor readings; see SensorPoll. */
 	       );
 
 #ifndef SWIG
-#  define MESSAGE_TYPE_MAX MessageType::MODULE_CONTROL
+#  define MESSAGE_TYPE_MAX MessageType::SENSOR_POLL
 #  define MESSAGE_TYPE_COUNT (static_cast<uint8_t>(MESSAGE_TYPE_MAX)+1u)
 
     namespace detail
@@ -74,16 +77,34 @@ namespace crisp
 
       Message(const Message&);
 
+      /** Construct a message from a message-body object (Handshake, Configuration,
+       * ModuleControl, etc.).
+       *
+       * @param _body Object to encode as the message body.
+       *
+       * @param pool Pool from which to allocate the body buffer, if any.
+       *
+       * @param result If non-null, receives the result of encoding the body.
+       */
       template < typename _T, typename _U = typename std::remove_reference<_T>::type,
 		 typename _Enable = typename std::enable_if<!std::is_same<_U,crisp::comms::Message>::value>::type>
-      Message(_T&& _body)
+      Message(_T&& _body, crisp::util::BufferPool* pool = nullptr, EncodeResult* result = nullptr)
+	: header ( ),
+	  body ( ),
+	  queued_at ( 0 ),
+	  checksum ( 0 ),
+	  m_cached_checksum ( 0 ),
+	  m_checksum_cached ( false )
       {
 	const detail::MessageTypeInfo& info ( detail::get_type_info(_U::Type) );
 	header.type = _U::Type;
-	MemoryEncodeBuffer eb ( _body.get_encoded_size() );
-	_body.encode(eb);
-	body.reset(Buffer::copy_new(eb.data, eb.length));
-	header.length = _body.get_encoded_size() + (info.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0);
+	size_t body_size ( _body.get_encoded_size() );
+	body.reset(pool ? pool->acquire(body_size) : new Buffer(body_size));
+	MemoryEncodeBuffer eb ( body.get() );
+	EncodeResult er ( _body.encode(eb) );
+	if ( result )
+	  *result = er;
+	header.length = body_size + (info.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0);
 	checksum = compute_checksum();
       }
 
@@ -92,9 +113,28 @@ namespace crisp
 
     size_t get_encoded_size() const;
 
-    /** Decode the Message-layer data in a decode buffer.  */
+    /** Decode the Message-layer data in a decode buffer.
+     *
+     * @param db Decode buffer to read from.
+     *
+     * @param pool Pool from which to allocate the body buffer, if any.
+     */
     static Message
-    decode(DecodeBuffer& db);
+    decode(DecodeBuffer& db, crisp::util::BufferPool* pool = nullptr);
+
+    /** Decode the Message-layer data in a decode buffer without copying the message body: the
+     * decoded message's body references the body bytes in place (see `Buffer::slice`), and
+     * keeps the decode buffer's storage alive until it is released.
+     *
+     * @param db Decode buffer to read from.  Must be backed by a heap-allocated `Buffer`
+     *     (i.e. `db.buffer` must be non-null), and must contain the complete message.
+     *
+     * @param pool Pool from which to allocate the slice object, if any.
+     *
+     * @return The decoded message.
+     */
+    static Message
+    decode_slice(DecodeBuffer& db, crisp::util::BufferPool* pool = nullptr);
 
 
     /** Encode a Message instance into a buffer. */
@@ -104,6 +144,28 @@ namespace crisp
     EncodeResult
     encode(StreamEncodeBuffer& buf) const;
 
+    /** Location and size of one contiguous piece of a message's encoded form. */
+    struct Segment
+    {
+      const void* data;
+      size_t length;
+    };
+
+    /** Maximum number of segments filled in by `get_segments`. */
+    static constexpr size_t MaxSegments = 3;
+
+    /** Describe this message's encoded form as a list of memory segments (header, body,
+     * checksum) suitable for scatter-gather IO.  Nothing is copied: the segments point into the
+     * message itself and its body buffer, so they remain valid only as long as the message
+     * does and is not modified.
+     *
+     * @param segments Array to fill.
+     *
+     * @return Number of segments filled in.
+     */
+    size_t
+    get_segments(Segment (&segments)[MaxSegments]) const;
+
     /* template < typename _T >
      * static inline EncodeResult
      * encode(MemoryEncodeBuffer& buf, const _T&& _body)
@@ -129,8 +191,19 @@ namespace crisp
     bool
     operator ==(const Message&) const;
 
+    /** Compute the checksum for this message's header and body.  The result is cached, so
+     * repeated calls (e.g. from `checksum_ok` and then `encode`) only traverse the message once.
+     *
+     * @return The computed checksum, or zero if this message's type does not carry a checksum.
+     */
     uint32_t compute_checksum() const;
 
+    /** Discard the cached result of `compute_checksum`.  Call this after modifying the header or
+     * body of a message whose checksum may already have been computed.
+     */
+    inline void invalidate_checksum() const
+    { m_checksum_cached = false; }
+
     inline bool checksum_ok() const {
       if ( detail::get_type_info(header.type).has_checksum )
 	return checksum == compute_checksum();
@@ -150,31 +223,51 @@ namespace crisp
 					*/
 	MessageType type;		/**< Message type (a value of type MessageType) */
 
-#if defined(MESSAGE_USE_SEQUENCE_ID) && MESSAGE_USE_SEQUENCE_ID
-	uint32_t sequence_id;	/**< Sequence number of this message.  */
-#endif
-
 	/** Equality operator. */
 	bool
 	operator ==(const Header& h) const
-	{ return h.length == length && h.type == type
-#if defined(MESSAGE_USE_SEQUENCE_ID) && MESSAGE_USE_SEQUENCE_ID
-	    && h.sequence_id == sequence_id
-#endif
-	    ;
-	}
+	{ return h.length == length && h.type == type; }
 
       };
 
+    /** Flag set in the type field of a stamped message's header.  */
+    static constexpr uint8_t StampedFlag = 0x80;
+
+    /** Link-diagnostic stamp, sent between the header and the body of a message when its
+	header's type field has `StampedFlag` set; the header's length then includes the
+	stamp.  Stamps are only sent to a remote node that has advertised support for them in
+	its handshake (see `BasicNode::request_message_stamps`), and are added and stripped by
+	the node as messages are written and read -- so a Message object never contains one.
+
+	The stamp is not covered by the message checksum.  */
+    struct __attribute__ (( packed ))
+    Stamp
+      {
+	uint32_t sequence;	/**< Per-message-type sequence number, starting at one. */
+	uint32_t queue_delay;	/**< Time the message spent in the sender's outgoing queue, in
+				   microseconds.  */
+	uint64_t sent_at;	/**< Time at which the message was written, in microseconds of
+				   the sender's steady clock.  */
+      };
+
 
     /** Header fields for this message. */
     Header header;
     crisp::util::RefTraits<Buffer>::stored_ref body;
 
+    /** Time at which the message was queued for sending, in microseconds of the sending
+	node's steady clock, or zero if unknown.  Only set by nodes that stamp their outgoing
+	messages.  */
+    uint64_t queued_at;
+
       mutable uint32_t checksum; /**< Stored checksum value.  The checksum is computed over the
                                   * entire message (with the exception, of course, of the
                                   * checksum field itself).
                                   */
+
+  private:
+    mutable uint32_t m_cached_checksum; /**< Result of the last call to `compute_checksum`. */
+    mutable bool m_checksum_cached; /**< Whether `m_cached_checksum` is valid. */
   };
 
    template<>
@@ -1,8 +1,14 @@
 #ifndef crisp_comms_MessageDispatcher_hh
 #define crisp_comms_MessageDispatcher_hh 1
 
+#include <crisp/comms/ConfigurationResponseCache.hh>
 #include <crisp/comms/Message.hh>
 #include <crisp/comms/MessageHandler.hh>
+#include <crisp/comms/ModuleControl.hh>
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/SensorHistory.hh>
+#include <crisp/comms/SensorPoll.hh>
+#include <crisp/comms/SensorReaders.hh>
 
 namespace crisp
 {
@@ -11,12 +17,21 @@ namespace crisp
     struct Handshake;
     struct HandshakeResponse;
     struct Configuration;
-    struct ModuleControl;
 
     ENUM_CLASS(MessageDirection, uint8_t,
 	       INCOMING,
 	       OUTGOING);
 
+    /** Ways in which a MessageDispatcher can invoke message handlers. */
+    ENUM_CLASS(DispatchMode, uint8_t,
+	       ASYNCHRONOUS,	/**< Each handler is posted to the node's `io_service` with its
+				     own (shared) copy of the decoded message body.  */
+	       SYNCHRONOUS	/**< Handlers are called before `dispatch` returns, in the
+				     dispatching thread, with a reference to a message body decoded
+				     into storage that is reused for the next message.  Handlers must
+				     not block, and must not keep references to the body.  */
+	       );
+
     /** Container and interface for user-set sent/received callbacks.
      */
     template < typename _Node >
@@ -65,7 +80,11 @@ namespace crisp
        *   receive handler will schedule a SYNC message send at 1 Hz.
        *
        * - Receive handler in `configuration_query`: responds by sending a configuration
-           response containing the node's installed interface configuration.
+       *   response containing the node's installed interface configuration, from
+       *   `configuration_cache`.
+       *
+       * - Receive handler in `sensor_poll`: responds by sending a single sensor-data message
+       *   holding a reading from each polled sensor that has a reader in `sensor_readers`.
        *
        * - Send and receive handlers in `module_control`: informational output only.  You will
        *   almost certainly want to override the `received` handler function for nodes operating
@@ -75,18 +94,53 @@ namespace crisp
       set_default_callbacks();
 
       /** Assignment operator.  Copies the handlers -- _and_ the target node! --
-          of another dispatcher. */
+          of another dispatcher.  This dispatcher's configuration cache is invalidated, and
+          its sensor readers and sensor history are kept.  */
       MessageDispatcher&
       operator =(const MessageDispatcher& other);
 
+      /** Set the way in which handlers are invoked.  The default is
+       * `DispatchMode::ASYNCHRONOUS`.
+       *
+       * @param mode New dispatch mode.
+       */
+      void
+      set_dispatch_mode(DispatchMode mode);
+
+      /** Get the current dispatch mode. */
+      inline DispatchMode
+      get_dispatch_mode() const
+      { return m_mode; }
+
     private:
       _Node* m_node;
+      DispatchMode m_mode;
+
+      /** Reusable decode targets for module-control messages, one for each direction (since
+          incoming and outgoing messages may be dispatched concurrently).  */
+      ModuleControl m_module_control[2];
+
+      /** Reusable decode targets for sensor-data messages, one for each direction.  */
+      SensorData m_sensor_data[2];
+
+      /** Invoke the appropriate handler for the given message and direction, in the calling
+          thread.  */
+      bool dispatch_synchronous(const Message& message, MessageDirection direction);
+
+      /** Decode a sensor-data message body against the remote configuration snapshot if it
+          is an incoming message and a snapshot is set, and against the node's own
+          configuration otherwise.  */
+      DecodeResult decode_sensor_data(const Message& message, MessageDirection direction,
+                                      SensorData& data) const;
 
 
     public:
       /** Invoke the appropriate handler for the given message and direction.
+       *
+       * @return `false` if, in synchronous mode or when recording to `sensor_history`, the
+       *     message body could not be decoded; no handler is then called.
        */
-      void dispatch(Message&& message, MessageDirection direction) throw ( std::runtime_error );
+      bool dispatch(Message&& message, MessageDirection direction) throw ( std::runtime_error );
 
       MessageHandler<_Node,Handshake> handshake;
       MessageHandler<_Node,HandshakeResponse> handshake_response;
@@ -94,6 +148,27 @@ namespace crisp
       MessageHandler<_Node,void> configuration_query;
       MessageHandler<_Node,Configuration> configuration_response;
       MessageHandler<_Node,ModuleControl> module_control;
+      MessageHandler<_Node,SensorData> sensor_data;
+      MessageHandler<_Node,SensorPoll> sensor_poll;
+
+      /** Encoded reply to configuration queries, used by the default `configuration_query`
+          handler.  */
+      ConfigurationResponseCache configuration_cache;
+
+      /** Functions used by the default `sensor_poll` handler to take sensor readings.  */
+      SensorReaders sensor_readers;
+
+      /** Store in which the readings of incoming sensor-data messages are recorded, using the
+          same decoded batch that is passed to the `sensor_data` handlers; none if null.  Set by
+          `BasicNode::keep_sensor_history`.  */
+      std::shared_ptr<SensorHistory> sensor_history;
+
+      /** Snapshot of the remote node's configuration, against which incoming sensor-data
+          messages are decoded (and which the decoded batches keep alive); if null, they are
+          decoded against the node's own `configuration` instead.  Replaced, never modified,
+          by `BasicNode` when it receives a configuration response; access with
+          `std::atomic_load` and `std::atomic_store`.  */
+      std::shared_ptr<const Configuration> remote_configuration;
 
     };
   }
@@ -29,7 +29,7 @@ namespace crisp
      */
     template < typename _Node, typename _Tp, typename _Function >
     static void
-    dereference_and_call(_Function handler, _Node& node, const std::shared_ptr<_Tp> body,
+    dereference_and_call(const _Function& handler, _Node& node, const std::shared_ptr<_Tp> body,
                          MessageHandlerSignal<_Node, _Tp>& source)
     {
       handler(node, *body);
@@ -90,6 +90,21 @@ namespace crisp
                                        function, _1, _2, std::ref(*this)));
       }
 
+      using Base::emit_blocking;
+
+      /** Invoke the connected callbacks in the calling thread with a reference to a message
+       * body that the caller owns.  No `shared_ptr` control block is allocated: callbacks see
+       * the same `const _Body&` they would with `emit`, but it is valid only until this
+       * method returns.
+       *
+       * @param node Node argument for the callbacks.
+       *
+       * @param body Message body to pass to the callbacks.
+       */
+      inline void
+      emit_blocking(_Node& node, const _Body& body)
+      { Base::emit_blocking(node, std::shared_ptr<_Body>(std::shared_ptr<_Body>(), const_cast<_Body*>(&body))); }
+
     };
     /**@}*/
 
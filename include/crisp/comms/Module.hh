@@ -119,8 +119,9 @@ namespace crisp
       /** Find an input by name. */
       inline const ModuleInput<>*
 	find_input(const char* _name) const
-      { for ( size_t i ( 0 ); i < num_inputs; ++i )
-	  if ( inputs[i].name_length == strlen(_name) && ! strncmp(_name, inputs[i].name, inputs[i].name_length) )
+      { size_t length ( strlen(_name) );
+	for ( size_t i ( 0 ); i < num_inputs; ++i )
+	  if ( inputs[i].name_length == length && ! memcmp(_name, inputs[i].name, length) )
 	    return &(inputs[i]);
 	return nullptr;
       }
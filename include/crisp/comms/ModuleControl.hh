@@ -26,6 +26,9 @@ namespace crisp
       static const MessageType Type;
       static const size_t HeaderSize;
 
+      /** Bit in `input_ids` that marks a "clear" control message. */
+      static constexpr uint16_t ClearBit = 1 << 15;
+
       typedef ModuleControl TranscodeAsType;
 
       ModuleControl();
@@ -132,10 +135,16 @@ namespace crisp
        * @param config Configuration from which to determine value types.
        *
        * @param buf Input buffer
+       *
+       * @param copy_values If `false`, the decoded values reference the encoded data in @p buf
+       *     rather than copies of it, so decoding into an instance whose `values` array already
+       *     has enough capacity allocates no memory.  The buffer must then outlive the decoded
+       *     values.
        */
       DecodeResult
       decode(DecodeBuffer& buf,
-             const Configuration& config);
+             const Configuration& config,
+             bool copy_values = true);
 
       /** Decode a ModuleControl instance from a byte buffer, returning a copy of the
        *	instance.
@@ -156,17 +165,20 @@ namespace crisp
        */
       inline uint8_t
 	get_num_values() const
-      { uint8_t out ( 0 );
-	if ( ! is_clear() )
-	  for ( uint8_t i ( 0 ); i < (8 * sizeof(input_ids) - 1); ++i )
-	    out += (input_ids & (1 << i)) ? 1 : 0;
-	return out; }
+      { return is_clear() ? 0 : __builtin_popcount(input_ids & (ClearBit - 1)); }
 
       /** Check if this is a "clear" control message, i.e. requests that given inputs be reset to
        *	their neutral values.
        */
       inline bool is_clear() const
-      { return input_ids & (1 << ((8 * sizeof(input_ids)) - 1)); }
+      { return input_ids & ClearBit; }
+
+      /** Get the index in `values` of the value for an input, whether or not it is set.  Values
+       *	are kept in input-ID order, so this is the number of lower-numbered inputs set.
+       */
+      inline size_t
+	index_of(uint8_t input_id) const
+      { return __builtin_popcount(input_ids & ((1u << input_id) - 1)); }
 
       struct ValuePair
       {
@@ -187,7 +199,8 @@ namespace crisp
       const Module* module;
 
       /* Tail fields: for each input present, a value (of size appropriate for that input's data
-       * type) specifying the input value.
+       * type) specifying the input value.  Values are sorted by input ID, so the value for an
+       * input is found directly at `values[index_of(input_id)]`.
        */
       mutable crisp::util::SArray<ValuePair> values;
     };
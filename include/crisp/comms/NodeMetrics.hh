@@ -0,0 +1,227 @@
+/** @file
+ *
+ * Declares NodeMetrics, the per-connection counters and gauges kept by BasicNode.
+ */
+#ifndef crisp_comms_NodeMetrics_hh
+#define crisp_comms_NodeMetrics_hh 1
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#include <crisp/comms/Message.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    /** Lock-free counters and gauges describing the traffic on a single connection.
+     *
+     * Every `record_*` method is a handful of relaxed atomic operations, so they may be called
+     * from any thread (and from the send and receive loops' hot paths).  A `Snapshot` is a
+     * plain copy of the values, suitable for printing or for summing over several nodes; since
+     * the counters are read one at a time, a snapshot taken while the node is busy is not
+     * guaranteed to be consistent across counters.
+     */
+    class NodeMetrics
+    {
+    public:
+      /** Number of buckets in each latency histogram.  Bucket zero counts values under one
+          microsecond, and bucket `i` values from 2^(i-1) up to 2^i microseconds; the last
+          bucket also counts anything larger.  */
+      static constexpr size_t LatencyBuckets = 24;
+
+      /** Message and byte counts for a single message type and direction. */
+      struct Counts
+      {
+        uint64_t messages;
+        uint64_t bytes;         /**< Encoded size, including header and checksum. */
+      };
+
+      /** Link statistics for the stamped messages of a single type received from the remote
+       * node (see `Message::Stamp`).
+       *
+       * Since the two nodes' clocks needn't share an epoch, transit times are measured
+       * relative to the smallest difference yet seen between a message's receive time and its
+       * send time (see `Snapshot::clock_offset`): they show how much longer than the fastest
+       * message each message took to cross the link.  Queue delays are measured entirely on
+       * the sender's clock, so are absolute.
+       */
+      struct StampCounts
+      {
+        uint64_t received;      /**< Stamped messages received. */
+        uint64_t lost;          /**< Gaps in the sequence numbers received. */
+        uint64_t reordered;     /**< Messages that arrived after a later one.  Each was
+                                     previously counted as lost, and is no longer.  */
+        uint64_t transit[LatencyBuckets]; /**< Histogram of transit times, less the fastest. */
+        uint64_t queue_delay[LatencyBuckets]; /**< Histogram of time spent in the sender's
+                                                   outgoing queue.  */
+      };
+
+      /** Point-in-time copy of a NodeMetrics object's values. */
+      struct Snapshot
+      {
+        Snapshot();
+
+        Counts incoming[MESSAGE_TYPE_COUNT]; /**< Received messages, by type. */
+        Counts outgoing[MESSAGE_TYPE_COUNT]; /**< Sent messages, by type. */
+
+        uint64_t checksum_failures; /**< Received messages discarded for a bad checksum. */
+        uint64_t resyncs;           /**< Times the receive loop lost framing and began
+                                         scanning for a sync message.  */
+        uint64_t discarded_bytes;   /**< Received bytes skipped while resynchronizing. */
+        uint64_t decode_errors;     /**< Received frames with an invalid type or length, or with
+                                         bodies that failed to decode.  */
+        uint64_t encode_errors;     /**< Message bodies that failed to encode for sending. */
+
+        uint64_t queue_depth;      /**< Outgoing messages queued but not yet sent. */
+        uint64_t queue_high_water; /**< Largest value `queue_depth` has reached. */
+
+        StampCounts stamps[MESSAGE_TYPE_COUNT]; /**< Received stamped messages, by type. */
+
+        /** Smallest difference yet seen between the local receive time and the remote send
+            time of a stamped message, in microseconds, or `INT64_MAX` if none has been
+            received.  When both nodes share a clock (e.g. they're on the same host), this is
+            the fastest transit time.  */
+        int64_t clock_offset;
+
+        /** Sum the counts for all received message types. */
+        Counts total_incoming() const;
+
+        /** Sum the counts for all sent message types. */
+        Counts total_outgoing() const;
+
+        /** Estimate a percentile of a latency histogram.
+         *
+         * @param histogram Histogram to examine.
+         *
+         * @param fraction Fraction of values (e.g. 0.99) that should fall under the result.
+         *
+         * @return Upper limit of the bucket holding the requested percentile, in microseconds,
+         *     or zero if the histogram is empty.
+         */
+        static uint64_t percentile(const uint64_t (&histogram)[LatencyBuckets], double fraction);
+
+        /** Add another snapshot's values to this one's, e.g. to aggregate the metrics of
+         * several nodes.  Queue depths and high-water marks are summed as well; the clock
+         * offset becomes the smaller of the two.
+         */
+        Snapshot& operator +=(const Snapshot& other);
+
+        /** Print the snapshot in human-readable form.  Message types for which nothing has
+         * been sent or received are omitted.
+         *
+         * @param stream Stream to which to print.
+         *
+         * @param prefix String to print at the start of each line.
+         */
+        void print(FILE* stream, const char* prefix = "") const;
+      };
+
+      NodeMetrics();
+
+      NodeMetrics(const NodeMetrics&) = delete;
+      NodeMetrics& operator =(const NodeMetrics&) = delete;
+
+      /** Count a received message. */
+      inline void
+      record_incoming(MessageType type, size_t bytes)
+      { record(m_incoming[static_cast<size_t>(type)], bytes); }
+
+      /** Count a sent message. */
+      inline void
+      record_outgoing(MessageType type, size_t bytes)
+      { record(m_outgoing[static_cast<size_t>(type)], bytes); }
+
+      inline void
+      record_checksum_failure()
+      { m_checksum_failures.fetch_add(1, std::memory_order_relaxed); }
+
+      /** Count a loss of framing in the received stream. */
+      inline void
+      record_resync()
+      { m_resyncs.fetch_add(1, std::memory_order_relaxed); }
+
+      /** Count received bytes skipped while resynchronizing. */
+      inline void
+      record_discarded(size_t bytes)
+      { m_discarded_bytes.fetch_add(bytes, std::memory_order_relaxed); }
+
+      inline void
+      record_decode_error()
+      { m_decode_errors.fetch_add(1, std::memory_order_relaxed); }
+
+      inline void
+      record_encode_error()
+      { m_encode_errors.fetch_add(1, std::memory_order_relaxed); }
+
+      /** Count a received stamped message, and update the loss, reordering and latency
+       * statistics for its type.  Unlike the other `record_*` methods, this must only be
+       * called from one thread at a time (i.e. from the receive loop).
+       *
+       * @param type Message type.
+       *
+       * @param stamp The message's stamp.
+       *
+       * @param received_at Time at which the message was received, in microseconds of the
+       *     local steady clock.
+       */
+      void record_stamp(MessageType type, const Message::Stamp& stamp, uint64_t received_at);
+
+      /** Update the outgoing-queue depth gauge, and its high-water mark. */
+      void set_queue_depth(size_t depth);
+
+      /** Take a snapshot of the current values. */
+      Snapshot snapshot() const;
+
+      /** Reset all counters to zero, and the high-water mark to the current queue depth.  The
+          clock offset and the sequence numbers expected next are kept.  */
+      void reset();
+
+    private:
+      struct AtomicCounts
+      {
+        std::atomic<uint64_t> messages;
+        std::atomic<uint64_t> bytes;
+      };
+
+      static inline void
+      record(AtomicCounts& counts, size_t bytes)
+      {
+        counts.messages.fetch_add(1, std::memory_order_relaxed);
+        counts.bytes.fetch_add(bytes, std::memory_order_relaxed);
+      }
+
+      struct AtomicStampCounts
+      {
+        std::atomic<uint64_t> received;
+        std::atomic<uint64_t> lost;
+        std::atomic<uint64_t> reordered;
+        std::atomic<uint64_t> transit[LatencyBuckets];
+        std::atomic<uint64_t> queue_delay[LatencyBuckets];
+      };
+
+      /** Receive-loop-only sequence tracking for one message type. */
+      struct SequenceState
+      {
+        bool started;
+        uint32_t expected;      /**< Sequence number expected next. */
+      };
+
+      AtomicCounts m_incoming[MESSAGE_TYPE_COUNT];
+      AtomicCounts m_outgoing[MESSAGE_TYPE_COUNT];
+      std::atomic<uint64_t> m_checksum_failures;
+      std::atomic<uint64_t> m_resyncs;
+      std::atomic<uint64_t> m_discarded_bytes;
+      std::atomic<uint64_t> m_decode_errors;
+      std::atomic<uint64_t> m_encode_errors;
+      std::atomic<uint64_t> m_queue_depth;
+      std::atomic<uint64_t> m_queue_high_water;
+      AtomicStampCounts m_stamps[MESSAGE_TYPE_COUNT];
+      SequenceState m_sequences[MESSAGE_TYPE_COUNT];
+      std::atomic<int64_t> m_clock_offset;
+    };
+  }
+}
+
+#endif  /* crisp_comms_NodeMetrics_hh */
@@ -1,6 +1,6 @@
 /** @file
  *
- * Declares a class `NodeServer` for TCP-based protocol-node variants.
+ * Declares a class `NodeServer` for stream-based (TCP and UNIX-domain) protocol-node variants.
  */
 #ifndef crisp_comms_NodeServer_hh
 #define crisp_comms_NodeServer_hh 1
@@ -12,6 +12,7 @@
 #include <boost/asio/spawn.hpp>
 #include <boost/asio/io_service.hpp>
 #include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
 
 #include <crisp/comms/BasicNode.hh>
 #include <crisp/comms/Configuration.hh>
@@ -26,6 +27,9 @@ namespace crisp
      *  For configuration of the local end of each connection, NodeServer contains a
      *  Configuration object `configuration` and a MessageDispatcher object `dispatcher`, which
      *  are copied to each node created for a connection.
+     *
+     *  For UNIX-domain protocols, the socket file named by the listen endpoint must not
+     *  already exist; NodeServer does not remove it, either on construction or on exit.
      */
     template < typename _Node >
     struct NodeServer
@@ -53,6 +57,12 @@ namespace crisp
       /** MessageDispatcher to be copied to created (nodes). */
       MessageDispatcher<_Node> dispatcher;
 
+      /** Buffer pool shared by all created nodes. */
+      crisp::util::RefTraits<crisp::util::BufferPool>::stored_ref buffer_pool;
+
+      /** Number of worker threads to launch for each created node. */
+      size_t worker_threads_per_node;
+
       /** Signal emitted for each new connection. */
       ConnectSignal connect_signal;
 
@@ -102,6 +112,13 @@ namespace crisp
       typename ConnectSignal::Connection
       on_connect(typename ConnectSignal::Function func);
 
+      /** Sum the metrics of all currently-connected nodes.
+       *
+       * @return Aggregate snapshot; see `BasicNode::get_metrics`.
+       */
+      NodeMetrics::Snapshot
+      get_metrics();
+
 
       /** Main server routine.
        */
@@ -111,6 +128,9 @@ namespace crisp
     };
 
     extern template class NodeServer< BasicNode<boost::asio::ip::tcp> >;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    extern template class NodeServer< BasicNode<boost::asio::local::stream_protocol> >;
+#endif
   }
 }
 
@@ -0,0 +1,147 @@
+/** @file
+ *
+ * Declares OutgoingQueue, the outgoing-message queue used by BasicNode.
+ */
+#ifndef crisp_comms_OutgoingQueue_hh
+#define crisp_comms_OutgoingQueue_hh 1
+
+#include <atomic>
+#include <cstdint>
+
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/common.hh>
+#include <crisp/util/MPSCQueue.hh>
+#include <crisp/util/ObjectPool.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    /** Queueing policies for outgoing messages. */
+    ENUM_CLASS(QueuePolicy, uint8_t,
+               FIFO,          /**< Every message is sent, in the order it was queued. */
+               LATEST_VALUE   /**< A queued message is replaced in place (i.e. keeping its
+                                   position in the queue) by any newer message with the same
+                                   coalescing key that is queued before it is sent.  */
+               );
+
+    /** Lock-free multiple-producer, single-consumer queue for outgoing messages, with a
+     * per-message-type queueing policy.
+     *
+     * Messages whose type uses the `LATEST_VALUE` policy are coalesced by key: for
+     * MODULE_CONTROL messages, the key is the target module together with the set of inputs
+     * being set (so a newer message never discards values for inputs it doesn't set itself);
+     * other types are keyed by type alone.  Each key in use holds one of a fixed table of
+     * slots near its hash, which stores its pending message and is released for other keys
+     * once that message has been popped; when every nearby slot holds another key, messages
+     * are queued in FIFO order.
+     *
+     * Queue entries and pending coalesced messages are held in preallocated storage (see
+     * `OUTGOING_QUEUE_RESERVED_ENTRIES`), so queueing doesn't allocate memory unless the
+     * backlog outgrows it.
+     */
+    class OutgoingQueue
+    {
+    public:
+      OutgoingQueue();
+      ~OutgoingQueue();
+
+      OutgoingQueue(const OutgoingQueue&) = delete;
+      OutgoingQueue& operator =(const OutgoingQueue&) = delete;
+
+      /** Set the queueing policy for a message type.  By default, MODULE_CONTROL messages use
+       * `QueuePolicy::LATEST_VALUE` and all other types use `QueuePolicy::FIFO`.
+       *
+       * @param type Message type to set the policy for.
+       *
+       * @param policy Policy to use for messages of type @p type queued from now on.
+       */
+      void set_policy(MessageType type, QueuePolicy policy);
+
+      /** Get the queueing policy for a message type. */
+      QueuePolicy get_policy(MessageType type) const;
+
+      /** Queue a message.  May be called from any thread, and never waits for other threads:
+          a coalesced message costs a few compare-and-swaps on its slot, retried only when
+          another thread changed the slot in between.  */
+      void push(const Message& m);
+
+      /** Queue a message.  May be called from any thread, and never waits for other threads:
+          a coalesced message costs a few compare-and-swaps on its slot, retried only when
+          another thread changed the slot in between.  */
+      void push(Message&& m);
+
+      /** Fetch the next message to send, if there is one.  Consumer only.
+       *
+       * @param out Variable into which the next message should be moved.
+       *
+       * @return `true` if a message was fetched, and `false` if the queue was empty.
+       */
+      bool try_pop(Message& out);
+
+      /** Get the number of messages currently queued.  Coalesced messages count once.  The
+          value is only approximate while other threads are pushing or popping.  */
+      inline size_t
+      size() const
+      { return m_size.load(std::memory_order_relaxed); }
+
+      /** Get the number of queued messages that have been discarded because a newer message
+          with the same key replaced them.  */
+      inline size_t
+      get_num_coalesced() const
+      { return m_num_coalesced.load(std::memory_order_relaxed); }
+
+    private:
+      /** Holder for the most recent unsent message with a particular key. */
+      struct Slot
+      {
+        Slot();
+
+        /** Coalescing key of this slot (zero if unclaimed), together with the number of
+            producers using the slot and the number of queue entries referencing it.  Claimed
+            by compare-and-swap from zero, and released the same way once both counts drop to
+            zero.  */
+        std::atomic<uint64_t> state;
+
+        /** Most recent unsent message with this slot's key, or null.  A queue entry
+            referencing this slot exists whenever this is set.  */
+        std::atomic<Message*> pending;
+      };
+
+      /** Entry in the underlying queue: either a message, or a reference to a slot from which
+          the message should be taken at the time it's popped.  */
+      struct Entry
+      {
+        Entry();
+        Entry(Message&& m);
+        Entry(Slot* s);
+
+        Message message;
+        Slot* slot;
+      };
+
+      /** Get the coalescing key for a message. */
+      static uint64_t get_key(const Message& m);
+
+      /** Find or claim the slot for a key, and register as one of its producers.
+       *
+       * @return The slot to use for @p key, or `nullptr` if every slot near the key's hash is
+       *     held by another key.
+       */
+      Slot* acquire_slot(uint64_t key);
+
+      /** Drop a producer or queue-entry reference to a slot, releasing the slot for other keys
+          if it was the last.  */
+      static void release_slot(Slot* slot, uint64_t reference);
+
+      crisp::util::MPSCQueue<Entry> m_queue;
+      crisp::util::ObjectPool<Message> m_messages; /**< Storage for slots' pending messages. */
+      std::atomic<QueuePolicy> m_policies[MESSAGE_TYPE_COUNT];
+      Slot m_slots[OUTGOING_QUEUE_COALESCING_SLOTS];
+      std::atomic<size_t> m_num_coalesced;
+      std::atomic<size_t> m_size;
+    };
+  }
+}
+
+#endif  /* crisp_comms_OutgoingQueue_hh */
@@ -0,0 +1,187 @@
+/** @file
+ *
+ * Declares SensorData, the body of SENSOR_DATA messages: a batch of timestamped sensor
+ * readings.
+ */
+#ifndef crisp_comms_SensorData_hh
+#define crisp_comms_SensorData_hh 1
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <crisp/comms/common.hh>
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/Sensor.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    struct Configuration;
+
+    /** A batch of timestamped samples from one or more sensors, sent by a slave node in a
+     * single SENSOR_DATA message so that high-rate sensors don't need a message per reading.
+     *
+     * An encoded batch holds
+     *
+     *   - the batch's base time (a `uint64_t`, in microseconds of the sender's clock), followed
+     *     by
+     *   - one or more runs of consecutive samples from a single sensor, each made up of the
+     *     sensor's module ID (`uint8_t`), sensor ID (`uint8_t`) and sample count (`uint16_t`),
+     *     then for each sample its time relative to the base time (`uint32_t`, in
+     *     microseconds) and its value (encoded as for the sensor's data type).
+     *
+     * Samples are kept in the order in which they were added; a new run is started whenever
+     * the sensor changes, so adding each sensor's samples together gives the smallest
+     * message.
+     *
+     * Sample values are stored in a single buffer owned by the batch, so neither decoding a
+     * batch nor adding samples to one allocates memory once the batch has grown to its working
+     * size.
+     */
+    struct SensorData
+    {
+      static const MessageType Type;
+
+      /** Size of the fixed part of an encoded batch (the base time). */
+      static const size_t HeaderSize;
+
+      /** Size of the header preceding each run of samples. */
+      static const size_t RunHeaderSize;
+
+      /** Largest encoded size a batch may have and still fit in a message. */
+      static const size_t MaxEncodedSize;
+
+      typedef SensorData TranscodeAsType;
+
+      /** A single sensor reading. */
+      struct Sample
+      {
+	uint8_t module_id;	/**< ID of the module the sensor belongs to. */
+	const Sensor<>* sensor;	/**< Sensor that produced the reading. */
+	uint64_t timestamp;	/**< Time of the reading, in microseconds of the sender's clock. */
+	size_t value_offset;	/**< Offset of the reading's value in the batch's value buffer. */
+      };
+
+      /** Constructor.
+       *
+       * @param _base_time Base time for the batch; samples added to it must not be older.
+       */
+      SensorData(uint64_t _base_time = 0);
+
+      SensorData(SensorData&&) = default;
+      SensorData(const SensorData&) = default;
+      SensorData& operator =(SensorData&&) = default;
+      SensorData& operator =(const SensorData&) = default;
+
+      /** Remove all samples, keeping the allocated storage.
+       *
+       * @param _base_time New base time for the batch.
+       */
+      void clear(uint64_t _base_time = 0);
+
+      /** Add a sample to the batch.
+       *
+       * @param module_id ID of the module to which @p sensor belongs.
+       *
+       * @param sensor Sensor that produced the reading.
+       *
+       * @param timestamp Time of the reading, in microseconds.
+       *
+       * @param value Pointer to the encoded value, of `sensor.data_type.width` bytes.
+       *
+       * @return `false` if the sample wasn't added because its timestamp is outside the range
+       *     representable relative to the base time, or because the batch is full and must be
+       *     sent first.
+       */
+      bool add(uint8_t module_id, const Sensor<>& sensor, uint64_t timestamp, const void* value);
+
+      /** Add a sample to the batch.  @p value's type must match the sensor's data type.
+       *
+       * @see add(uint8_t, const Sensor<>&, uint64_t, const void*)
+       */
+      template < typename _T >
+	inline bool
+	add(const Module& module, const Sensor<>& sensor, uint64_t timestamp, _T value)
+      { return sensor.data_type.width == sizeof(_T) && add(module.id, sensor, timestamp, &value); }
+
+      /** Get the value of a sample.  @p _T must match the sensor's data type. */
+      template < typename _T >
+	inline _T
+	get(const Sample& sample) const
+      {
+	_T out = _T();
+	if ( sample.sensor->data_type.width == sizeof(_T) )
+	  memcpy(&out, m_values.data() + sample.value_offset, sizeof(_T));
+	return out;
+      }
+
+      /** Get a pointer to the encoded value of a sample. */
+      inline const uint8_t*
+	value_data(const Sample& sample) const
+      { return m_values.data() + sample.value_offset; }
+
+      /** Get the space required for this object in encoded form. */
+      inline size_t
+	get_encoded_size() const
+      { return m_encoded_size; }
+
+      /** Check whether a sample of the given sensor would fit in the batch without exceeding
+       * `MaxEncodedSize`.
+       */
+      bool
+	has_room_for(uint8_t module_id, const Sensor<>& sensor) const;
+
+      bool
+	operator ==(const SensorData& sd) const;
+
+      /** Encode the batch into a byte buffer. */
+      EncodeResult
+	encode(MemoryEncodeBuffer& buf) const;
+
+      /** Decode a batch from a byte buffer, replacing this object's contents.
+       *
+       * @param buf Input buffer.
+       *
+       * @param config Configuration used to look up the sensors and their value types.  The
+       *     samples point into it, so it must outlive them.
+       */
+      DecodeResult
+	decode(DecodeBuffer& buf, const Configuration& config);
+
+      /** Decode a batch from a byte buffer, replacing this object's contents, and keep
+       * @p config alive in `configuration` for as long as the samples use it.
+       *
+       * @see decode(DecodeBuffer&, const Configuration&)
+       */
+      DecodeResult
+	decode(DecodeBuffer& buf, const std::shared_ptr<const Configuration>& config);
+
+      /** Decode a batch from a byte buffer, returning a copy of the instance. */
+      static inline TranscodeAsType
+	decode_copy(DecodeBuffer& buf, const Configuration& config)
+      { TranscodeAsType out; out.decode(buf, config);
+	return out; }
+
+      uint64_t base_time;		/**< Time to which sample times are relative. */
+      std::vector<Sample> samples;	/**< Samples in the batch, in the order added. */
+
+      /** Configuration into which the samples' sensor pointers point, if the batch was decoded
+	  by the overload of `decode` that shares ownership of it; null otherwise.  */
+      std::shared_ptr<const Configuration> configuration;
+
+    private:
+      /** Size of the encoded run header needed before a sample of the given sensor. */
+      size_t run_overhead(uint8_t module_id, const Sensor<>& sensor) const;
+
+      std::vector<uint8_t> m_values;	/**< Encoded sample values, back-to-back. */
+      size_t m_encoded_size;
+      uint16_t m_run_length;		/**< Number of samples in the last run. */
+    };
+  }
+}
+
+#endif	/* crisp_comms_SensorData_hh */
@@ -0,0 +1,246 @@
+/** @file
+ *
+ * Declares SensorHistory, a store of the recent readings of every sensor a master node hears
+ * from, and SensorSeries, the readings of a single sensor.
+ */
+#ifndef crisp_comms_SensorHistory_hh
+#define crisp_comms_SensorHistory_hh 1
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <crisp/comms/DataDeclaration.hh>
+#include <crisp/comms/Sensor.hh>
+#include <crisp/util/HistoryRing.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    struct SensorData;
+    struct Configuration;
+
+    /** Resolutions at which a sensor's history is kept. */
+    ENUM_CLASS(HistoryResolution, uint8_t,
+	       RAW,		/**< Every sample. */
+	       DECIMATED_10,	/**< One summary per ten samples. */
+	       DECIMATED_100	/**< One summary per hundred samples. */
+	       );
+
+    /** A single sensor reading, converted to `double`. */
+    struct SensorSample
+    {
+      uint64_t timestamp;	/**< Time of the reading, in microseconds of the sender's clock. */
+      double value;
+    };
+
+    /** Summary of a run of consecutive sensor readings. */
+    struct SensorSummary
+    {
+      uint64_t timestamp;	/**< Time of the first reading summarized. */
+      uint64_t count;		/**< Number of readings summarized. */
+      double minimum;
+      double maximum;
+      double mean;
+    };
+
+    /** History of a single sensor's readings, at each of the resolutions in
+     * `HistoryResolution`.  Every resolution keeps the same number of entries, so the
+     * decimated ones reach ten and a hundred times further back than the raw samples do.
+     *
+     * Readings are recorded by a single thread (the node's receive loop), and can be read by
+     * any number of threads at once without locking; see `crisp::util::HistoryRing`.  Queries
+     * by time rely on the readings being in timestamp order, so readings older than the newest
+     * one recorded (e.g. from datagrams delivered out of order) are dropped.
+     */
+    class SensorSeries
+    {
+    public:
+      /** Number of entries at each resolution summarized by one entry at the next. */
+      static constexpr size_t DecimationFactor = 10;
+
+      /** Constructor.
+       *
+       * @param _module_id ID of the module to which the sensor belongs.
+       *
+       * @param sensor Sensor whose readings will be recorded.
+       *
+       * @param capacity Number of entries to keep at each resolution.
+       */
+      SensorSeries(uint8_t _module_id, const Sensor<>& sensor, size_t capacity);
+
+      /** Constructor.
+       *
+       * @param _module_id ID of the module to which the sensor belongs.
+       *
+       * @param _sensor_id Sensor's ID within its module.
+       *
+       * @param _data_type Data type of the sensor's readings.
+       *
+       * @param capacity Number of entries to keep at each resolution.
+       */
+      SensorSeries(uint8_t _module_id, uint16_t _sensor_id, const DataDeclaration<>& _data_type,
+                   size_t capacity);
+
+      /** Check whether readings of a data type can be recorded: only scalar boolean, integer
+          and floating-point types can.  */
+      static bool
+      can_record(const DataDeclaration<>& type);
+
+      /** Convert an encoded reading to `double`.
+       *
+       * @param type Data type of the reading; must be one for which `can_record` is `true`.
+       *
+       * @param value Encoded reading.
+       */
+      static double
+      to_double(const DataDeclaration<>& type, const uint8_t* value);
+
+      /** Record a reading, unless it is older than the newest one recorded.  Writer only.
+       *
+       * @param timestamp Time of the reading.
+       *
+       * @param value Encoded reading, in the sensor's data type.
+       */
+      void
+      record(uint64_t timestamp, const uint8_t* value);
+
+      /** Get the time of the newest reading recorded, or zero if there are none. */
+      uint64_t
+      latest_timestamp() const;
+
+      /** Copy the raw readings taken at or after a given time.
+       *
+       * @param since Time of the earliest reading wanted.
+       *
+       * @param out Receives the readings, oldest first.  Its previous contents are discarded.
+       *
+       * @return Number of readings copied.
+       */
+      size_t
+      read(uint64_t since, std::vector<SensorSample>& out) const;
+
+      /** Copy the summaries, at a given resolution, of the readings taken at or after a given
+       * time.  At `HistoryResolution::RAW`, each summary covers a single reading.  Summaries
+       * cover only complete runs of readings, so the newest few readings are missing from the
+       * decimated resolutions.
+       *
+       * @param resolution Resolution wanted.
+       *
+       * @param since Time of the earliest reading wanted.
+       *
+       * @param out Receives the summaries, oldest first.  Its previous contents are discarded.
+       *
+       * @return Number of summaries copied.
+       */
+      size_t
+      read(HistoryResolution resolution, uint64_t since, std::vector<SensorSummary>& out) const;
+
+      /** Copy the summaries of the readings taken in a given period before the newest
+       * reading.
+       *
+       * @param resolution Resolution wanted.
+       *
+       * @param duration Length of the period, in microseconds.
+       *
+       * @param out Receives the summaries, oldest first.
+       *
+       * @return Number of summaries copied.
+       */
+      size_t
+      read_last(HistoryResolution resolution, uint64_t duration, std::vector<SensorSummary>& out) const;
+
+      const uint8_t module_id;		/**< ID of the module to which the sensor belongs. */
+      const uint16_t sensor_id;		/**< Sensor's ID within its module. */
+      const DataDeclaration<> data_type; /**< Data type of the sensor's readings. */
+
+    private:
+      /** Summary being accumulated for a decimated resolution. */
+      struct Accumulator
+      {
+        SensorSummary summary;
+        double sum;		/**< Sum of the readings summarized so far. */
+        size_t entries;		/**< Number of entries accumulated so far. */
+      };
+
+      /** Add an entry to the summary being accumulated at a decimated resolution, pushing it
+          (and passing it on to the next resolution) when complete.  Writer only.  */
+      void
+      accumulate(size_t level, const SensorSummary& entry);
+
+      crisp::util::HistoryRing<SensorSample> m_raw;
+      crisp::util::HistoryRing<SensorSummary> m_decimated[2];
+      Accumulator m_accumulators[2];
+      uint64_t m_latest;		/**< Time of the newest reading recorded.  Writer only. */
+    };
+
+    /** Store of the recent readings of each sensor in a node's configuration, keyed by module
+     * and sensor ID.  Each sensor gets a SensorSeries when a configuration declaring it is
+     * passed to `configure`; readings of sensors without one, and of sensors whose readings
+     * aren't scalar numbers (see `SensorSeries::can_record`), are ignored.
+     *
+     * The set of series is published as an immutable map that `configure` and `clear` replace
+     * as a whole, so `record` and `find` never lock.  `record` should only be called by one
+     * thread; the other methods are thread-safe.
+     */
+    class SensorHistory
+    {
+    public:
+      /** Default number of entries kept at each resolution, for each sensor. */
+      static constexpr size_t DefaultCapacity = 4096;
+
+      /** Constructor.
+       *
+       * @param _capacity Number of entries to keep at each resolution, for each sensor.
+       */
+      SensorHistory(size_t _capacity = DefaultCapacity);
+
+      SensorHistory(const SensorHistory&) = delete;
+      SensorHistory& operator =(const SensorHistory&) = delete;
+
+      /** Make a series for each sensor declared by a configuration.  Sensors declared with
+       * the same data type as before keep their series and readings; the series of sensors
+       * no longer declared (or whose data type changed) are dropped.
+       *
+       * @param config Configuration of the node whose readings will be recorded.
+       */
+      void
+      configure(const Configuration& config);
+
+      /** Record the readings in a batch of sensor data.  Readings of sensors that have no
+          series, or whose data type doesn't match their series', are ignored.  */
+      void
+      record(const SensorData& data);
+
+      /** Find the history of a sensor.
+       *
+       * @return The sensor's series, or null if the sensor hasn't been configured.  The
+       *     series remains valid as long as the caller holds it, but is no longer updated once
+       *     replaced (by `clear`, or by `configure` because the sensor's data type changed).
+       */
+      std::shared_ptr<const SensorSeries>
+      find(uint8_t module_id, uint16_t sensor_id) const;
+
+      /** Discard all recorded readings, keeping an empty series for each configured sensor. */
+      void
+      clear();
+
+      const size_t capacity;
+
+    private:
+      /** Series by module ID (high half) and sensor ID.  */
+      typedef std::map<uint32_t, std::shared_ptr<SensorSeries> > SeriesMap;
+
+      std::mutex m_update_mutex;	/**< Serializes `configure` and `clear`. */
+
+      /** Current set of series.  Never modified once published; always accessed with
+          `std::atomic_load` and `std::atomic_store`.  */
+      std::shared_ptr<const SeriesMap> m_series;
+    };
+  }
+}
+
+#endif  /* crisp_comms_SensorHistory_hh */
@@ -0,0 +1,124 @@
+/** @file
+ *
+ * Declares SensorPoll, the body of SENSOR_POLL messages: a request for the current readings
+ * of a set of sensors.
+ */
+#ifndef crisp_comms_SensorPoll_hh
+#define crisp_comms_SensorPoll_hh 1
+
+#include <cstdint>
+#include <vector>
+
+#include <crisp/comms/common.hh>
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/Sensor.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    /** Request, sent by a master node, for the current readings of a set of sensors on the
+     * slave -- normally those with `SensorReportingMode::POLL`.  The slave answers a poll with
+     * a single SENSOR_DATA message holding a reading from each of the sensors named (see
+     * `SensorReaders`), so polling any number of sensors takes one round trip.
+     *
+     * An encoded poll holds, for each module with sensors polled, the module ID (`uint8_t`),
+     * the length of its sensor bit-map in bytes (`uint8_t`), and the bit-map itself, in which
+     * bit `i % 8` of byte `i / 8` is set if sensor `i` is polled.
+     */
+    struct SensorPoll
+    {
+      static const MessageType Type;
+
+      typedef SensorPoll TranscodeAsType;
+
+      /** Largest number of sensors per module that can be polled. */
+      static constexpr size_t MaxSensors = 256;
+
+      /** Polled sensors of a single module. */
+      struct ModuleSensors
+      {
+	uint8_t module_id;
+	uint8_t length;			/**< Number of bytes used in `bitmap`. */
+	uint8_t bitmap[MaxSensors / 8];
+      };
+
+      SensorPoll();
+
+      /** Add a sensor to the poll.
+       *
+       * @return `*this` for additional calls to add.
+       */
+      SensorPoll&
+	add(uint8_t module_id, uint16_t sensor_id);
+
+      SensorPoll&
+	add(const Module& module, const Sensor<>& sensor);
+
+      /** Remove a sensor from the poll.
+       *
+       * @return `*this`.
+       */
+      SensorPoll&
+	remove(uint8_t module_id, uint16_t sensor_id);
+
+      /** Check whether a sensor is polled. */
+      bool
+	contains(uint8_t module_id, uint16_t sensor_id) const;
+
+      /** Get the number of sensors polled. */
+      size_t
+	size() const;
+
+      /** Check whether no sensors are polled. */
+      inline bool
+	empty() const
+      { return modules.empty(); }
+
+      /** Remove all sensors from the poll. */
+      inline void
+	clear()
+      { modules.clear(); }
+
+      /** Call a function for each sensor polled, in order of module and sensor ID.
+       *
+       * @param function Function to call, as `function(module_id, sensor_id)`.
+       */
+      template < typename _Function >
+	inline void
+	for_each(_Function function) const
+      {
+	for ( const ModuleSensors& ms : modules )
+	  for ( size_t byte ( 0 ); byte < ms.length; ++byte )
+	    for ( uint8_t bits ( ms.bitmap[byte] ); bits; bits &= bits - 1 )
+	      function(ms.module_id, static_cast<uint16_t>(8 * byte + __builtin_ctz(bits)));
+      }
+
+      /** Get the space required for this object in encoded form. */
+      size_t
+	get_encoded_size() const;
+
+      bool
+	operator ==(const SensorPoll& poll) const;
+
+      /** Encode the poll into a byte buffer. */
+      EncodeResult
+	encode(MemoryEncodeBuffer& buf) const;
+
+      /** Decode a poll from a byte buffer, replacing this object's contents. */
+      DecodeResult
+	decode(DecodeBuffer& buf);
+
+      /** Decode a poll from a byte buffer, returning a copy of the instance. */
+      static inline TranscodeAsType
+	decode_copy(DecodeBuffer& buf)
+      { TranscodeAsType out; out.decode(buf);
+	return out; }
+
+      std::vector<ModuleSensors> modules; /**< Polled sensors, by module; sorted by module ID. */
+    };
+  }
+}
+
+#endif	/* crisp_comms_SensorPoll_hh */
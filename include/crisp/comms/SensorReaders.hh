@@ -0,0 +1,93 @@
+/** @file
+ *
+ * Declares SensorReaders, the table of functions a slave node uses to answer sensor polls.
+ */
+#ifndef crisp_comms_SensorReaders_hh
+#define crisp_comms_SensorReaders_hh 1
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/Sensor.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    struct Configuration;
+    struct SensorData;
+    struct SensorPoll;
+
+    /** Functions that take readings from a slave's sensors, used to answer SENSOR_POLL
+     * messages with a batch of readings from the sensors polled.  Sensors without a reader are
+     * left out of the answer.
+     *
+     * All methods are thread-safe.  Reader functions are called with the table locked, so
+     * must not modify it.
+     */
+    class SensorReaders
+    {
+    public:
+      /** Reader function: stores a reading, encoded in the sensor's data type, at the location
+       * given, and returns `true` -- or returns `false` if no reading is available.
+       */
+      typedef std::function<bool(void* value)> Function;
+
+      SensorReaders();
+
+      SensorReaders(const SensorReaders&) = delete;
+      SensorReaders& operator =(const SensorReaders&) = delete;
+
+      /** Set the reader for a sensor, replacing any previous one.
+       *
+       * @param module_id ID of the module to which the sensor belongs.
+       *
+       * @param sensor_id ID of the sensor within its module.
+       *
+       * @param function Reader function.
+       */
+      void
+      set(uint8_t module_id, uint16_t sensor_id, Function function);
+
+      /** Set the reader for a sensor to a function returning its reading.  @p _T must match
+          the sensor's data type.  */
+      template < typename _T >
+      inline void
+      set(const Module& module, const Sensor<>& sensor, std::function<_T()> function)
+      {
+        set(module.id, sensor.id,
+            [function](void* value) { _T v ( function() );
+                                      memcpy(value, &v, sizeof(v));
+                                      return true; });
+      }
+
+      /** Remove the reader for a sensor. */
+      void
+      remove(uint8_t module_id, uint16_t sensor_id);
+
+      /** Take a reading from each sensor named in a poll.
+       *
+       * @param poll Sensors to read.
+       *
+       * @param config Configuration declaring the sensors.
+       *
+       * @param out Batch to which to add the readings, all timestamped with its base time.
+       *
+       * @return Number of readings taken.
+       */
+      size_t
+      read(const SensorPoll& poll, const Configuration& config, SensorData& out) const;
+
+    private:
+      mutable std::mutex m_mutex;
+      std::map<uint32_t, Function> m_readers; /**< Readers by module ID (high half) and sensor
+                                                   ID.  */
+    };
+  }
+}
+
+#endif  /* crisp_comms_SensorReaders_hh */
@@ -13,30 +13,183 @@
 #include <boost/asio/read_until.hpp>
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/streambuf.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <deque>
+#include <random>
+#include <vector>
 
 
 namespace crisp
 {
   namespace comms
   {
+    namespace detail
+    {
+      /** Kinds of datagram sent by datagram-protocol nodes. */
+      ENUM_CLASS(DatagramKind, uint8_t,
+                 DATA,          /**< Unreliable: any number of messages. */
+                 RELIABLE,      /**< Reliable channel: exactly one message. */
+                 ACK            /**< Reliable-channel acknowledgement: no messages. */
+                 );
+
+      /** Header at the start of every datagram. */
+      struct __attribute__ (( packed ))
+      DatagramHeader
+      {
+        DatagramKind kind;
+
+        /** Nonzero ID chosen by the sending node each time it launches, so that the receiver
+            can tell a restarted node from one that is still retransmitting.  */
+        uint32_t session;
+
+        /** For DATA datagrams, a count of DATA datagrams sent; for RELIABLE and ACK datagrams,
+            the reliable-channel sequence number of the message sent or acknowledged.  */
+        uint32_t sequence;
+      };
+
+      /** Choose a random, nonzero datagram session ID. */
+      static inline uint32_t
+      new_datagram_session()
+      {
+        std::random_device device;
+        uint32_t session ( device() ^ static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()) );
+        return session ? session : 1;
+      }
+
+      /** Check if messages of a given type are sent over a datagram node's reliable
+          channel.  */
+      static inline bool
+      is_reliable_type(MessageType type)
+      {
+        switch ( type )
+          {
+          case MessageType::HANDSHAKE:
+          case MessageType::HANDSHAKE_RESPONSE:
+          case MessageType::CONFIGURATION_QUERY:
+          case MessageType::CONFIGURATION_RESPONSE:
+            return true;
+          default:
+            return false;
+          }
+      }
+
+      /** Compare sequence numbers, allowing for wrap-around.
+       *
+       * @return `true` if @p a is later than @p b.
+       */
+      static inline bool
+      sequence_after(uint32_t a, uint32_t b)
+      { return static_cast<int32_t>(a - b) > 0; }
+
+      /** Header and stamp sent in place of a stamped message's plain header. */
+      struct __attribute__ (( packed ))
+      StampedPrefix
+      {
+        Message::Header header;
+        Message::Stamp stamp;
+      };
+
+      /** Read the clock used for message stamps.
+       *
+       * @return Microseconds since the steady clock's epoch.
+       */
+      static inline uint64_t
+      stamp_clock()
+      {
+        return std::chrono::duration_cast<std::chrono::microseconds>
+          (std::chrono::steady_clock::now().time_since_epoch()).count();
+      }
+
+      /** Check whether a received message header has its stamped flag set, and clear it.
+       *
+       * @return `true` if the message is stamped.
+       */
+      static inline bool
+      take_stamped_flag(Message::Header& header)
+      {
+        uint8_t type ( static_cast<uint8_t>(header.type) );
+        header.type = static_cast<MessageType>(type & ~Message::StampedFlag);
+        return type & Message::StampedFlag;
+      }
+
+      /** Copy out the stamp of a complete stamped message, and write the message's plain
+       * header over the stamp's last bytes -- just before the body -- so that the message can
+       * then be decoded in place as if it had never been stamped.
+       *
+       * @param buf Buffer holding the message.
+       *
+       * @param begin Offset of the message in @p buf; advanced to the plain header.
+       *
+       * @param header The message's header, with its stamped flag already cleared.  Its
+       *     length is reduced by the size of the stamp.
+       *
+       * @param stamp Receives the message's stamp.
+       */
+      static inline void
+      strip_stamp(crisp::util::Buffer& buf, size_t& begin, Message::Header& header,
+                  Message::Stamp& stamp)
+      {
+        header.length -= sizeof(Message::Stamp);
+        memcpy(&stamp, buf.data + begin + sizeof(Message::Header), sizeof(stamp));
+        begin += sizeof(Message::Stamp);
+        memcpy(buf.data + begin, &header, sizeof(header));
+      }
+    }
+
+    template < typename _Protocol >
+    constexpr bool BasicNode<_Protocol>::UsesDatagrams;
+
     template < typename _Protocol >
-    BasicNode<_Protocol>::BasicNode(typename _Protocol::socket&& _socket, NodeRole _role)
-      : WorkerObject ( _socket.get_io_service(), 6 ),
+    BasicNode<_Protocol>::BasicNode(typename _Protocol::socket&& _socket, NodeRole _role,
+                                    crisp::util::RefTraits<crisp::util::BufferPool>::stored_ref _buffer_pool,
+                                    size_t _num_worker_threads)
+      : WorkerObject ( _socket.get_io_service(), _num_worker_threads ),
         m_socket ( std::move(_socket) ),
         m_sync_action ( ),
         m_halt_action ( ),
         m_outgoing_queue ( ),
+        m_send_strand ( m_io_service ),
+        m_batching { 16, 16384, std::chrono::microseconds(0) },
+        m_send_wake_timer ( m_io_service ),
+        m_send_waiting ( false ),
         m_halting ( ),
         m_stopped ( false ),
         m_halt_mutex ( ),
         m_halt_cv ( ),
         m_disconnect_signal ( _socket.get_io_service() ),
         m_disconnect_emitted ( ),
+        m_reliable_acked ( 0 ),
+        m_reliable_ack_due ( 0 ),
+        m_reliable_ack_pending ( false ),
+        m_control_sequence { },
+        m_control_received ( ),
+        m_num_stale_dropped ( 0 ),
+        m_metrics ( ),
+        m_metrics_dump_action ( ),
+        m_stamps_requested ( false ),
+        m_stamping ( false ),
+        m_stamp_sequence { },
+        m_compact_requested ( false ),
+        m_compacting ( false ),
+        m_compact_encoder ( ),
+        m_compact_decoder ( ),
+        m_compact_configuration ( ),
+        m_configuration_cache ( ),
+        m_remote_configuration_digest ( 0 ),
+        m_remote_handshake_received ( false ),
+        m_configuration_requested ( false ),
+        m_poll_mutex ( ),
+        m_poll_groups ( ),
         stopped ( m_stopped ),
         scheduler ( m_io_service ),
         role ( _role ),
         configuration ( ),
-        dispatcher ( *this )
+        dispatcher ( *this ),
+        buffer_pool ( _buffer_pool ? _buffer_pool : new crisp::util::BufferPool() )
     {
       m_halting.clear();
       m_disconnect_emitted.clear();
@@ -55,6 +208,25 @@ namespace crisp
     }
 
 
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::dump_metrics(std::chrono::milliseconds interval, FILE* stream)
+    {
+      if ( ! m_metrics_dump_action.expired() )
+        scheduler.remove(m_metrics_dump_action);
+      m_metrics_dump_action.reset();
+
+      if ( interval.count() > 0 )
+        m_metrics_dump_action =
+          scheduler.schedule(interval,
+                             [this, stream](crisp::util::PeriodicAction&)
+                             {
+                               fprintf(stream, "[0x%x][Node] Metrics:\n", THREAD_ID);
+                               m_metrics.snapshot().print(stream, "    ");
+                             });
+    }
+
+
     template < typename _Protocol >
     void
     BasicNode<_Protocol>::run()
@@ -82,14 +254,21 @@ namespace crisp
          -- it has something to do with threading and having something for the
          worker threads to do (maybe also having worker threads already
          available for the coroutine spawns?).  */
-      send(Handshake { PROTOCOL_VERSION, role });
+      send(Handshake { PROTOCOL_VERSION, role,
+                       static_cast<uint8_t>((m_stamps_requested ? Handshake::FEATURE_MESSAGE_STAMPS : 0) |
+                                            (m_compact_requested ? Handshake::FEATURE_COMPACT_CONTROL : 0)),
+                       role == NodeRole::SLAVE ? dispatcher.configuration_cache.get_digest(configuration) : 0 });
+
+      if ( m_compact_requested )
+        std::atomic_store(&m_compact_configuration,
+                          std::shared_ptr<const Configuration>(std::make_shared<Configuration>(configuration)));
 
       WorkerObject::launch();
 
       boost::asio::spawn(m_io_service, std::bind(&BasicNode::receive_loop, this,
                                                  std::placeholders::_1));
-      boost::asio::spawn(m_io_service, std::bind(&BasicNode::send_loop, this,
-                                                 std::placeholders::_1));
+      boost::asio::spawn(m_send_strand, std::bind(&BasicNode::send_loop, this,
+                                                  std::placeholders::_1));
 
       /* The default `handshake_response.received` handler will cancel this
          action on successful handshake sequence. */
@@ -127,12 +306,7 @@ namespace crisp
           fflush_unlocked(stderr); /* make sure we print diagnostics in the
                                       right order. */
 
-          if ( m_outgoing_queue.num_waiters() > 0 )
-            {
-              //fprintf(stderr, "waking all threads waiting on outgoing messages... ");
-              m_outgoing_queue.wake_all();
-              //fprintf(stderr, "done.\n");
-            }
+          wake_send_loop();
 
           if ( m_socket.is_open() )
             {
@@ -166,8 +340,27 @@ namespace crisp
             }
 
 
+          if ( ! m_metrics_dump_action.expired() )
+            {
+              auto ptr ( m_metrics_dump_action.lock() );
+              if ( ptr )
+                ptr->cancel();
+            }
+
+          {
+            std::unique_lock<std::mutex> lock ( m_poll_mutex );
+            for ( auto& pair : m_poll_groups )
+              {
+                auto ptr ( pair.second.action.lock() );
+                if ( ptr )
+                  ptr->cancel();
+              }
+            m_poll_groups.clear();
+          }
+
           m_sync_action.reset();
           m_halt_action.reset();
+          m_metrics_dump_action.reset();
 
           //fprintf(stderr, "Halting all worker threads... ");
           WorkerObject::halt();
@@ -187,88 +380,650 @@ namespace crisp
     void
     BasicNode<_Protocol>::send(const Message& m)
     {
-      m_outgoing_queue.push(m);
+      if ( m_stamps_requested )
+        {
+          Message copy ( m );
+          copy.queued_at = detail::stamp_clock();
+          m_outgoing_queue.push(std::move(copy));
+        }
+      else
+        m_outgoing_queue.push(m);
+      m_metrics.set_queue_depth(m_outgoing_queue.size());
+      if ( m_send_waiting.load() && m_send_waiting.exchange(false) )
+        wake_send_loop();
     }
 
     template < typename _Protocol >
     void
     BasicNode<_Protocol>::send(Message&& m)
     {
+      if ( m_stamps_requested )
+        m.queued_at = detail::stamp_clock();
       m_outgoing_queue.push(std::move(m));
+      m_metrics.set_queue_depth(m_outgoing_queue.size());
+      if ( m_send_waiting.load() && m_send_waiting.exchange(false) )
+        wake_send_loop();
+    }
+
+    template < typename _Protocol >
+    bool
+    BasicNode<_Protocol>::stamp(const Message& m, detail::StampedPrefix& prefix, uint64_t now)
+    {
+      /* SYNC messages must stay recognizable to the receive loop's resync scan.  */
+      if ( m.header.type == MessageType::SYNC ||
+           m.header.length > UINT16_MAX - sizeof(Message::Stamp) )
+        return false;
+
+      prefix.header.length = m.header.length + sizeof(Message::Stamp);
+      prefix.header.type = static_cast<MessageType>(static_cast<uint8_t>(m.header.type) | Message::StampedFlag);
+      prefix.stamp.sequence = ++m_stamp_sequence[static_cast<size_t>(m.header.type)];
+      prefix.stamp.queue_delay = m.queued_at ? std::min<uint64_t>(now - m.queued_at, UINT32_MAX) : 0;
+      prefix.stamp.sent_at = now;
+      return true;
+    }
+
+    template < typename _Protocol >
+    bool
+    BasicNode<_Protocol>::handle_remote_handshake(const Message& m)
+    {
+      Handshake hs;
+      bool ok ( m.body );
+      if ( ok )
+        {
+          DecodeBuffer db ( m.body );
+          ok = hs.decode(db) == DecodeResult::SUCCESS;
+        }
+      if ( ! ok )
+        {
+          m_metrics.record_decode_error();
+          return false;
+        }
+
+      bool stamping ( m_stamps_requested && (hs.features & Handshake::FEATURE_MESSAGE_STAMPS) );
+      if ( stamping && ! m_stamping.exchange(true) )
+        fprintf(stderr, "[0x%x][Node] Stamping outgoing messages.\n", THREAD_ID);
+
+      bool compacting ( m_compact_requested && (hs.features & Handshake::FEATURE_COMPACT_CONTROL) );
+      if ( compacting && ! m_compacting.exchange(true) )
+        fprintf(stderr, "[0x%x][Node] Compacting outgoing module controls.\n", THREAD_ID);
+
+      /* `request_configuration` does the same in the opposite order, so exactly one of us
+         sees both flags set.  */
+      m_remote_configuration_digest = hs.configuration_digest;
+      m_remote_handshake_received = true;
+      if ( m_configuration_requested.exchange(false) )
+        fetch_configuration();
+      return true;
     }
 
     template < typename _Protocol >
     void
-    BasicNode<_Protocol>::send_loop(boost::asio::yield_context yield)
+    BasicNode<_Protocol>::use_configuration_cache(const std::string& directory)
+    { m_configuration_cache.reset(new ConfigurationDiskCache(directory)); }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::request_configuration()
+    {
+      m_configuration_requested = true;
+      if ( m_remote_handshake_received && m_configuration_requested.exchange(false) )
+        fetch_configuration();
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::fetch_configuration()
+    {
+      /* Loading from disk may block, so keep it off the receive loop.  */
+      m_io_service.post
+        ([this]()
+         {
+           uint64_t digest ( m_remote_configuration_digest.load() );
+           Message cached;
+           if ( m_configuration_cache && digest && m_configuration_cache->load(digest, cached) )
+             {
+               fprintf(stderr, "[0x%x][Node] Using cached configuration %016" PRIx64 ".\n", THREAD_ID, digest);
+               use_remote_configuration(cached);
+               dispatcher.dispatch(std::move(cached), MessageDirection::INCOMING);
+             }
+           else
+             send(MessageType::CONFIGURATION_QUERY);
+         });
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::handle_configuration_response(const Message& m)
+    {
+      use_remote_configuration(m);
+      if ( ! m_configuration_cache )
+        return;
+
+      Message copy ( m );
+      m_io_service.post
+        ([this, copy]()
+         {
+           if ( ! m_configuration_cache->store(copy) )
+             fprintf(stderr, "[0x%x][Node] Failed to cache configuration in \"%s\": %s\n", THREAD_ID,
+                     m_configuration_cache->directory.c_str(), strerror(errno));
+         });
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::use_remote_configuration(const Message& m)
+    {
+      if ( ! m.body )
+        return;
+
+      std::shared_ptr<Configuration> config ( std::make_shared<Configuration>() );
+      DecodeBuffer db ( m.body );
+      if ( config->decode(db) != DecodeResult::SUCCESS )
+        return;
+
+      std::shared_ptr<const Configuration> snapshot ( std::move(config) );
+      if ( dispatcher.sensor_history )
+        dispatcher.sensor_history->configure(*snapshot);
+      std::atomic_store(&dispatcher.remote_configuration, snapshot);
+      if ( m_compact_requested )
+        std::atomic_store(&m_compact_configuration, snapshot);
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::keep_sensor_history(size_t capacity)
+    {
+      dispatcher.sensor_history = std::make_shared<SensorHistory>(capacity);
+      dispatcher.sensor_history->configure(configuration);
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::poll_sensor(uint8_t module_id, uint16_t sensor_id,
+                                      crisp::util::Scheduler::Slot::Duration interval)
+    {
+      std::unique_lock<std::mutex> lock ( m_poll_mutex );
+      remove_from_poll_groups(module_id, sensor_id);
+
+      PollGroup& group ( m_poll_groups[interval] );
+      group.poll.add(module_id, sensor_id);
+      if ( group.action.expired() )
+        group.action =
+          scheduler.schedule(interval,
+                             [this, interval](crisp::util::PeriodicAction&)
+                             {
+                               std::unique_lock<std::mutex> lock ( m_poll_mutex );
+                               auto it ( m_poll_groups.find(interval) );
+                               if ( it != m_poll_groups.end() && ! it->second.poll.empty() )
+                                 send(it->second.poll);
+                             });
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::stop_polling(uint8_t module_id, uint16_t sensor_id)
     {
-      bool aborted ( false );
+      std::unique_lock<std::mutex> lock ( m_poll_mutex );
+      remove_from_poll_groups(module_id, sensor_id);
+    }
 
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::remove_from_poll_groups(uint8_t module_id, uint16_t sensor_id)
+    {
+      for ( auto it ( m_poll_groups.begin() ); it != m_poll_groups.end(); ++it )
+        if ( it->second.poll.contains(module_id, sensor_id) )
+          {
+            it->second.poll.remove(module_id, sensor_id);
+            if ( it->second.poll.empty() )
+              {
+                auto ptr ( it->second.action.lock() );
+                if ( ptr )
+                  ptr->cancel();
+                m_poll_groups.erase(it);
+              }
+            return;
+          }
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::gather(const Message& m, Message& compacted, detail::StampedPrefix& prefix,
+                                 std::vector<boost::asio::const_buffer>& buffers, bool stamping, uint64_t now,
+                                 const Configuration* compact_config)
+    {
+      /* Delta encoding relies on every message arriving, in order.  */
+      const Message* wire ( &m );
+      if ( m.header.type == MessageType::MODULE_CONTROL && compact_config &&
+           m_compact_encoder.compact(m, *compact_config, ! UsesDatagrams, buffer_pool.get(), compacted) )
+        wire = &compacted;
+
+      Message::Segment segments[Message::MaxSegments];
+      size_t num_segments ( wire->get_segments(segments) ), first ( 0 );
+      if ( stamping && stamp(*wire, prefix, now) )
+        {
+          buffers.push_back(boost::asio::buffer(&prefix, sizeof(detail::StampedPrefix)));
+          first = 1;
+        }
+      for ( size_t i ( first ); i < num_segments; ++i )
+        buffers.push_back(boost::asio::buffer(segments[i].data, segments[i].length));
+    }
+
+    template < typename _Protocol >
+    bool
+    BasicNode<_Protocol>::expand_compact(Message& m)
+    {
+      Message expanded;
+      std::shared_ptr<const Configuration> config ( std::atomic_load(&m_compact_configuration) );
+      if ( ! config || ! m_compact_decoder.expand(m, *config, buffer_pool.get(), expanded) )
+        {
+          m_metrics.record_decode_error();
+          return false;
+        }
+      m = std::move(expanded);
+      return true;
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::wake_send_loop()
+    {
+      m_send_strand.post([this]() { m_send_wake_timer.cancel(); });
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::send_loop(boost::asio::yield_context yield)
+    {
       fprintf(stderr, "[0x%x][Node] Entered send loop.\n", THREAD_ID);
+
+      if ( UsesDatagrams )
+        datagram_send_loop(yield);
+      else
+        stream_send_loop(yield);
+
+      fprintf(stderr, "[0x%x][Node] Exiting send loop.\n", THREAD_ID);
+
+      if ( ! m_stopped )
+        m_io_service.post(std::bind(&BasicNode::halt, this, false));
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::stream_send_loop(boost::asio::yield_context yield)
+    {
+      /* Messages in the current batch, their compact forms and stamped headers (where sent),
+         and the gather list describing their encoded form.  All are reused from one write to
+         the next so that steady-state operation doesn't allocate.  */
+      std::vector<Message> batch;
+      std::vector<Message> compacted;
+      std::vector<boost::asio::const_buffer> buffers;
+      std::vector<detail::StampedPrefix> prefixes;
+      boost::asio::steady_timer delay_timer ( m_io_service );
+
+      Message message;
       while ( ! m_stopped )
         {
-          /* Fetch the next message to send, waiting if necessary. */
-          Message message ( m_outgoing_queue.next(&aborted) );
+          /* Fetch the next message to send, or wait for one.  `send` only wakes us if it
+             sees `m_send_waiting` set, so set it *before* the final check of the queue;
+             and since wake-ups run on our strand, they can't slip in between that check and
+             the start of the wait.  */
+          if ( ! m_outgoing_queue.try_pop(message) )
+            {
+              m_send_waiting = true;
+              if ( m_outgoing_queue.try_pop(message) )
+                m_send_waiting = false;
+              else
+                {
+                  boost::system::error_code wec;
+                  m_send_wake_timer.expires_at(std::chrono::steady_clock::time_point::max());
+                  m_send_wake_timer.async_wait(yield[wec]);
+                  continue;
+                }
+            }
 
-          if ( aborted || m_stopped )
+          /* `buffers` points into the Message objects in `batch`, so make sure the latter
+             won't reallocate while we fill it.  `set_batching` may run while we wait below,
+             so the whole batch uses this copy of the parameters.  */
+          const BatchingParameters params ( m_batching );
+          const size_t max_messages ( std::max<size_t>(1, params.max_messages) );
+          batch.clear();
+          batch.reserve(max_messages);
+          buffers.clear();
+          buffers.reserve(max_messages * Message::MaxSegments);
+
+          size_t batch_bytes ( message.get_encoded_size() );
+          batch.push_back(std::move(message));
+
+          /* Take whatever else is already queued, up to the batch limits -- waiting (once) for
+             more to arrive if we've been asked to.  */
+          bool waited ( false );
+          while ( batch.size() < max_messages && batch_bytes < params.max_bytes )
+            {
+              if ( m_outgoing_queue.try_pop(message) )
+                {
+                  batch_bytes += message.get_encoded_size();
+                  batch.push_back(std::move(message));
+                }
+              else if ( ! waited && params.max_delay.count() > 0 )
+                {
+                  boost::system::error_code tec;
+                  delay_timer.expires_from_now(params.max_delay);
+                  delay_timer.async_wait(yield[tec]);
+                  waited = true;
+                }
+              else
+                break;
+            }
+
+          if ( m_stopped )
             break;
 
-          /* Encode it. */
-          MemoryEncodeBuffer meb ( message.get_encoded_size() );
-          EncodeResult er;
-          if ( (er = message.encode(meb)) != EncodeResult::SUCCESS )
-            { fprintf(stderr, "error encoding message: %s.\n", encode_result_to_string(er));
-              continue; }
+          /* Hand the header, body, and checksum of each message to the socket as-is; there's
+             no need to encode them into an intermediate buffer first.  Compacted messages are
+             sent in their compact form, and stamped messages get a stamped header in place of
+             their own.  The compact forms and prefixes are sized up front, since the gather
+             list points into them.  */
+          const bool stamping ( m_stamping.load() );
+          const uint64_t now ( stamping ? detail::stamp_clock() : 0 );
+          std::shared_ptr<const Configuration> compact_config;
+          if ( m_compacting.load(std::memory_order_relaxed) )
+            compact_config = std::atomic_load(&m_compact_configuration);
+          compacted.clear();
+          compacted.resize(batch.size());
+          prefixes.clear();
+          prefixes.resize(batch.size());
+          for ( size_t i ( 0 ); i < batch.size(); ++i )
+            gather(batch[i], compacted[i], prefixes[i], buffers, stamping, now, compact_config.get());
+
+          /* `async_write` would split the gather list into chunks of (at most) sixteen buffers,
+             costing a syscall per five or so messages; write it out ourselves instead so that
+             each syscall gets as many buffers as the platform allows.  */
+          boost::system::error_code ec;
+          while ( ! buffers.empty() && ! ec )
+            {
+              size_t n ( m_socket.async_send(buffers, yield[ec]) );
+              while ( ! buffers.empty() && (n > 0 || boost::asio::buffer_size(buffers.front()) == 0) )
+                {
+                  size_t length ( boost::asio::buffer_size(buffers.front()) );
+                  if ( n < length )
+                    {
+                      buffers.front() = buffers.front() + n;
+                      n = 0;
+                    }
+                  else
+                    {
+                      buffers.erase(buffers.begin());
+                      n -= length;
+                    }
+                }
 
-          /* Dump the message contents. */
-          /* for ( size_t i = 0; i < meb.offset; ++i )
-           *   fprintf(stderr, " %02hhX", meb.data[i]);
-           * fputs("\n", stderr); */
+              /* Part of the batch may already be on the wire, so carry on with the rest of it
+                 -- and only the rest -- once the socket can take more.  */
+              if ( ec.value() == boost::asio::error::try_again )
+                {
+                  ec.clear();
+                  m_socket.async_send(boost::asio::null_buffers(), yield[ec]);
+                }
+            }
+
+          if ( ec )
+            {
+              /* Only print the associated error string if it's something
+                 interesting -- i.e., something besides "the connection
+                 was closed".  */
+              if ( ec.value() != boost::asio::error::operation_aborted &&
+                   ec.value() != boost::asio::error::bad_descriptor &&
+                   ec.value() != boost::asio::error::connection_aborted &&
+                   ec.value() != boost::asio::error::connection_reset )
+                fprintf(stderr, "error writing message: %s\n", strerror(ec.value()));
+
+              break;
+            }
+          else
+            {
+              m_metrics.set_queue_depth(m_outgoing_queue.size());
+              for ( size_t i ( 0 ); i < batch.size(); ++i )
+                {
+                  /* Messages that weren't compacted or stamped left theirs empty.  */
+                  const Message& sent ( compacted[i].body ? compacted[i] : batch[i] );
+                  size_t sent_size ( sent.get_encoded_size() );
+                  if ( prefixes[i].header.length )
+                    sent_size += sizeof(Message::Stamp);
+                  m_metrics.record_outgoing(sent.header.type, sent_size);
+                  dispatcher.dispatch(std::move(batch[i]), MessageDirection::OUTGOING);
+                }
+            }
+        }
+    }
 
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::datagram_send_loop(boost::asio::yield_context yield)
+    {
+      using detail::DatagramHeader;
+      using detail::DatagramKind;
+      typedef std::chrono::steady_clock Clock;
+
+      /* Messages waiting for the reliable channel; the first of them is in flight (i.e. has
+         been sent at least once) whenever `reliable_tries` is nonzero.  */
+      std::deque<Message> reliable;
+      uint32_t reliable_sequence ( 0 );
+      unsigned int reliable_tries ( 0 );
+      Clock::time_point retransmit_at;
+
+      /* Messages in the current DATA datagram, their compact forms and stamped headers, and
+         its gather list.  As in the stream send loop, all are reused from one datagram to the
+         next.  */
+      std::vector<Message> batch;
+      std::vector<Message> compacted;
+      std::vector<boost::asio::const_buffer> buffers;
+      std::vector<detail::StampedPrefix> prefixes;
+      DatagramHeader header;
+      header.session = detail::new_datagram_session();
+      uint32_t data_sequence ( 0 );
+
+      /* `message` holds a message that's been popped from the outgoing queue but not yet
+         sent whenever `held` is set.  */
+      Message message;
+      bool held ( false );
+
+      /* Send a datagram, ignoring errors caused by the remote node not (yet) listening.
+         Returns `false` if the node should stop sending.  */
+      auto send_datagram =
+        [&]()
+        {
           boost::system::error_code ec;
-          boost::asio::async_write(m_socket, boost::asio::buffer(meb.data, meb.offset), yield[ec]);
+          m_socket.async_send(buffers, yield[ec]);
+          if ( ! ec || ec.value() == boost::asio::error::connection_refused )
+            return true;
+          if ( ec.value() == boost::asio::error::message_size )
+            {
+              fprintf(stderr, "[0x%x][Node] Dropping message too large for a datagram.\n", THREAD_ID);
+              return true;
+            }
 
-          if ( ec )
+          if ( ec.value() != boost::asio::error::operation_aborted &&
+               ec.value() != boost::asio::error::bad_descriptor )
+            fprintf(stderr, "error writing message: %s\n", strerror(ec.value()));
+          return false;
+        };
+
+      /* Build the gather list for a single-message datagram. */
+      auto set_buffers =
+        [&](DatagramKind kind, uint32_t sequence, const Message* m)
+        {
+          header.kind = kind;
+          header.sequence = sequence;
+          buffers.clear();
+          buffers.push_back(boost::asio::buffer(&header, sizeof(header)));
+          if ( m )
             {
-              if ( ec.value() != boost::asio::error::try_again )
+              Message::Segment segments[Message::MaxSegments];
+              size_t num_segments ( m->get_segments(segments) );
+              for ( size_t i ( 0 ); i < num_segments; ++i )
+                buffers.push_back(boost::asio::buffer(segments[i].data, segments[i].length));
+            }
+        };
+
+      while ( ! m_stopped )
+        {
+          /* Acknowledge whatever the remote node last sent on its reliable channel. */
+          if ( m_reliable_ack_pending.load() && m_reliable_ack_pending.exchange(false) )
+            {
+              set_buffers(DatagramKind::ACK, m_reliable_ack_due.load(), nullptr);
+              if ( ! send_datagram() )
+                break;
+            }
+
+          /* Retire the in-flight reliable message once it's been acknowledged, and send (or
+             re-send) the next one when it's due.  */
+          if ( reliable_tries > 0 && ! detail::sequence_after(reliable_sequence, m_reliable_acked.load()) )
+            {
+              reliable_tries = 0;
+              m_metrics.record_outgoing(reliable.front().header.type, reliable.front().get_encoded_size());
+              dispatcher.dispatch(std::move(reliable.front()), MessageDirection::OUTGOING);
+              reliable.pop_front();
+            }
+
+          if ( ! reliable.empty() && (reliable_tries == 0 || Clock::now() >= retransmit_at) )
+            {
+              if ( reliable_tries == 0 )
+                ++reliable_sequence;
+              else if ( reliable_tries >= DATAGRAM_RETRANSMIT_LIMIT )
                 {
-                  /* Only print the associated error string if it's something
-                     interesting -- i.e., something besides "the connection
-                     was closed".  */
-                  if ( ec.value() != boost::asio::error::operation_aborted &&
-                       ec.value() != boost::asio::error::bad_descriptor &&
-                       ec.value() != boost::asio::error::connection_aborted &&
-                       ec.value() != boost::asio::error::connection_reset )
-                    fprintf(stderr, "error writing message: %s\n", strerror(ec.value()));
+                  fprintf(stderr, "[0x%x][Node] Reliable-channel message not acknowledged after %u tries.\n",
+                          THREAD_ID, reliable_tries);
+                  break;
+                }
 
+              set_buffers(DatagramKind::RELIABLE, reliable_sequence, &reliable.front());
+              if ( ! send_datagram() )
+                break;
+              ++reliable_tries;
+              retransmit_at = Clock::now() + std::chrono::milliseconds(DATAGRAM_RETRANSMIT_INTERVAL);
+            }
+
+          /* Pack queued messages into a DATA datagram, diverting any for the reliable
+             channel.  Messages are compacted and stamped as in the stream send loop;
+             compaction only ever shrinks a message, so it's budgeted at its full size.  */
+          const bool stamping ( m_stamping.load() );
+          const size_t max_messages ( std::max<size_t>(1, m_batching.max_messages) );
+          const size_t max_size ( std::min<size_t>(DATAGRAM_MAX_SIZE, m_batching.max_bytes) );
+          batch.clear();
+          batch.reserve(max_messages);
+          size_t size ( sizeof(DatagramHeader) );
+          while ( batch.size() < max_messages && (held || m_outgoing_queue.try_pop(message)) )
+            {
+              held = false;
+              if ( detail::is_reliable_type(message.header.type) )
+                {
+                  reliable.push_back(std::move(message));
+                  continue;
+                }
+
+              size_t message_size ( message.get_encoded_size() + (stamping ? sizeof(Message::Stamp) : 0) );
+              if ( ! batch.empty() && size + message_size > max_size )
+                {               /* Send what we have, and start the next datagram with this. */
+                  held = true;
                   break;
                 }
-              else
-                m_outgoing_queue.emplace(std::move(message));
+              size += message_size;
+              batch.push_back(std::move(message));
             }
-          else
-            dispatcher.dispatch(std::move(message), MessageDirection::OUTGOING);
-        }
-      fprintf(stderr, "[0x%x][Node] Exiting send loop.\n", THREAD_ID);
 
-      if ( ! m_stopped )
-        m_io_service.post(std::bind(&BasicNode::halt, this, false));
+          if ( m_stopped )
+            break;
+
+          if ( ! batch.empty() )
+            {
+              const uint64_t now ( stamping ? detail::stamp_clock() : 0 );
+              compacted.clear();
+              compacted.resize(batch.size());
+              prefixes.clear();
+              prefixes.resize(batch.size());
+
+              std::shared_ptr<const Configuration> compact_config;
+              if ( m_compacting.load(std::memory_order_relaxed) )
+                compact_config = std::atomic_load(&m_compact_configuration);
+
+              set_buffers(DatagramKind::DATA, ++data_sequence, nullptr);
+              for ( size_t i ( 0 ); i < batch.size(); ++i )
+                gather(batch[i], compacted[i], prefixes[i], buffers, stamping, now, compact_config.get());
+              if ( ! send_datagram() )
+                break;
+
+              m_metrics.set_queue_depth(m_outgoing_queue.size());
+              for ( size_t i ( 0 ); i < batch.size(); ++i )
+                {
+                  const Message& sent ( compacted[i].body ? compacted[i] : batch[i] );
+                  size_t sent_size ( sent.get_encoded_size() );
+                  if ( prefixes[i].header.length )
+                    sent_size += sizeof(Message::Stamp);
+                  m_metrics.record_outgoing(sent.header.type, sent_size);
+                  dispatcher.dispatch(std::move(batch[i]), MessageDirection::OUTGOING);
+                }
+              continue;
+            }
+
+          /* Nothing to send right now: wait for more messages, an acknowledgement (either
+             way), or the retransmit deadline.  See `stream_send_loop` on `m_send_waiting`.  */
+          if ( (! reliable.empty() && reliable_tries == 0) || m_reliable_ack_pending.load() )
+            continue;
+
+          m_send_waiting = true;
+          if ( m_outgoing_queue.try_pop(message) )
+            held = true;
+          if ( held || m_reliable_ack_pending.load() ||
+               (reliable_tries > 0 && ! detail::sequence_after(reliable_sequence, m_reliable_acked.load())) )
+            {
+              m_send_waiting = false;
+              continue;
+            }
+
+          boost::system::error_code wec;
+          m_send_wake_timer.expires_at(reliable_tries > 0 ? retransmit_at : Clock::time_point::max());
+          m_send_wake_timer.async_wait(yield[wec]);
+          m_send_waiting = false;
+        }
     }
 
     template < typename _Protocol >
     bool
-    BasicNode<_Protocol>::resync(boost::asio::yield_context& yield)
+    BasicNode<_Protocol>::resync(const crisp::util::Buffer& buf, size_t& begin, size_t end,
+                                 size_t& discarded)
     {
-      constexpr const char* sync_string = "\x04\x00\x02\x53\x59\x4E\x43";
-      char buf[strlen(sync_string)];
+      static const char sync_string[] = "\x04\x00\x02\x53\x59\x4E\x43";
+      static constexpr size_t sync_length ( sizeof(sync_string) - 1 );
 
-      boost::system::error_code ec;
-      boost::asio::streambuf read_buf;
-      boost::asio::async_read_until(m_socket, read_buf, sync_string, yield[ec]);
+      /* Let `memchr` -- vectorized in any modern C library -- find candidates, anchoring on
+         the body's leading 'S': the header bytes (small lengths and type numbers) are far
+         more common in binary data.  */
+      static constexpr size_t anchor ( 3 );
 
-      if ( ec )
-        fprintf(stderr, "resync: read_until failed: %s\n", strerror(ec.value()));
+      const char* const first ( buf.data + begin );
+      const char* const last ( buf.data + end );
+      for ( const char* p ( first + anchor ); p < last; ++p )
+        {
+          p = static_cast<const char*>(memchr(p, sync_string[anchor], last - p));
+          if ( ! p || static_cast<size_t>(last - (p - anchor)) < sync_length )
+            break;
+          if ( ! memcmp(p - anchor, sync_string, sync_length) )
+            {
+              discarded = (p - anchor) - first;
+              begin += discarded + sync_length;
+              return true;
+            }
+        }
 
-      return ! static_cast<bool>(ec);
+      /* Keep any trailing bytes that might be the start of a sync message. */
+      discarded = 0;
+      if ( end - begin >= sync_length )
+        {
+          discarded = end - begin - (sync_length - 1);
+          begin += discarded;
+        }
+      return false;
     }
 
     template < typename _Protocol >
@@ -277,84 +1032,342 @@ namespace crisp
     {
       fprintf(stderr, "[0x%x][Node] Entered receive loop.\n", THREAD_ID);
 
-      crisp::util::Buffer rdbuf ( BUFSIZ );
+      if ( UsesDatagrams )
+        datagram_receive_loop(yield);
+      else
+        stream_receive_loop(yield);
+
+      fprintf(stderr, "[0x%x][Node] Exiting receive loop.\n", THREAD_ID);
+
+      if ( ! m_stopped )
+        m_io_service.post(std::bind(&BasicNode::halt, this, false));
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::stream_receive_loop(boost::asio::yield_context yield)
+    {
+      using crisp::util::Buffer;
+
+      /* Data is read from the socket into `rdbuf` at `end`, as much as is available at a time,
+         and parsed from `begin`.  Received messages reference their bodies in place, so the
+         space before `begin` may only be reused once none of them remain -- i.e. when ours is
+         the only reference to the buffer.  */
+      boost::intrusive_ptr<Buffer> rdbuf ( buffer_pool->acquire(RECEIVE_BUFFER_SIZE) );
+      size_t begin ( 0 ), end ( 0 );
+
+      /* Number of bytes that must be available at `begin` before parsing can make progress. */
+      size_t needed ( sizeof(Message::Header) );
+
+      /* Whether we're looking for a sync message after receiving a corrupt one. */
+      bool syncing ( false );
 
       while ( ! m_stopped )
         {
-          Message m;
-          boost::system::error_code ec;
+          if ( begin == end && rdbuf->refCount == 1 )
+            begin = end = 0;
+
+          /* Make sure there's space for the rest of the partial message at `begin`, and for
+             at least some new data.  */
+          if ( rdbuf->length - begin < needed || end == rdbuf->length )
+            {
+              size_t capacity ( std::max<size_t>(rdbuf->length, needed) );
+              if ( rdbuf->refCount > 1 )
+                {
+                  boost::intrusive_ptr<Buffer> fresh ( buffer_pool->acquire(capacity) );
+                  memcpy(fresh->data, rdbuf->data + begin, end - begin);
+                  rdbuf = fresh;
+                }
+              else
+                {
+                  memmove(rdbuf->data, rdbuf->data + begin, end - begin);
+                  if ( rdbuf->length < capacity )
+                    rdbuf->resize(capacity);
+                }
+              end -= begin;
+              begin = 0;
+            }
 
-          /* Read the header. */
-          boost::asio::async_read(m_socket,
-                                  boost::asio::buffer(&m.header, sizeof(m.header)),
-                                  boost::asio::transfer_exactly(sizeof(m.header)),
-                                  yield[ec]);
+          boost::system::error_code ec;
+          size_t n ( m_socket.async_receive(boost::asio::buffer(rdbuf->data + end, rdbuf->length - end),
+                                            yield[ec]) );
           if ( ec )
             {
               if ( ec.value() != boost::asio::error::operation_aborted &&
-                   ec.value() != boost::asio::error::bad_descriptor )
-                fprintf(stderr, "error reading message header: %s\n", strerror(ec.value()));
+                   ec.value() != boost::asio::error::bad_descriptor &&
+                   ec.value() != boost::asio::error::eof )
+                fprintf(stderr, "error reading from socket: %s\n", strerror(ec.value()));
               break;
             }
 
           if ( m_stopped )
             break;
 
-          /* Make sure our buffer is big enough. */
-          size_t encoded_size ( m.get_encoded_size() );
-          if ( rdbuf.length < encoded_size )
-            rdbuf.resize(encoded_size);
-
-          /* Copy the header data into the read buffer to make monolithic decoding easier
-             later. */
-          memcpy(rdbuf.data, &m.header, sizeof(m.header));
+          end += n;
 
-          /* Read the message body (and possibly checksum as well) if necessary. */
-          const detail::MessageTypeInfo& mti ( detail::get_type_info(m.header.type) );
-          if ( mti.has_body )
+          /* Dispatch every complete message in the buffer.  After a corrupt message, skip
+             ahead to just past the next sync message first.  */
+          needed = sizeof(Message::Header);
+          while ( true )
             {
-              size_t
-                n  = boost::asio::async_read(m_socket,
-                                             boost::asio::buffer(rdbuf.data + sizeof(m.header),
-                                                                 m.header.length),
-                                             boost::asio::transfer_exactly(m.header.length),
-                                             yield[ec]);
-              if ( ec )
+              if ( syncing )
+                {
+                  size_t discarded;
+                  bool found ( resync(*rdbuf, begin, end, discarded) );
+                  m_metrics.record_discarded(discarded);
+                  if ( ! found )
+                    break;
+                  syncing = false;
+
+                  /* Compact controls may have been among the skipped bytes, so the deltas
+                     that follow can't be trusted until the sender's next full values.  */
+                  m_compact_decoder.reset();
+                }
+
+              if ( end - begin < sizeof(Message::Header) )
+                break;
+
+              Message::Header header;
+              memcpy(&header, rdbuf->data + begin, sizeof(header));
+              const bool stamped ( detail::take_stamped_flag(header) );
+
+              if ( static_cast<size_t>(header.type) >= MESSAGE_TYPE_COUNT )
+                {
+                  m_metrics.record_decode_error();
+                  m_metrics.record_resync();
+                  syncing = true;
+                  continue;
+                }
+
+              const detail::MessageTypeInfo& mti ( detail::get_type_info(header.type) );
+              if ( header.length < (stamped ? sizeof(Message::Stamp) : 0) +
+                                   (mti.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0) )
+                {
+                  m_metrics.record_decode_error();
+                  m_metrics.record_resync();
+                  syncing = true;
+                  continue;
+                }
+
+              size_t frame_size ( sizeof(header) + header.length );
+              if ( end - begin < frame_size )
                 {
-                  if ( ec.value() != boost::asio::error::operation_aborted &&
-                       ec.value() != boost::asio::error::bad_descriptor )
-                    fprintf(stderr, "error reading message body: %s\n", strerror(ec.value()));
+                  needed = frame_size;
                   break;
                 }
-              else
-                assert(n == m.header.length);
+
+              size_t message_begin ( begin );
+              Message::Stamp stamp;
+              if ( stamped )
+                detail::strip_stamp(*rdbuf, message_begin, header, stamp);
+
+              DecodeBuffer db ( rdbuf, message_begin );
+              Message m ( Message::decode_slice(db, buffer_pool.get()) );
+
+              if ( mti.has_checksum && ! m.checksum_ok() )
+                {
+                  /* The header can't be trusted either, so the next message could start
+                     anywhere -- including within the stamp, so put that back first.  */
+                  if ( stamped )
+                    memcpy(rdbuf->data + begin + sizeof(header), &stamp, sizeof(stamp));
+                  m_metrics.record_checksum_failure();
+                  m_metrics.record_discarded(1);
+                  ++begin;
+                  m_metrics.record_resync();
+                  syncing = true;
+                  continue;
+                }
+
+              begin += frame_size;
+              m_metrics.record_incoming(header.type, frame_size);
+              if ( stamped )
+                m_metrics.record_stamp(header.type, stamp, detail::stamp_clock());
+              if ( header.type == MessageType::MODULE_CONTROL_COMPACT && ! expand_compact(m) )
+                continue;
+              if ( header.type == MessageType::HANDSHAKE && ! handle_remote_handshake(m) )
+                continue;
+              if ( header.type == MessageType::CONFIGURATION_RESPONSE )
+                handle_configuration_response(m);
+              if ( ! dispatcher.dispatch(std::move(m), MessageDirection::INCOMING) )
+                m_metrics.record_decode_error();
+            }
+        }
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::datagram_receive_loop(boost::asio::yield_context yield)
+    {
+      using crisp::util::Buffer;
+      using detail::DatagramHeader;
+      using detail::DatagramKind;
+
+      /* Each datagram is received into `rdbuf` whole, and the messages in it reference their
+         bodies in place; we only reuse the buffer once they're all gone.  */
+      boost::intrusive_ptr<Buffer> rdbuf ( buffer_pool->acquire(RECEIVE_BUFFER_SIZE) );
+
+      /* Session of the remote node's datagrams, and the next sequence number expected on its
+         reliable channel -- or zero, if nothing has yet arrived on it in that session.  */
+      uint32_t remote_session ( 0 );
+      uint32_t reliable_expected ( 0 );
+
+      while ( ! m_stopped )
+        {
+          if ( rdbuf->refCount > 1 )
+            rdbuf.reset(buffer_pool->acquire(RECEIVE_BUFFER_SIZE));
+
+          boost::system::error_code ec;
+          size_t n ( m_socket.async_receive(boost::asio::buffer(rdbuf->data, rdbuf->length), yield[ec]) );
+          if ( ec )
+            {
+              /* The remote node isn't listening (yet); it may well be soon.  */
+              if ( ec.value() == boost::asio::error::connection_refused )
+                continue;
+
+              if ( ec.value() != boost::asio::error::operation_aborted &&
+                   ec.value() != boost::asio::error::bad_descriptor )
+                fprintf(stderr, "error reading from socket: %s\n", strerror(ec.value()));
+              break;
             }
 
           if ( m_stopped )
             break;
 
-          /* Decode the message. */
-          DecodeBuffer db ( rdbuf.data, rdbuf.length );
+          if ( n < sizeof(DatagramHeader) )
+            continue;
+
+          DatagramHeader header;
+          memcpy(&header, rdbuf->data, sizeof(header));
 
-          /* Dump the message contents. */
-          /* for ( size_t i = sizeof(m.header); i < sizeof(m.header) + m.header.length; ++i )
-           *   fprintf(stderr, " %02hhX", mdata[i]);
-           * fputs("\n", stderr); */
+          /* A new session means the remote node has restarted, so forget what it sent
+             before: its sequence numbers start again.  */
+          if ( header.session != remote_session )
+            {
+              remote_session = header.session;
+              reliable_expected = 0;
+              m_control_received.reset();
+            }
+
+          switch ( header.kind )
+            {
+            case DatagramKind::ACK:
+              if ( detail::sequence_after(header.sequence, m_reliable_acked.load()) )
+                {
+                  m_reliable_acked = header.sequence;
+                  wake_send_loop();
+                }
+              break;
+
+            case DatagramKind::RELIABLE:
+              /* Acknowledge everything up to the last message delivered -- including this
+                 one, if it's the one we're waiting for.  Retransmissions of messages we've
+                 already delivered are re-acknowledged and then dropped.  The remote node sends
+                 one message at a time, so the first to arrive in a session is the one to
+                 deliver, whatever its number (e.g. if only this node has restarted).  */
+              if ( header.sequence == reliable_expected || reliable_expected == 0 )
+                {
+                  reliable_expected = header.sequence + 1;
+                  dispatch_datagram(rdbuf, sizeof(header), n, false, header.sequence);
+                }
+              m_reliable_ack_due = reliable_expected - 1;
+              m_reliable_ack_pending = true;
+              wake_send_loop();
+              break;
 
-          m = Message::decode(db);
+            case DatagramKind::DATA:
+              dispatch_datagram(rdbuf, sizeof(header), n, true, header.sequence);
+              break;
+
+            default:
+              break;
+            }
+        }
+    }
+
+    template < typename _Protocol >
+    void
+    BasicNode<_Protocol>::dispatch_datagram(const boost::intrusive_ptr<crisp::util::Buffer>& rdbuf,
+                                            size_t begin, size_t end, bool data, uint32_t sequence)
+    {
+      /* Since datagrams arrive whole (or not at all), there's no need to resync after a
+         corrupt message: we just drop the rest of the datagram.  */
+      while ( end - begin >= sizeof(Message::Header) )
+        {
+          Message::Header header;
+          memcpy(&header, rdbuf->data + begin, sizeof(header));
+          const bool stamped ( detail::take_stamped_flag(header) );
 
+          if ( static_cast<size_t>(header.type) >= MESSAGE_TYPE_COUNT )
+            {
+              m_metrics.record_decode_error();
+              return;
+            }
+
+          const detail::MessageTypeInfo& mti ( detail::get_type_info(header.type) );
+          size_t frame_size ( sizeof(header) + header.length );
+          if ( header.length < (stamped ? sizeof(Message::Stamp) : 0) +
+                               (mti.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0) ||
+               end - begin < frame_size )
+            {
+              m_metrics.record_decode_error();
+              return;
+            }
+
+          /* Stale messages still tell us about the link, so record their stamps before
+             dropping them.  */
+          size_t message_begin ( begin );
+          Message::Stamp stamp;
+          if ( stamped )
+            detail::strip_stamp(*rdbuf, message_begin, header, stamp);
+
+          DecodeBuffer db ( rdbuf, message_begin );
+          Message m ( Message::decode_slice(db, buffer_pool.get()) );
           if ( mti.has_checksum && ! m.checksum_ok() )
             {
-              if ( ! resync(yield) )
-                break;
+              m_metrics.record_checksum_failure();
+              return;
             }
-          else
-            dispatcher.dispatch(std::move(m), MessageDirection::INCOMING);
-        }
-      fprintf(stderr, "[0x%x][Node] Exiting receive loop.\n", THREAD_ID);
 
-      if ( ! m_stopped )
-        m_io_service.post(std::bind(&BasicNode::halt, this, false));
+          /* A control is stale if a newer datagram has already delivered one for the same
+             module; controls for other modules in the same datagram are still current.  The
+             module ID is the first byte of a MODULE_CONTROL body, and follows the flags byte
+             in a compact one.  */
+          int control_module ( -1 );
+          if ( data && ( header.type == MessageType::MODULE_CONTROL ||
+                         header.type == MessageType::MODULE_CONTROL_COMPACT ) )
+            {
+              size_t id_offset ( header.type == MessageType::MODULE_CONTROL_COMPACT ? 1 : 0 );
+              if ( header.length - (mti.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0) > id_offset )
+                control_module = static_cast<uint8_t>(rdbuf->data[message_begin + sizeof(header) + id_offset]);
+            }
+          if ( control_module >= 0 && m_control_received[control_module] &&
+               detail::sequence_after(m_control_sequence[control_module], sequence) )
+            {
+              if ( stamped )
+                m_metrics.record_stamp(header.type, stamp, detail::stamp_clock());
+              ++m_num_stale_dropped;
+              begin += frame_size;
+              continue;
+            }
+
+          begin += frame_size;
+          m_metrics.record_incoming(header.type, frame_size);
+          if ( stamped )
+            m_metrics.record_stamp(header.type, stamp, detail::stamp_clock());
+          if ( header.type == MessageType::MODULE_CONTROL_COMPACT && ! expand_compact(m) )
+            continue;
+          if ( control_module >= 0 )
+            {
+              m_control_sequence[control_module] = sequence;
+              m_control_received[control_module] = true;
+            }
+          if ( header.type == MessageType::HANDSHAKE && ! handle_remote_handshake(m) )
+            continue;
+          if ( header.type == MessageType::CONFIGURATION_RESPONSE )
+            handle_configuration_response(m);
+          if ( ! dispatcher.dispatch(std::move(m), MessageDirection::INCOMING) )
+            m_metrics.record_decode_error();
+        }
     }
 
   }
@@ -2,6 +2,8 @@
 #include <crisp/comms/Handshake.hh>
 #include <crisp/comms/Configuration.hh>
 #include <crisp/comms/ModuleControl.hh>
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/SensorPoll.hh>
 #include <crisp/util/Scheduler.hh>
 
 namespace crisp
@@ -30,6 +32,24 @@ namespace crisp
       }
 
 
+      /** Handler-caller helper for handlers that receive an already-decoded message
+          body. */
+      template < typename _Node, typename _Body >
+      static void
+      emit_handler(_Node& node, const std::shared_ptr<_Body>& body, MessageDirection direction,
+                   MessageHandler<_Node, _Body>& handler)
+      {
+        switch ( direction )
+          {
+          case MessageDirection::INCOMING:
+            handler.received.emit(node, body);
+            break;
+          case MessageDirection::OUTGOING:
+            handler.sent.emit(node, body);
+            break;
+          }
+      }
+
       /** Handler-caller helper for handlers that DO receive a message-body
           parameter. */
       template < typename _Node, typename _Body, typename... Args >
@@ -38,14 +58,43 @@ namespace crisp
                    MessageHandler<_Node, _Body>& handler,
                    const Args&... args)
       {
-        std::shared_ptr<_Body> body ( std::make_shared<_Body>(m.as<_Body>(args...)) );
+        emit_handler(node, std::make_shared<_Body>(m.as<_Body>(args...)), direction, handler);
+      }
+
+
+      /** Synchronous handler-caller helper for handlers that don't receive a message-body
+          parameter. */
+      template < typename _Node >
+      static void
+      call_handler_synchronous(_Node& node,
+                               MessageDirection direction,
+                               MessageHandler<_Node, void>& handler)
+      {
         switch ( direction )
           {
           case MessageDirection::INCOMING:
-            handler.received.emit(node, body);
+            handler.received.emit_blocking(node);
             break;
           case MessageDirection::OUTGOING:
-            handler.sent.emit(node, body);
+            handler.sent.emit_blocking(node);
+            break;
+          }
+      }
+
+      /** Synchronous handler-caller helper for handlers that DO receive a message-body
+          parameter.  */
+      template < typename _Node, typename _Body >
+      static void
+      call_handler_synchronous(_Node& node, const _Body& body, MessageDirection direction,
+                               MessageHandler<_Node, _Body>& handler)
+      {
+        switch ( direction )
+          {
+          case MessageDirection::INCOMING:
+            handler.received.emit_blocking(node, body);
+            break;
+          case MessageDirection::OUTGOING:
+            handler.sent.emit_blocking(node, body);
             break;
           }
       }
@@ -54,12 +103,21 @@ namespace crisp
     template < typename _Node >
     MessageDispatcher<_Node>::MessageDispatcher()
       : m_node ( nullptr ),
+        m_mode ( DispatchMode::ASYNCHRONOUS ),
+        m_module_control ( ),
+        m_sensor_data ( ),
         handshake ( ),
         handshake_response ( ),
         sync ( ),
         configuration_query ( ),
         configuration_response ( ),
-        module_control ( )
+        module_control ( ),
+        sensor_data ( ),
+        sensor_poll ( ),
+        configuration_cache ( ),
+        sensor_readers ( ),
+        sensor_history ( ),
+        remote_configuration ( )
     {
       set_default_callbacks();
     }
@@ -68,12 +126,21 @@ namespace crisp
     template < typename _Node >
     MessageDispatcher<_Node>::MessageDispatcher(_Node& node)
     : m_node ( &node ),
+      m_mode ( DispatchMode::ASYNCHRONOUS ),
+      m_module_control ( ),
+      m_sensor_data ( ),
       handshake ( node.get_io_service() ),
       handshake_response ( node.get_io_service() ),
       sync ( node.get_io_service() ),
       configuration_query ( node.get_io_service() ),
       configuration_response ( node.get_io_service() ),
-      module_control ( node.get_io_service() )
+      module_control ( node.get_io_service() ),
+      sensor_data ( node.get_io_service() ),
+      sensor_poll ( node.get_io_service() ),
+      configuration_cache ( ),
+      sensor_readers ( ),
+      sensor_history ( ),
+      remote_configuration ( )
     {
       set_default_callbacks();
     }
@@ -93,6 +160,10 @@ namespace crisp
       configuration_query = other.configuration_query;
       configuration_response = other.configuration_response;
       module_control = other.module_control;
+      sensor_data = other.sensor_data;
+      sensor_poll = other.sensor_poll;
+      m_mode = other.m_mode;
+      configuration_cache.invalidate();
 
       if ( m_node )
         set_target(*m_node);
@@ -124,6 +195,19 @@ namespace crisp
 
       module_control.received.set_io_service(service);
       module_control.sent.set_io_service(service);
+
+      sensor_data.received.set_io_service(service);
+      sensor_data.sent.set_io_service(service);
+
+      sensor_poll.received.set_io_service(service);
+      sensor_poll.sent.set_io_service(service);
+    }
+
+    template < typename _Node >
+    void
+    MessageDispatcher<_Node>::set_dispatch_mode(DispatchMode mode)
+    {
+      m_mode = mode;
     }
 
     template < typename _Node >
@@ -230,9 +314,20 @@ namespace crisp
                  });
 
 
+      /* These handlers are copied along with the dispatcher (e.g. into each of a NodeServer's
+         nodes), so they must use the receiving node's dispatcher rather than this one.  */
       configuration_query.received
-        .connect([&](_Node& _node)
-                 { _node.send(Configuration(_node.configuration)); });
+        .connect([](_Node& _node)
+                 { _node.send(_node.dispatcher.configuration_cache.get(_node.configuration)); });
+
+      sensor_poll.received
+        .connect([](_Node& _node, const SensorPoll& poll)
+                 {
+                   SensorData data ( std::chrono::duration_cast<std::chrono::microseconds>
+                                     (std::chrono::steady_clock::now().time_since_epoch()).count() );
+                   if ( _node.dispatcher.sensor_readers.read(poll, _node.configuration, data) > 0 )
+                     _node.send(data);
+                 });
 
 
       module_control.sent
@@ -265,10 +360,13 @@ namespace crisp
 
 
     template < typename _Node >
-    void
+    bool
     MessageDispatcher<_Node>::dispatch(Message&& message, MessageDirection direction) throw ( std::runtime_error )
     {
       assert(m_node != NULL);
+      if ( m_mode == DispatchMode::SYNCHRONOUS )
+        return dispatch_synchronous(message, direction);
+
       switch ( message.header.type )
 	{
 	case MessageType::HANDSHAKE:
@@ -296,13 +394,125 @@ namespace crisp
 	  break;
 
 	case MessageType::SENSOR_DATA:
-	  throw std::runtime_error("not yet implemented");
+          if ( direction == MessageDirection::INCOMING &&
+               (sensor_history || std::atomic_load(&remote_configuration)) )
+            {
+              if ( ! message.body )
+                throw std::runtime_error("Cannot convert `null` body to object form");
+
+              /* Decode here, while the configuration snapshot is known, once for both the
+                 history and the handlers.  */
+              std::shared_ptr<SensorData> data ( std::make_shared<SensorData>() );
+              if ( decode_sensor_data(message, direction, *data) != DecodeResult::SUCCESS )
+                return false;
+              if ( sensor_history )
+                sensor_history->record(*data);
+              detail::emit_handler(*m_node, data, direction, sensor_data);
+            }
+          else
+            detail::call_handler<_Node, SensorData, Configuration>(*m_node, std::move(message), direction, sensor_data, m_node->configuration);
 	  break;
 
 	case MessageType::MODULE_CONTROL:
           detail::call_handler<_Node, ModuleControl, Configuration>(*m_node, std::move(message), direction, module_control, m_node->configuration);
 	  break;
+
+	case MessageType::MODULE_CONTROL_COMPACT:
+	  throw std::runtime_error("MODULE_CONTROL_COMPACT messages must be expanded before dispatch");
+	  break;
+
+	case MessageType::SENSOR_POLL:
+	  detail::call_handler(*m_node, std::move(message), direction, sensor_poll);
+	  break;
+	}
+      return true;
+    }
+
+    template < typename _Node >
+    DecodeResult
+    MessageDispatcher<_Node>::decode_sensor_data(const Message& message, MessageDirection direction,
+                                                 SensorData& data) const
+    {
+      DecodeBuffer db ( message.body );
+      std::shared_ptr<const Configuration> remote;
+      if ( direction == MessageDirection::INCOMING &&
+           (remote = std::atomic_load(&remote_configuration)) )
+        return data.decode(db, remote);
+      else
+        return data.decode(db, m_node->configuration);
+    }
+
+    template < typename _Node >
+    bool
+    MessageDispatcher<_Node>::dispatch_synchronous(const Message& message, MessageDirection direction)
+    {
+      switch ( message.header.type )
+	{
+	case MessageType::HANDSHAKE:
+	  detail::call_handler_synchronous(*m_node, message.as<Handshake>(), direction, handshake);
+	  break;
+
+	case MessageType::HANDSHAKE_RESPONSE:
+	  detail::call_handler_synchronous(*m_node, message.as<HandshakeResponse>(), direction, handshake_response);
+	  break;
+
+	case MessageType::SYNC:
+	  detail::call_handler_synchronous(*m_node, direction, sync);
+	  break;
+
+	case MessageType::ERROR:
+	  throw std::runtime_error("Unexpected unimplemented message type ERROR");
+	  break;
+
+	case MessageType::CONFIGURATION_QUERY:
+	  detail::call_handler_synchronous(*m_node, direction, configuration_query);
+	  break;
+
+	case MessageType::CONFIGURATION_RESPONSE:
+	  detail::call_handler_synchronous(*m_node, message.as<Configuration>(), direction, configuration_response);
+	  break;
+
+	case MessageType::SENSOR_DATA:
+          {
+            if ( ! message.body )
+              throw std::runtime_error("Cannot convert `null` body to object form");
+
+            /* Decode into reused storage, which stops allocating once it has grown to the
+               size of the largest batch seen.  */
+            SensorData& data ( m_sensor_data[static_cast<size_t>(direction)] );
+            if ( decode_sensor_data(message, direction, data) != DecodeResult::SUCCESS )
+              return false;
+            if ( direction == MessageDirection::INCOMING && sensor_history )
+              sensor_history->record(data);
+            detail::call_handler_synchronous(*m_node, data, direction, sensor_data);
+          }
+	  break;
+
+	case MessageType::MODULE_CONTROL:
+          {
+            if ( ! message.body )
+              throw std::runtime_error("Cannot convert `null` body to object form");
+
+            /* Decode the values in place (referencing the message body), and drop those
+               references again before returning.  */
+            ModuleControl& control ( m_module_control[static_cast<size_t>(direction)] );
+            DecodeBuffer db ( message.body );
+            if ( control.decode(db, m_node->configuration, false) != DecodeResult::SUCCESS )
+              return false;
+            detail::call_handler_synchronous(*m_node, control, direction, module_control);
+            control.reset();
+          }
+	  break;
+
+	case MessageType::MODULE_CONTROL_COMPACT:
+	  throw std::runtime_error("MODULE_CONTROL_COMPACT messages must be expanded before dispatch");
+	  break;
+
+	case MessageType::SENSOR_POLL:
+	  detail::call_handler_synchronous(*m_node, message.as<SensorPoll>(), direction, sensor_poll);
+	  break;
 	}
+      return true;
     }
 
     /* MessageDispatcher&
@@ -22,6 +22,8 @@ namespace crisp
         nodes_mutex ( ),
         configuration ( ),
         dispatcher ( ),
+        buffer_pool ( new crisp::util::BufferPool() ),
+        worker_threads_per_node ( NODE_DEFAULT_WORKER_THREADS ),
         connect_signal ( io_service ),
         run_thread ( ),
         halting ( ),
@@ -87,6 +89,17 @@ namespace crisp
       return connect_signal.connect(func);
     }
 
+    template < typename _Node >
+    NodeMetrics::Snapshot
+    NodeServer<_Node>::get_metrics()
+    {
+      NodeMetrics::Snapshot out;
+      std::unique_lock<std::mutex> lock ( nodes_mutex );
+      for ( Node* node : nodes )
+        out += node->get_metrics();
+      return out;
+    }
+
 
     template < typename _Node >
     void
@@ -146,10 +159,11 @@ namespace crisp
               std::cerr << "Accepted connection from " << endpoint << std::endl;
 
               /* We've got a connection.  Create a new protocol-node on it. */
-              Node* node ( new Node(std::move(socket), NodeRole::SLAVE) );
+              Node* node ( new Node(std::move(socket), NodeRole::SLAVE, buffer_pool,
+                                      worker_threads_per_node) );
 
               /* Set up the node's callbacks and interface configuration. */
-              node->configuration = configuration;
+              node->set_configuration(configuration);
               node->dispatcher = dispatcher;
               node->dispatcher.set_target(*node);
 
@@ -7,8 +7,6 @@
 
 #define ENABLE_ASSERT 1
 
-#undef MESSAGE_USE_SEQUENCE_ID
-
 #define MESSAGE_CHECKSUM_SIZE 4
 
 #define PROTOCOL_VERSION 0x00
@@ -18,6 +16,36 @@
 
 #define SYNC_INTERVAL 1
 
+/** Default number of worker threads servicing each node's IO and message handlers. */
+#define NODE_DEFAULT_WORKER_THREADS 6
+
+/** Initial size, in bytes, of each node's receive buffer.  The buffer grows if a single
+    message won't fit. */
+#define RECEIVE_BUFFER_SIZE 65536
+
+/** Number of distinct keys (e.g. module/input-set combinations) for which each node can
+    coalesce outgoing messages at once.  Each key is held in one of a few slots near its hash,
+    so when those are all taken by other keys, its messages are sent in FIFO order.  Must be a
+    power of two. */
+#define OUTGOING_QUEUE_COALESCING_SLOTS 64
+
+/** Number of queue entries preallocated by each node's outgoing queue.  Messages queued while
+    this many are already waiting to be sent are held in heap-allocated entries instead. */
+#define OUTGOING_QUEUE_RESERVED_ENTRIES 1024
+
+/** Largest datagram, in bytes, that a datagram node will pack several messages into.  (A
+    single larger message is still sent on its own.)  The default keeps datagrams within a
+    typical Ethernet or Wi-Fi MTU.  */
+#define DATAGRAM_MAX_SIZE 1400
+
+/** Interval, in milliseconds, at which a datagram node retransmits an unacknowledged message
+    on its reliable channel. */
+#define DATAGRAM_RETRANSMIT_INTERVAL 100
+
+/** Number of times a datagram node sends a reliable-channel message without acknowledgement
+    before giving up and halting. */
+#define DATAGRAM_RETRANSMIT_LIMIT 50
+
 /** How long after a message-handler signal emission we should wait before
     freeing the message-body object. */
 #define MESSAGE_HANDLER_SIGNAL_FREE_DELAY 1
@@ -7,6 +7,8 @@ namespace crisp
 {
   namespace util
   {
+    class BufferPool;
+
     /** Basic data-buffer object with intrusive-pointer semantics.
      */
     class Buffer : public crisp::util::RefCountedObject
@@ -26,6 +28,20 @@ namespace crisp
       /** Function to be used to free `data` pointer, if and when appropriate. */
       FreeFunctionType free_function;
 
+      /** Object that owns the memory at `data`, for buffers that reference a region of some
+       *  other buffer (see `slice`).  Holding this reference keeps that memory alive for as long
+       *  as this buffer exists.
+       */
+      RefTraits<RefCountedObject>::stored_ref owner;
+
+      /** Pool to which this buffer will be returned when its reference count drops to zero, if
+       *  it was obtained from one.  @sa BufferPool
+       */
+      RefTraits<BufferPool>::stored_ref pool;
+
+      /** Index of the pool size-class from which the buffer was obtained, if `pool` is set. */
+      uint8_t size_class;
+
     public:
 
       /** Construct from pointer: does not take ownership.
@@ -80,6 +96,11 @@ namespace crisp
        */
       ~Buffer() throw ( std::runtime_error );
 
+      /** Return the buffer to its pool, if it has one, or delete it otherwise.  Called when the
+       * buffer's reference count drops to zero.
+       */
+      virtual void dispose();
+
       /** Move-assignment operator.  This is essentially a passthrough to
        * `reset`.
        *
@@ -124,6 +145,22 @@ namespace crisp
       { return Buffer(data, length); }
 
 
+      /** Create a new Buffer on the heap that references (without copying) a region of another,
+       *  heap-allocated Buffer.  The new buffer holds a reference to @p parent, so the region
+       *  remains valid for as long as the slice does.
+       *
+       * @param parent Buffer to reference.
+       *
+       * @param offset Offset of the first byte of the region within @p parent.
+       *
+       * @param length Length of the region.
+       *
+       * @return A newly-allocated Buffer instance.
+       */
+      static Buffer*
+      slice(Buffer* parent, size_t offset, size_t length);
+
+
       /** Create a new Buffer object of the given capacity. */
       static inline Buffer
       create(size_t size)
@@ -176,7 +213,8 @@ namespace crisp
       copy_new(const Buffer& buf);
 
 
-      /** Unconditionally resize the buffer.
+      /** Unconditionally resize the buffer.  A pooled buffer that is resized no longer
+       *  belongs to its pool.
        *
        * @param capacity New capacity.
        */
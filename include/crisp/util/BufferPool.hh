@@ -0,0 +1,118 @@
+/** @file
+ *
+ * Declares BufferPool, a recycling allocator for Buffer objects.
+ */
+#ifndef crisp_util_BufferPool_hh
+#define crisp_util_BufferPool_hh 1
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <crisp/util/Buffer.hh>
+#include <crisp/util/RefCountedObject.hh>
+
+namespace crisp
+{
+  namespace util
+  {
+    /** Size-class pool of heap-allocated Buffer objects.
+     *
+     * Buffers obtained from a pool go back to it -- instead of being freed -- when their last
+     * intrusive reference is released, and are handed out again by later calls to `acquire`
+     * or `slice`.  Once the pool has warmed up, steady-state traffic doesn't touch the heap.
+     *
+     * Data buffers are grouped into power-of-two size classes from `MinSize` to `MaxSize`
+     * bytes; requests for more than `MaxSize` bytes are served by plain heap-allocated
+     * Buffers.  Each outstanding buffer holds a reference to its pool, so a pool lives for
+     * as long as any of its buffers are in use.
+     *
+     * All methods are thread-safe.
+     */
+    class BufferPool : public RefCountedObject
+    {
+    public:
+      /** Data-capacity of the smallest size class. */
+      static constexpr size_t MinSize = 16;
+
+      /** Data-capacity of the largest size class. */
+      static constexpr size_t MaxSize = 65536;
+
+      /** Number of data size classes. */
+      static constexpr size_t NumSizeClasses = 13;
+
+      /** Pool usage statistics. */
+      struct Statistics
+      {
+        size_t hits;          /**< Requests served with a recycled buffer. */
+        size_t misses;        /**< Requests that needed a new buffer to be allocated. */
+        size_t returns;       /**< Buffers returned to the pool for reuse. */
+        size_t discards;      /**< Buffers freed on return because the pool was full. */
+      };
+
+      /** Constructor.
+       *
+       * @param max_free_per_class Maximum number of unused buffers to keep in each size class
+       *     (and for slices).  Buffers returned beyond this limit are freed.
+       */
+      BufferPool(size_t max_free_per_class = 64);
+
+      ~BufferPool();
+
+      /** Get a buffer with room for (at least) the given number of bytes.
+       *
+       * @param length Required buffer size.  The returned buffer's `length` is set to this
+       *     value.
+       *
+       * @return A heap-allocated Buffer, for storage in an intrusive pointer.  Unlike the
+       *     `Buffer(size_t)` constructor, this does not zero the buffer's contents.
+       */
+      Buffer* acquire(size_t length);
+
+      /** Get a buffer that references (without copying) a region of another buffer; this is
+       * the pooled equivalent of `Buffer::slice`.
+       *
+       * @param parent Buffer to reference.
+       *
+       * @param offset Offset of the first byte of the region within @p parent.
+       *
+       * @param length Length of the region.
+       *
+       * @return A heap-allocated Buffer, for storage in an intrusive pointer.
+       */
+      Buffer* slice(Buffer* parent, size_t offset, size_t length);
+
+      /** Get a snapshot of the pool's usage statistics. */
+      Statistics get_statistics() const;
+
+    private:
+      friend class Buffer;
+
+      /** Size-class index used for slices, which have no data of their own. */
+      static constexpr uint8_t SliceClass = NumSizeClasses;
+
+      /** Take back a buffer whose reference count has dropped to zero. */
+      void recycle(Buffer* buffer);
+
+      /** Fetch an unused buffer from a size class, or `nullptr` if there isn't one. */
+      Buffer* take(uint8_t size_class);
+
+      struct FreeList
+      {
+        std::mutex mutex;
+        std::vector<Buffer*> buffers;
+      };
+
+      const size_t m_max_free_per_class;
+      FreeList m_free[NumSizeClasses + 1];
+
+      std::atomic<size_t> m_hits;
+      std::atomic<size_t> m_misses;
+      std::atomic<size_t> m_returns;
+      std::atomic<size_t> m_discards;
+    };
+  }
+}
+
+#endif	/* crisp_util_BufferPool_hh */
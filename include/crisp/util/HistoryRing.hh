@@ -0,0 +1,176 @@
+/** @file
+ *
+ * Defines a lock-free single-writer, multiple-reader ring buffer that keeps the most recent
+ * items written to it.
+ */
+#ifndef crisp_util_HistoryRing_hh
+#define crisp_util_HistoryRing_hh 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace crisp
+{
+  namespace util
+  {
+    /** Fixed-capacity ring of the most recent items pushed by a single writer, readable by any
+     * number of threads at once without locking.
+     *
+     * Each item pushed gets the next index, starting from zero; the ring retains the items
+     * with the last `capacity()` indices.  The writer never waits for readers -- it simply
+     * overwrites the oldest item -- and readers never block the writer.  A reader that copies
+     * an item while the writer is overwriting it notices, and discards that copy.
+     *
+     * Items are stored as arrays of atomic 64-bit words, so `_Tp` must be trivially copyable
+     * and a multiple of eight bytes in size.
+     *
+     * @warning `push` may only be called by one thread at a time (the writer).
+     */
+    template < typename _Tp >
+    class HistoryRing
+    {
+      static_assert(std::is_trivially_copyable<_Tp>::value, "HistoryRing items must be trivially copyable");
+      static_assert(sizeof(_Tp) % sizeof(uint64_t) == 0, "HistoryRing item size must be a multiple of 8");
+
+      static constexpr size_t Words = sizeof(_Tp) / sizeof(uint64_t);
+
+      /** Check whether an item copied from its slot was overwritten while being copied.  Call
+          after copying, with an acquire fence in between.  */
+      inline bool
+      overwritten(uint64_t index) const
+      { return index + m_capacity < m_claimed.load(std::memory_order_relaxed); }
+
+      /** Copy an item out of its slot. */
+      inline void
+      load(uint64_t index, _Tp& out) const
+      {
+        uint64_t words[Words];
+        const std::atomic<uint64_t>* slot ( &m_words[(index % m_capacity) * Words] );
+        for ( size_t i ( 0 ); i < Words; ++i )
+          words[i] = slot[i].load(std::memory_order_relaxed);
+        memcpy(&out, words, sizeof(_Tp));
+      }
+
+    public:
+      /** Constructor.
+       *
+       * @param capacity Number of items to retain.  Must be non-zero.
+       */
+      HistoryRing(size_t capacity)
+        : m_words ( new std::atomic<uint64_t>[capacity * Words] ),
+          m_capacity ( capacity ),
+          m_claimed ( 0 ),
+          m_committed ( 0 )
+      {
+        for ( size_t i ( 0 ); i < capacity * Words; ++i )
+          m_words[i].store(0, std::memory_order_relaxed);
+      }
+
+      HistoryRing(const HistoryRing&) = delete;
+      HistoryRing& operator =(const HistoryRing&) = delete;
+
+      /** Get the number of items retained. */
+      inline size_t
+      capacity() const
+      { return m_capacity; }
+
+      /** Get the index one past that of the newest item. */
+      inline uint64_t
+      end() const
+      { return m_committed.load(std::memory_order_acquire); }
+
+      /** Get the index of the oldest item still retained.  Items older than this one may be
+          overwritten at any time.  */
+      inline uint64_t
+      begin() const
+      { uint64_t e ( end() );
+        return e > m_capacity ? e - m_capacity : 0; }
+
+      /** Append an item, overwriting the oldest one if the ring is full.  Writer only.
+       *
+       * @param item Item to append.
+       */
+      void
+      push(const _Tp& item)
+      {
+        uint64_t index ( m_committed.load(std::memory_order_relaxed) );
+
+        /* Announce the overwrite before starting it, so that a reader that sees any part of
+           the new item also sees that the old one is gone.  */
+        m_claimed.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        uint64_t words[Words];
+        memcpy(words, &item, sizeof(_Tp));
+        std::atomic<uint64_t>* slot ( &m_words[(index % m_capacity) * Words] );
+        for ( size_t i ( 0 ); i < Words; ++i )
+          slot[i].store(words[i], std::memory_order_relaxed);
+
+        m_committed.store(index + 1, std::memory_order_release);
+      }
+
+      /** Copy a single item.
+       *
+       * @param index Index of the item wanted.
+       *
+       * @param out Receives the item, on success.
+       *
+       * @return `true` if the item was copied, or `false` if it hasn't been written yet or has
+       *     been overwritten.
+       */
+      bool
+      get(uint64_t index, _Tp& out) const
+      {
+        if ( index >= end() || index + m_capacity < m_claimed.load(std::memory_order_relaxed) )
+          return false;
+        load(index, out);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return ! overwritten(index);
+      }
+
+      /** Copy every retained item from a given index onwards.
+       *
+       * @param first Index of the first item wanted.
+       *
+       * @param out Receives the items, oldest first.  Its previous contents are discarded.
+       *
+       * @return Index of the first item copied, which is later than @p first if that item had
+       *     already been overwritten.
+       */
+      uint64_t
+      read(uint64_t first, std::vector<_Tp>& out) const
+      {
+        uint64_t e ( end() );
+        uint64_t b ( e > m_capacity ? e - m_capacity : 0 );
+        if ( first < b )
+          first = b;
+
+        out.resize(first < e ? e - first : 0);
+        for ( size_t i ( 0 ); i < out.size(); ++i )
+          load(first + i, out[i]);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        /* Drop anything the writer got to while we were copying. */
+        size_t lost ( 0 );
+        while ( lost < out.size() && overwritten(first + lost) )
+          ++lost;
+        if ( lost )
+          out.erase(out.begin(), out.begin() + lost);
+        return first + lost;
+      }
+
+    private:
+      std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+      const size_t m_capacity;
+      std::atomic<uint64_t> m_claimed;	/**< One past the index of the item being written. */
+      std::atomic<uint64_t> m_committed; /**< One past the index of the newest complete item. */
+    };
+  }
+}
+
+#endif  /* crisp_util_HistoryRing_hh */
@@ -0,0 +1,188 @@
+/** @file
+ *
+ * Defines a lock-free multiple-producer, single-consumer queue.
+ */
+#ifndef crisp_util_MPSCQueue_hh
+#define crisp_util_MPSCQueue_hh 1
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+#include <crisp/util/ObjectPool.hh>
+
+namespace crisp
+{
+  namespace util
+  {
+    /** Lock-free queue for passing items from any number of producer threads to a single
+     * consumer.
+     *
+     * Producers push onto a shared singly-linked list with a single compare-and-swap, and never
+     * block; the consumer takes the whole list at once (with a single atomic exchange) and
+     * then works through it privately, in the order the items were pushed.  List nodes come
+     * from a pool preallocated at construction (see `ObjectPool`), so a queue whose backlog
+     * stays within the pool's capacity never touches the heap.
+     *
+     * The queue does not provide a way to wait for items.  Instead, `push` and `emplace`
+     * report whether the queue was empty beforehand: a consumer that checks the queue before
+     * going to sleep can rely on the producer that ends that emptiness to wake it up.
+     *
+     * @warning `try_pop`, `empty`, and `clear` may only be called by one thread at a time
+     *     (the consumer).
+     */
+    template < typename _Tp >
+    class MPSCQueue
+    {
+    protected:
+      /** List node holding a single queued item. */
+      struct Node
+      {
+        template < typename... Args >
+        Node(Args&&... args)
+          : next ( nullptr ),
+            value ( std::forward<Args>(args)... )
+        {}
+
+        Node* next;
+        _Tp value;
+      };
+
+      /** Storage for list nodes. */
+      ObjectPool<Node> m_nodes;
+
+      /** Most recently pushed item, linked to the items pushed before it.  This is the only
+          part of the queue shared between threads (besides `m_nodes`).  */
+      std::atomic<Node*> m_incoming;
+
+      /** Items already taken from `m_incoming` by the consumer, oldest first. */
+      Node* m_pending;
+
+      /** Link a new node into the incoming list.
+       *
+       * @return `true` if the queue was empty.
+       */
+      inline bool
+      push_node(Node* node)
+      {
+        Node* top ( m_incoming.load(std::memory_order_relaxed) );
+        do
+          node->next = top;
+        while ( ! m_incoming.compare_exchange_weak(top, node,
+                                                   std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed) );
+        return top == nullptr;
+      }
+
+      /** Free every node in a list. */
+      void
+      destroy(Node* list)
+      {
+        while ( list )
+          {
+            Node* next ( list->next );
+            m_nodes.destroy(list);
+            list = next;
+          }
+      }
+
+    public:
+      /** Constructor.
+       *
+       * @param reserve Number of list nodes to preallocate.  Items pushed while this many
+       *     are already queued are stored in nodes allocated on the heap.
+       */
+      MPSCQueue(size_t reserve = 0)
+        : m_nodes ( reserve ),
+          m_incoming ( nullptr ),
+          m_pending ( nullptr )
+      {}
+
+      MPSCQueue(const MPSCQueue&) = delete;
+      MPSCQueue& operator =(const MPSCQueue&) = delete;
+
+      ~MPSCQueue()
+      { clear(); }
+
+      /** Construct an item in-place at the end of the queue.
+       *
+       * @param args Arguments to be passed to the item's constructor.
+       *
+       * @return `true` if the queue was empty before the item was added, and `false`
+       *     otherwise.  Note that "empty" here does not count items that the consumer has
+       *     already taken out of the shared list but not yet popped.
+       */
+      template < typename... Args >
+      inline bool
+      emplace(Args&&... args)
+      { return push_node(m_nodes.create(std::forward<Args>(args)...)); }
+
+      /** Push an item onto the queue.
+       *
+       * @param value Value to be added at the end of the queue.
+       *
+       * @return `true` if the queue was empty before the item was added.
+       */
+      inline bool
+      push(const _Tp& value)
+      { return emplace(value); }
+
+      /** Push an item onto the queue.
+       *
+       * @param value Value to be added at the end of the queue.
+       *
+       * @return `true` if the queue was empty before the item was added.
+       */
+      inline bool
+      push(_Tp&& value)
+      { return emplace(std::move(value)); }
+
+      /** Fetch the next item, if one is available.  This method never blocks.  Consumer only.
+       *
+       * @param out Variable into which the fetched item should be moved.
+       *
+       * @return `true` if an item was fetched, and `false` if the queue was empty.
+       */
+      bool
+      try_pop(_Tp& out)
+      {
+        if ( ! m_pending )
+          {
+            /* Take everything pushed so far; it's newest-first, so reverse it.  */
+            Node* list ( m_incoming.exchange(nullptr, std::memory_order_seq_cst) );
+            while ( list )
+              {
+                Node* next ( list->next );
+                list->next = m_pending;
+                m_pending = list;
+                list = next;
+              }
+            if ( ! m_pending )
+              return false;
+          }
+
+        Node* node ( m_pending );
+        m_pending = node->next;
+        out = std::move(node->value);
+        m_nodes.destroy(node);
+        return true;
+      }
+
+      /** Check whether the queue is empty.  Consumer only. */
+      inline bool
+      empty() const
+      { return ! m_pending && ! m_incoming.load(std::memory_order_seq_cst); }
+
+      /** Discard all queued items.  Consumer only. */
+      void
+      clear()
+      {
+        destroy(m_pending);
+        m_pending = nullptr;
+        destroy(m_incoming.exchange(nullptr));
+      }
+    };
+  }
+}
+
+#endif	/* crisp_util_MPSCQueue_hh */
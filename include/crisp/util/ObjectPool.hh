@@ -0,0 +1,167 @@
+/** @file
+ *
+ * Defines a lock-free, fixed-capacity pool of preallocated objects.
+ */
+#ifndef crisp_util_ObjectPool_hh
+#define crisp_util_ObjectPool_hh 1
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace crisp
+{
+  namespace util
+  {
+    /** Lock-free allocator for objects of a single type, from storage preallocated when the
+     * pool is constructed.
+     *
+     * Unused storage is kept on a free list, which `create` and `destroy` update with a single
+     * compare-and-swap each; the list head carries a tag that changes on every update, so a
+     * thread whose view of the list went stale in between simply retries.  When the pool is
+     * exhausted, objects are allocated on the heap instead (and freed there again by
+     * `destroy`), so the capacity only needs to cover the usual number of live objects.
+     *
+     * All methods are thread-safe.
+     *
+     * @warning Every object created from the pool must be passed to `destroy` before the pool
+     *     itself is destroyed.
+     */
+    template < typename _Tp >
+    class ObjectPool
+    {
+      typedef typename std::aligned_storage<sizeof(_Tp), alignof(_Tp)>::type Storage;
+
+      /** Mask for the part of `m_free` holding the index (plus one) of the first free
+          object; the rest holds the tag.  */
+      static constexpr uint64_t IndexMask = 0xFFFFFFFF;
+
+      const size_t m_capacity;
+      std::unique_ptr<Storage[]> m_storage;
+
+      /** Index (plus one) of the free object following each free object, or zero. */
+      std::unique_ptr<std::atomic<uint32_t>[]> m_next;
+
+      /** Index (plus one) of the first free object, or zero, and the tag. */
+      std::atomic<uint64_t> m_free;
+
+      /** Take the first free object's storage off the free list.
+       *
+       * @return Storage for an object, or `nullptr` if there is none free.
+       */
+      void*
+      pop_free()
+      {
+        uint64_t head ( m_free.load(std::memory_order_acquire) );
+        while ( head & IndexMask )
+          {
+            uint32_t index ( static_cast<uint32_t>(head & IndexMask) - 1 );
+            uint64_t next ( (((head >> 32) + 1) << 32) | m_next[index].load(std::memory_order_relaxed) );
+            if ( m_free.compare_exchange_weak(head, next, std::memory_order_acquire,
+                                              std::memory_order_acquire) )
+              return &m_storage[index];
+          }
+        return nullptr;
+      }
+
+      /** Put an object's storage back at the front of the free list. */
+      void
+      push_free(size_t index)
+      {
+        uint64_t head ( m_free.load(std::memory_order_relaxed) ), next;
+        do
+          {
+            m_next[index].store(static_cast<uint32_t>(head & IndexMask), std::memory_order_relaxed);
+            next = (((head >> 32) + 1) << 32) | (index + 1);
+          }
+        while ( ! m_free.compare_exchange_weak(head, next, std::memory_order_release,
+                                               std::memory_order_relaxed) );
+      }
+
+      /** Get the index of an object in the preallocated storage, or `m_capacity` if it was
+          allocated on the heap.  */
+      size_t
+      index_of(const void* object) const
+      {
+        uintptr_t
+          address ( reinterpret_cast<uintptr_t>(object) ),
+          begin ( reinterpret_cast<uintptr_t>(m_storage.get()) );
+        if ( address < begin || address >= begin + m_capacity * sizeof(Storage) )
+          return m_capacity;
+        return (address - begin) / sizeof(Storage);
+      }
+
+    public:
+      /** Constructor.
+       *
+       * @param capacity Number of objects for which to preallocate storage.
+       */
+      ObjectPool(size_t capacity)
+        : m_capacity ( capacity < IndexMask ? capacity : IndexMask - 1 ),
+          m_storage ( m_capacity ? new Storage[m_capacity] : nullptr ),
+          m_next ( m_capacity ? new std::atomic<uint32_t>[m_capacity] : nullptr ),
+          m_free ( m_capacity ? 1 : 0 )
+      {
+        for ( size_t i ( 0 ); i < m_capacity; ++i )
+          m_next[i].store(i + 1 < m_capacity ? i + 2 : 0, std::memory_order_relaxed);
+      }
+
+      ObjectPool(const ObjectPool&) = delete;
+      ObjectPool& operator =(const ObjectPool&) = delete;
+
+      /** Construct an object, in preallocated storage if any is free.
+       *
+       * @param args Arguments to be passed to the object's constructor.
+       */
+      template < typename... Args >
+      _Tp*
+      create(Args&&... args)
+      {
+        void* storage ( pop_free() );
+        if ( ! storage )
+          return new _Tp(std::forward<Args>(args)...);
+
+        try
+          { return new (storage) _Tp(std::forward<Args>(args)...); }
+        catch ( ... )
+          {
+            push_free(index_of(storage));
+            throw;
+          }
+      }
+
+      /** Destroy an object created by `create`, and make its storage available for reuse.
+       *  Does nothing if @p object is null.
+       */
+      void
+      destroy(_Tp* object)
+      {
+        if ( ! object )
+          return;
+
+        size_t index ( index_of(object) );
+        if ( index == m_capacity )
+          delete object;
+        else
+          {
+            object->~_Tp();
+            push_free(index);
+          }
+      }
+
+      /** Get the number of objects for which storage was preallocated. */
+      inline size_t
+      capacity() const
+      { return m_capacity; }
+    };
+
+    template < typename _Tp >
+    constexpr uint64_t ObjectPool<_Tp>::IndexMask;
+  }
+}
+
+#endif	/* crisp_util_ObjectPool_hh */
@@ -43,6 +43,14 @@ namespace crisp
        */
       virtual ~RefCountedObject() throw ( std::runtime_error );
 
+      /** Called when the object's reference count drops to zero.  The default implementation
+       * deletes the object; derived classes may override this to recycle it instead.
+       *
+       * @warning This method is provided for use by intrusive_ptr_release, and is not intended
+       * to be called directly.
+       */
+      virtual void dispose();
+
       std::atomic<ssize_t> refCount;
     };
 
@@ -57,8 +65,8 @@ namespace crisp
       __rco->refCount++;
     }
 
-    /** Decrement the reference count of a RefCountedObject, and delete the
-     * object if its reference count is zero.
+    /** Decrement the reference count of a RefCountedObject, and dispose of
+     * (normally, delete) the object if its reference count is zero.
      *
      * @warning This function is provided for integration with
      * boost::intrusive_ptr, and is not intended to be called directly.
@@ -67,7 +75,7 @@ namespace crisp
     intrusive_ptr_release(crisp::util::RefCountedObject* __rco)
     {
       if ( !  --(__rco->refCount) )
-        delete __rco;
+        __rco->dispose();
     }
   }
 }
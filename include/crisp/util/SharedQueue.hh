@@ -132,6 +132,22 @@ namespace crisp
 	Base::pop(); }
     
 
+      /** Fetch the next entry if one is available.  Unlike `next`, this method never blocks.
+       *
+       * @param out Variable into which the fetched item should be moved.
+       *
+       * @return `true` if an item was fetched, and `false` if the queue was empty.
+       */
+      inline bool
+      try_next(_Tp& out)
+      { std::unique_lock<Mutex> lock ( m_mutex );
+        if ( empty() )
+          return false;
+        out = std::move(front());
+        Base::pop();
+        return true;
+      }
+
       /** Fetch the next available entry.  If the queue is currently empty, this method will block
        *  the current thread until another thread enqueues an object.
        *
@@ -133,6 +133,14 @@ namespace crisp
        * @param args Arguments to be passed to the connected callbacks.
        */
       void emit(Args... args);
+
+      /** Emit the signal, invoking all callbacks in the calling thread before returning --
+       * regardless of whether an `io_service` has been set.  Since nothing is posted, the
+       * arguments need only remain valid for the duration of the call.
+       *
+       * @param args Arguments to be passed to the connected callbacks.
+       */
+      void emit_blocking(Args... args);
     };
   }
 }
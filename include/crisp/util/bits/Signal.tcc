@@ -100,6 +100,12 @@ namespace crisp
     void
     Signal<Return(Args...)>::emit(Args... args)
     {
+      if ( ! m_io_service )
+        {
+          emit_blocking(args...);
+          return;
+        }
+
       if ( m_actions.empty() )
         return;
 
@@ -126,24 +132,12 @@ namespace crisp
       lock.unlock();
 
 
-      /* Invoke the user callbacks as appropriate. */
-      if ( m_io_service )
-        {
-          for ( size_t j ( 0 ); j < i; ++j )
-            {
-              std::shared_ptr<Action> action ( actions[j].lock() );
-              if ( action )
-                m_io_service->post(std::bind(action->m_function, forward_for_bind(args)...));
-            }
-        }
-      else
+      /* Post the user callbacks to the io_service. */
+      for ( size_t j ( 0 ); j < i; ++j )
         {
-          for ( size_t j ( 0 ); j < i; ++j )
-            {
-              std::shared_ptr<Action> action ( actions[j].lock() );
-              if ( action )
-                action->m_function(args...);
-            }
+          std::shared_ptr<Action> action ( actions[j].lock() );
+          if ( action )
+            m_io_service->post(std::bind(action->m_function, forward_for_bind(args)...));
         }
 
 
@@ -153,6 +147,36 @@ namespace crisp
         actions[j].~weak_ptr();
     }
 
+    template < typename Return, typename... Args >
+    void
+    Signal<Return(Args...)>::emit_blocking(Args... args)
+    {
+      if ( m_actions.empty() )
+        return;
+
+      /* As in `emit`, we copy the action list (onto the stack) so that the lock isn't held
+         while the callbacks run.  */
+      size_t i ( 0 );
+
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      std::weak_ptr<Action>* actions
+        ( static_cast<std::weak_ptr<Action>*>(alloca(m_actions.size() *
+                                                     sizeof(std::shared_ptr<Action>))) );
+      for ( const std::shared_ptr<Action>& action : m_actions )
+        new ( &actions[i++] ) std::weak_ptr<Action>(action);
+      lock.unlock();
+
+      for ( size_t j ( 0 ); j < i; ++j )
+        {
+          std::shared_ptr<Action> action ( actions[j].lock() );
+          if ( action )
+            action->m_function(args...);
+        }
+
+      for ( size_t j ( 0 ); j < i; ++j )
+        actions[j].~weak_ptr();
+    }
+
     template < typename Return, typename... Args >
     void
     Signal<Return(Args...)>::clear()
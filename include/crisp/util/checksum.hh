@@ -9,7 +9,93 @@ namespace crisp
 {
   namespace util
   {
+    /** Available CRC-32 computation strategies.  All of them produce identical results; they
+     * differ only in speed and in the hardware they require.
+     */
+    enum class CRC32Kernel
+      {
+        BYTEWISE,		/**< Classic one-table, one-byte-at-a-time reference loop. */
+        SLICE_BY_8,		/**< Eight-table, eight-bytes-per-iteration loop. */
+        SLICE_BY_16,		/**< Sixteen-table, sixteen-bytes-per-iteration loop. */
+        CLMUL			/**< x86 carry-less-multiply (PCLMULQDQ) folding. */
+      };
+
+    /** Compute the CRC-32 (IEEE 802.3) checksum of a block of memory.
+     *
+     * @param data Pointer to the data to checksum.
+     *
+     * @param length Number of bytes at `data`.
+     *
+     * @return CRC-32 of the given data.
+     */
     uint32_t crc32(const void* data, size_t length);
+
+
+    /** @name Incremental interface
+     *
+     * Checksum data that is not contiguous in memory by threading a running state through
+     * multiple calls:
+     *
+     *     uint32_t state ( crc32_begin() );
+     *     state = crc32_update(state, header, header_length);
+     *     state = crc32_update(state, body, body_length);
+     *     uint32_t crc ( crc32_finish(state) );
+     *
+     * The result is identical to that of `crc32` over the concatenated data.
+     */
+    ///@{
+
+    /** Get the initial running state for an incremental CRC-32 computation. */
+    constexpr inline uint32_t
+    crc32_begin()
+    { return 0xFFFFFFFF; }
+
+    /** Feed a block of data into a running CRC-32 state.
+     *
+     * @param state Running state, as returned by `crc32_begin` or a previous call to
+     *     `crc32_update`.
+     *
+     * @param data Pointer to the data to add.
+     *
+     * @param length Number of bytes at `data`.
+     *
+     * @return Updated running state.
+     */
+    uint32_t crc32_update(uint32_t state, const void* data, size_t length);
+
+    /** Convert a running CRC-32 state to the final checksum value. */
+    constexpr inline uint32_t
+    crc32_finish(uint32_t state)
+    { return state ^ 0xFFFFFFFF; }
+
+    ///@}
+
+
+    /** Feed a block of data into a running CRC-32 state using a specific kernel.  This exists
+     * mostly for testing and benchmarking; normal code should use the kernel-agnostic
+     * `crc32_update`, which picks the fastest kernel supported by the running CPU.
+     *
+     * @param kernel Kernel to use.  Must be supported on this machine (see
+     *     `crc32_kernel_supported`).
+     *
+     * @param state Running state.
+     *
+     * @param data Pointer to the data to add.
+     *
+     * @param length Number of bytes at `data`.
+     *
+     * @return Updated running state.
+     */
+    uint32_t crc32_update(CRC32Kernel kernel, uint32_t state, const void* data, size_t length);
+
+    /** Check whether a CRC-32 kernel can run on this machine. */
+    bool crc32_kernel_supported(CRC32Kernel kernel);
+
+    /** Get the kernel used by `crc32` and `crc32_update`, as selected at run time. */
+    CRC32Kernel crc32_default_kernel();
+
+    /** Get a human-readable name for a CRC-32 kernel. */
+    const char* crc32_kernel_name(CRC32Kernel kernel);
   }
 }
 
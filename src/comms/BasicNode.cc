@@ -10,5 +10,9 @@ namespace crisp
   namespace comms
   {
     template class BasicNode<boost::asio::ip::tcp>;
+    template class BasicNode<boost::asio::ip::udp>;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    template class BasicNode<boost::asio::local::stream_protocol>;
+#endif
   }
 }
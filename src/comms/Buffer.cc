@@ -30,6 +30,13 @@ namespace crisp
 	offset ( 0 )
     {}
 
+    MemoryEncodeBuffer::MemoryEncodeBuffer(size_t size, crisp::util::BufferPool& pool)
+      : buffer ( pool.acquire(size) ),
+	data ( buffer->data ),
+	length ( buffer->length ),
+	offset ( 0 )
+    {}
+
     MemoryEncodeBuffer::MemoryEncodeBuffer(Buffer* b)
       : buffer ( b ),
 	data ( b->data ),
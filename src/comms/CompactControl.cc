@@ -0,0 +1,322 @@
+#include <crisp/comms/CompactControl.hh>
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+#include <cstring>
+
+namespace crisp
+{
+  namespace comms
+  {
+    constexpr uint8_t CompactControlCodec::FLAG_DELTA;
+    constexpr uint16_t CompactControlCodec::KeyframeInterval;
+
+    /** Size of the fixed part of an encoded ModuleControl: module ID and input-ID field. */
+    static const size_t FullHeaderSize ( sizeof(uint8_t) + sizeof(uint16_t) );
+
+    /** Largest possible compact body: flags, module ID, two 16-bit varint fields, and a
+        ten-byte varint for each input.  */
+    static const size_t MaxCompactSize ( 2 + 2 * 3 + 10 * MODULE_MAX_INPUTS );
+
+    /** Input-ID bit marking a "clear" control (see `ModuleControl::is_clear`). */
+    static const uint16_t ClearBit ( 1 << 15 );
+
+
+    static inline uint8_t*
+    put_varint(uint8_t* p, uint64_t v)
+    {
+      while ( v >= 0x80 )
+        {
+          *p++ = static_cast<uint8_t>(v) | 0x80;
+          v >>= 7;
+        }
+      *p++ = static_cast<uint8_t>(v);
+      return p;
+    }
+
+    /** Read a varint, returning `false` if it runs past `end` or is too long. */
+    static inline bool
+    get_varint(const uint8_t*& p, const uint8_t* end, uint64_t& v)
+    {
+      v = 0;
+      for ( unsigned shift ( 0 ); p < end && shift < 64; shift += 7 )
+        {
+          uint8_t b ( *p++ );
+          v |= static_cast<uint64_t>(b & 0x7F) << shift;
+          if ( ! (b & 0x80) )
+            return true;
+        }
+      return false;
+    }
+
+    static inline uint64_t
+    zigzag(int64_t v)
+    { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+
+    static inline int64_t
+    unzigzag(uint64_t v)
+    { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    /** Check whether values of a data type can be sent in compact form. */
+    static inline bool
+    compactable(const DataDeclaration<>& type)
+    {
+      return ! type.is_array && type.width > 0 && type.width <= 8 &&
+        ( type.type == DataType::BOOLEAN || type.type == DataType::INTEGER ||
+          ( type.type == DataType::FLOAT && ( type.width == 4 || type.width == 8 ) ) );
+    }
+
+    /** Whether a data type's values are sent as varints (as opposed to raw bytes). */
+    static inline bool
+    is_integral(const DataDeclaration<>& type)
+    { return type.type != DataType::FLOAT; }
+
+    /** Widen a raw encoded value to the form kept in the codec's state. */
+    static inline uint64_t
+    load_value(const uint8_t* p, const DataDeclaration<>& type)
+    {
+      uint64_t v ( 0 );
+      memcpy(&v, p, type.width);
+      if ( type.type == DataType::INTEGER && type.is_signed && type.width < 8 )
+        {
+          unsigned shift ( 64 - 8 * type.width );
+          v = static_cast<uint64_t>(static_cast<int64_t>(v << shift) >> shift);
+        }
+      return v;
+    }
+
+    /** Find the module a control is addressed to, or `nullptr` if it's unknown or has an input
+        that can't be compacted.  */
+    static const Module*
+    find_module(const Configuration& config, uint8_t module_id, uint16_t input_ids)
+    {
+      if ( module_id >= config.num_modules )
+        return nullptr;
+
+      const Module& module ( config.modules[module_id] );
+      for ( uint8_t i ( 0 ); i < 15; ++i )
+        if ( input_ids & (1 << i) )
+          {
+            if ( i >= module.num_inputs || ! compactable(module.inputs[i].data_type) )
+              return nullptr;
+          }
+      return &module;
+    }
+
+    /** Point a message at a new body, copied from `data`. */
+    static void
+    set_body(Message& out, MessageType type, const uint8_t* data, size_t length,
+             crisp::util::BufferPool* pool)
+    {
+      out.header.type = type;
+      out.header.length = length + MESSAGE_CHECKSUM_SIZE;
+      out.body.reset(pool ? pool->acquire(length) : new crisp::util::Buffer(length));
+      memcpy(out.body->data, data, length);
+      out.invalidate_checksum();
+      out.checksum = out.compute_checksum();
+    }
+
+
+    CompactControlCodec::CompactControlCodec()
+      : m_modules ( )
+    {}
+
+    CompactControlCodec::ModuleState&
+    CompactControlCodec::module_state(uint8_t module_id)
+    {
+      if ( module_id >= m_modules.size() )
+        m_modules.resize(module_id + 1, ModuleState { { }, 0, 0 });
+      ModuleState& state ( m_modules[module_id] );
+      if ( state.last.empty() )
+        state.last.assign(MODULE_MAX_INPUTS, 0);
+      return state;
+    }
+
+    void
+    CompactControlCodec::reset()
+    { m_modules.clear(); }
+
+    bool
+    CompactControlCodec::compact(const Message& in, const Configuration& config, bool delta,
+                                 crisp::util::BufferPool* pool, Message& out)
+    {
+      if ( in.header.type != MessageType::MODULE_CONTROL || ! in.body ||
+           in.body->length < FullHeaderSize )
+        return false;
+
+      const uint8_t* src ( reinterpret_cast<const uint8_t*>(in.body->data) );
+      const uint8_t* src_end ( src + in.body->length );
+      uint8_t module_id ( src[0] );
+      uint16_t input_ids;
+      memcpy(&input_ids, src + 1, sizeof(input_ids));
+      src += FullHeaderSize;
+
+      const Module* module ( find_module(config, module_id, input_ids) );
+      if ( ! module )
+        return false;
+
+      /* Send the message in full if it's a clear, starts a keyframe, or sets an input the
+         decoder hasn't been sent in full since the last one.  */
+      bool clear ( input_ids & ClearBit );
+      ModuleState& state ( module_state(module_id) );
+      bool keyframe ( state.since_keyframe >= KeyframeInterval );
+      if ( clear || keyframe || (input_ids & ~state.known) )
+        delta = false;
+
+      /* Read the new values, and find the ones that changed.  The state is only updated once
+         we know the compact form will be sent.  */
+      uint64_t* last ( state.last.data() );
+      uint64_t values[MODULE_MAX_INPUTS];
+      uint16_t changed ( 0 );
+      if ( ! clear )
+        for ( uint8_t i ( 0 ); i < module->num_inputs; ++i )
+          if ( input_ids & (1 << i) )
+            {
+              const DataDeclaration<>& type ( module->inputs[i].data_type );
+              if ( src + type.width > src_end )
+                return false;
+              values[i] = load_value(src, type);
+              src += type.width;
+              if ( ! delta || values[i] != last[i] )
+                changed |= 1 << i;
+            }
+
+      uint8_t buf[MaxCompactSize];
+      uint8_t* p ( buf );
+      *p++ = delta ? FLAG_DELTA : 0;
+      *p++ = module_id;
+      p = put_varint(p, input_ids);
+      if ( delta )
+        p = put_varint(p, changed);
+
+      for ( uint8_t i ( 0 ); i < module->num_inputs; ++i )
+        if ( changed & (1 << i) )
+          {
+            const DataDeclaration<>& type ( module->inputs[i].data_type );
+            if ( ! is_integral(type) )
+              {
+                memcpy(p, &values[i], type.width);
+                p += type.width;
+              }
+            else if ( delta )
+              p = put_varint(p, zigzag(static_cast<int64_t>(values[i] - last[i])));
+            else if ( type.is_signed )
+              p = put_varint(p, zigzag(static_cast<int64_t>(values[i])));
+            else
+              p = put_varint(p, values[i]);
+          }
+
+      size_t length ( p - buf );
+      if ( length >= in.body->length )
+        return false;
+
+      if ( ! clear )
+        for ( uint8_t i ( 0 ); i < module->num_inputs; ++i )
+          if ( input_ids & (1 << i) )
+            last[i] = values[i];
+      if ( keyframe )
+        {
+          state.known = 0;
+          state.since_keyframe = 0;
+        }
+      if ( ! clear && ! delta )
+        state.known |= input_ids;
+      ++state.since_keyframe;
+
+      set_body(out, MessageType::MODULE_CONTROL_COMPACT, buf, length, pool);
+      out.queued_at = in.queued_at;
+      return true;
+    }
+
+    bool
+    CompactControlCodec::expand(const Message& in, const Configuration& config,
+                                crisp::util::BufferPool* pool, Message& out)
+    {
+      if ( in.header.type != MessageType::MODULE_CONTROL_COMPACT || ! in.body ||
+           in.body->length < 3 )
+        return false;
+
+      const uint8_t* src ( reinterpret_cast<const uint8_t*>(in.body->data) );
+      const uint8_t* src_end ( src + in.body->length );
+      uint8_t flags ( *src++ );
+      uint8_t module_id ( *src++ );
+      uint64_t input_ids, changed;
+      if ( (flags & ~FLAG_DELTA) || ! get_varint(src, src_end, input_ids) || input_ids > UINT16_MAX )
+        return false;
+
+      bool delta ( flags & FLAG_DELTA ), clear ( input_ids & ClearBit );
+      if ( delta )
+        {
+          if ( clear || ! get_varint(src, src_end, changed) || (changed & ~input_ids) )
+            return false;
+        }
+      else
+        changed = clear ? 0 : input_ids;
+
+      const Module* module ( find_module(config, module_id, input_ids) );
+      if ( ! module )
+        return false;
+
+      /* A delta from values we don't have would silently produce the wrong ones.  */
+      ModuleState& state ( module_state(module_id) );
+      if ( delta && (input_ids & ~state.known) )
+        return false;
+
+      /* Decode into a scratch copy of the state, so a malformed message leaves it untouched. */
+      uint64_t* last ( state.last.data() );
+      uint64_t values[MODULE_MAX_INPUTS];
+      size_t length ( FullHeaderSize );
+      if ( ! clear )
+        for ( uint8_t i ( 0 ); i < module->num_inputs; ++i )
+          if ( input_ids & (1 << i) )
+            {
+              const DataDeclaration<>& type ( module->inputs[i].data_type );
+              length += type.width;
+              values[i] = last[i];
+              if ( ! (changed & (1 << i)) )
+                continue;
+
+              uint64_t v;
+              if ( ! is_integral(type) )
+                {
+                  if ( src + type.width > src_end )
+                    return false;
+                  values[i] = load_value(src, type);
+                  src += type.width;
+                }
+              else if ( ! get_varint(src, src_end, v) )
+                return false;
+              else if ( delta )
+                values[i] = last[i] + static_cast<uint64_t>(unzigzag(v));
+              else if ( type.is_signed )
+                values[i] = static_cast<uint64_t>(unzigzag(v));
+              else
+                values[i] = v;
+            }
+      if ( src != src_end )
+        return false;
+
+      uint8_t buf[FullHeaderSize + 8 * MODULE_MAX_INPUTS];
+      uint16_t ids ( input_ids );
+      uint8_t* p ( buf );
+      *p++ = module_id;
+      memcpy(p, &ids, sizeof(ids));
+      p += sizeof(ids);
+      if ( ! clear )
+        for ( uint8_t i ( 0 ); i < module->num_inputs; ++i )
+          if ( input_ids & (1 << i) )
+            {
+              memcpy(p, &values[i], module->inputs[i].data_type.width);
+              p += module->inputs[i].data_type.width;
+              last[i] = values[i];
+            }
+      if ( ! clear && ! delta )
+        state.known |= input_ids;
+
+      set_body(out, MessageType::MODULE_CONTROL, buf, length, pool);
+      out.queued_at = in.queued_at;
+      return true;
+    }
+  }
+}
@@ -1,6 +1,7 @@
 #include <crisp/comms/Configuration.hh>
 #include <crisp/comms/Message.hh>
 #include <cstdio>
+#include <cstring>
 
 namespace crisp
 {
@@ -10,22 +11,87 @@ namespace crisp
     Configuration::HeaderSize =
       offsetof(Configuration, modules);
 
+    /** Continue a 32-bit FNV-1a hash over a name. */
+    static inline uint32_t
+    hash_name(uint32_t h, const char* name, size_t length)
+    {
+      for ( size_t i ( 0 ); i < length; ++i )
+	h = (h ^ static_cast<uint8_t>(name[i])) * 16777619u;
+      return h;
+    }
+
+    /** Hash of the key under which an item is indexed: its kind, its module's name, and its own
+	name.  */
+    static inline uint32_t
+    hash_key(NameKind kind, const char* module_name, size_t module_length,
+	     const char* item_name, size_t item_length)
+    {
+      uint32_t h ( (2166136261u ^ static_cast<uint8_t>(kind)) * 16777619u );
+      h = hash_name(h, module_name, module_length) * 16777619u; /* Separator. */
+      return hash_name(h, item_name, item_length);
+    }
+
+    /** Count the modules, inputs and sensors in a configuration. */
+    static inline size_t
+    count_items(const Configuration& config)
+    {
+      size_t count ( config.num_modules );
+      for ( uint8_t i ( 0 ); i < config.num_modules; ++i )
+	count += config.modules[i].num_inputs + config.modules[i].num_sensors;
+      return count;
+    }
+
+    static inline bool
+    name_equals(const char* a, size_t a_length, const char* b, size_t b_length)
+    { return a_length == b_length && (a_length == 0 || ! memcmp(a, b, a_length)); }
+
+    /** Check whether a handle's item has the given names. */
+    static bool
+    handle_matches(const Configuration& config, NameHandle handle,
+		   const char* module_name, size_t module_length,
+		   const char* item_name, size_t item_length)
+    {
+      const Module* module ( config.get_module(handle) );
+      if ( ! module || ! name_equals(module->name, module->name_length, module_name, module_length) )
+	return false;
+
+      switch ( handle.kind )
+	{
+	case NameKind::MODULE:
+	  return true;
+	case NameKind::INPUT:
+	  { const ModuleInput<>* input ( config.get_input(handle) );
+	    return input && name_equals(input->name, input->get_name_length(), item_name, item_length); }
+	case NameKind::SENSOR:
+	  { const Sensor<>* sensor ( config.get_sensor(handle) );
+	    return sensor && name_equals(sensor->name, sensor->get_name_length(), item_name, item_length); }
+	default:
+	  return false;
+	}
+    }
+
     Configuration::Configuration(uint8_t modules_alloc)
       : num_modules ( 0 ),
 	modules ( modules_alloc ),
-	next_module_id ( 0 )
+	next_module_id ( 0 ),
+	name_index ( ),
+	indexed_items ( 0 )
     {}
 
     Configuration::Configuration(const Configuration& config)
       : num_modules ( config.num_modules ),
         modules ( config.modules ),
-        next_module_id ( config.next_module_id )
+        next_module_id ( config.next_module_id ),
+        name_index ( config.name_index ),
+        indexed_items ( config.indexed_items )
     {}
 
     Configuration::Configuration(Configuration&& c)
       : num_modules ( c.num_modules ),
 	modules ( std::move(c.modules) ),
-	next_module_id ( c.next_module_id )
+	next_module_id ( c.next_module_id ),
+	name_index ( std::move(c.name_index) ),
+	indexed_items ( c.indexed_items )
     {}
 
     Configuration::~Configuration()
@@ -36,6 +102,8 @@ namespace crisp
       num_modules = 0;
       modules.clear();
       next_module_id = 0;
+      name_index.clear();
+      indexed_items = 0;
     }
 
     Configuration&
@@ -44,6 +112,8 @@ namespace crisp
       num_modules = c.num_modules;
       modules = c.modules;
       next_module_id = c.next_module_id;
+      name_index = c.name_index;
+      indexed_items = c.indexed_items;
       return *this;
     }
 
@@ -54,6 +124,8 @@ namespace crisp
       num_modules = c.num_modules;
       modules = std::move(c.modules);
       next_module_id = c.next_module_id;
+      name_index = std::move(c.name_index);
+      indexed_items = c.indexed_items;
       return *this;
     }
 
@@ -113,9 +185,130 @@ namespace crisp
 	    if ( (r = modules.emplace().decode(buf)) != DecodeResult::SUCCESS )
 	      return r;
 	}
+      if ( num_modules && modules.data )
+	next_module_id = modules.back().id + 1;
 
+      build_index();
       return DecodeResult::SUCCESS;
     }
 
+
+    void
+    Configuration::build_index()
+    {
+      size_t count ( count_items(*this) ), capacity ( 8 );
+      while ( capacity < 2 * count )
+	capacity *= 2;
+
+      name_index.clear();
+      name_index.ensure_capacity(capacity);
+      for ( size_t i ( 0 ); i < capacity; ++i )
+	name_index.emplace();
+      indexed_items = count;
+
+      auto insert ( [this, capacity](uint32_t hash, NameHandle handle)
+		    { size_t i ( hash & (capacity - 1) );
+		      while ( name_index[i].handle )
+			i = (i + 1) & (capacity - 1);
+		      name_index[i] = { hash, handle }; } );
+
+      for ( uint8_t i ( 0 ); i < num_modules; ++i )
+	{
+	  const Module& module ( modules[i] );
+	  insert(hash_key(NameKind::MODULE, module.name, module.name_length, nullptr, 0),
+		 { NameKind::MODULE, module.id, 0 });
+	  for ( const ModuleInput<>& input : module.inputs )
+	    insert(hash_key(NameKind::INPUT, module.name, module.name_length, input.name, input.get_name_length()),
+		   { NameKind::INPUT, module.id, input.input_id });
+	  for ( const Sensor<>& sensor : module.sensors )
+	    insert(hash_key(NameKind::SENSOR, module.name, module.name_length, sensor.name, sensor.get_name_length()),
+		   { NameKind::SENSOR, module.id, static_cast<uint8_t>(sensor.id) });
+	}
+    }
+
+    NameHandle
+    Configuration::find(NameKind kind, const char* module_name, const char* item_name) const
+    {
+      size_t module_length ( strlen(module_name) ), item_length ( item_name ? strlen(item_name) : 0 );
+
+      if ( name_index.data && name_index.size > 0 )
+	{
+	  uint32_t hash ( hash_key(kind, module_name, module_length, item_name, item_length) );
+	  size_t mask ( name_index.size - 1 );
+	  for ( size_t i ( hash & mask ); name_index[i].handle; i = (i + 1) & mask )
+	    if ( name_index[i].hash == hash && name_index[i].handle.kind == kind &&
+		 handle_matches(*this, name_index[i].handle, module_name, module_length, item_name, item_length) )
+	      return name_index[i].handle;
+
+	  /* An index of every item is conclusive.  */
+	  if ( count_items(*this) == indexed_items )
+	    return { NameKind::NONE, 0, 0 };
+	}
+
+      /* No index has been built, or items have been added (e.g. by `Module::add_input`)
+	 since it was; search linearly.  Index hits are checked against the names themselves,
+	 so a stale index never returns the wrong item.  */
+      for ( uint8_t i ( 0 ); i < num_modules; ++i )
+	{
+	  const Module& module ( modules[i] );
+	  NameHandle handle { kind, module.id, 0 };
+	  if ( kind == NameKind::INPUT )
+	    for ( const ModuleInput<>& input : module.inputs )
+	      { handle.item_id = input.input_id;
+		if ( handle_matches(*this, handle, module_name, module_length, item_name, item_length) )
+		  return handle; }
+	  else if ( kind == NameKind::SENSOR )
+	    for ( const Sensor<>& sensor : module.sensors )
+	      { handle.item_id = sensor.id;
+		if ( handle_matches(*this, handle, module_name, module_length, item_name, item_length) )
+		  return handle; }
+	  else if ( handle_matches(*this, handle, module_name, module_length, item_name, item_length) )
+	    return handle;
+	}
+
+      return { NameKind::NONE, 0, 0 };
+    }
+
+    NameHandle
+    Configuration::find_module(const char* module_name) const
+    { return find(NameKind::MODULE, module_name, nullptr); }
+
+    NameHandle
+    Configuration::find_input(const char* module_name, const char* input_name) const
+    { return find(NameKind::INPUT, module_name, input_name); }
+
+    NameHandle
+    Configuration::find_sensor(const char* module_name, const char* sensor_name) const
+    { return find(NameKind::SENSOR, module_name, sensor_name); }
+
+    const Module*
+    Configuration::get_module(NameHandle handle) const
+    {
+      if ( handle && handle.module_id < num_modules && modules[handle.module_id].id == handle.module_id )
+	return &(modules[handle.module_id]);
+      else
+	return nullptr;
+    }
+
+    const ModuleInput<>*
+    Configuration::get_input(NameHandle handle) const
+    {
+      const Module* module ( handle.kind == NameKind::INPUT ? get_module(handle) : nullptr );
+      if ( module && handle.item_id < module->num_inputs && module->inputs[handle.item_id].input_id == handle.item_id )
+	return &(module->inputs[handle.item_id]);
+      else
+	return nullptr;
+    }
+
+    const Sensor<>*
+    Configuration::get_sensor(NameHandle handle) const
+    {
+      const Module* module ( handle.kind == NameKind::SENSOR ? get_module(handle) : nullptr );
+      if ( module && handle.item_id < module->num_sensors && module->sensors[handle.item_id].id == handle.item_id )
+	return &(module->sensors[handle.item_id]);
+      else
+	return nullptr;
+    }
+
   }
 }
@@ -0,0 +1,81 @@
+#include <crisp/comms/ConfigurationDiskCache.hh>
+#include <crisp/comms/ConfigurationResponseCache.hh>
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace crisp
+{
+  namespace comms
+  {
+    ConfigurationDiskCache::ConfigurationDiskCache(const std::string& _directory)
+      : directory ( _directory )
+    {}
+
+    std::string
+    ConfigurationDiskCache::path_for(uint64_t digest) const
+    {
+      char name[32];
+      snprintf(name, sizeof(name), "/%016" PRIx64 ".config", digest);
+      return directory + name;
+    }
+
+    bool
+    ConfigurationDiskCache::load(uint64_t digest, Message& out) const
+    {
+      FILE* fp ( fopen(path_for(digest).c_str(), "rb") );
+      if ( ! fp )
+        return false;
+
+      long size ( -1 );
+      if ( fseek(fp, 0, SEEK_END) == 0 )
+        size = ftell(fp);
+      if ( size <= 0 || size > UINT16_MAX - MESSAGE_CHECKSUM_SIZE || fseek(fp, 0, SEEK_SET) != 0 )
+        {
+          fclose(fp);
+          return false;
+        }
+
+      Message m ( MessageType::CONFIGURATION_RESPONSE );
+      m.body.reset(new crisp::util::Buffer(size));
+      bool ok ( fread(m.body->data, 1, size, fp) == static_cast<size_t>(size) );
+      fclose(fp);
+      if ( ! ok || ConfigurationResponseCache::digest(m) != digest )
+        return false;
+
+      m.header.length = size + MESSAGE_CHECKSUM_SIZE;
+      m.invalidate_checksum();
+      m.checksum = m.compute_checksum();
+      out = std::move(m);
+      return true;
+    }
+
+    bool
+    ConfigurationDiskCache::store(const Message& response) const
+    {
+      if ( response.header.type != MessageType::CONFIGURATION_RESPONSE || ! response.body )
+        return false;
+
+      if ( mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST )
+        return false;
+
+      std::string path ( path_for(ConfigurationResponseCache::digest(response)) );
+      std::string temp ( path + ".tmp" + std::to_string(getpid()) );
+      FILE* fp ( fopen(temp.c_str(), "wb") );
+      if ( ! fp )
+        return false;
+
+      bool ok ( fwrite(response.body->data, 1, response.body->length, fp) == response.body->length );
+      ok = (fclose(fp) == 0) && ok;
+      if ( ! ok || rename(temp.c_str(), path.c_str()) != 0 )
+        {
+          unlink(temp.c_str());
+          return false;
+        }
+      return true;
+    }
+  }
+}
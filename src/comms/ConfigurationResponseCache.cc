@@ -0,0 +1,65 @@
+#include <crisp/comms/ConfigurationResponseCache.hh>
+#include <crisp/comms/Configuration.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    ConfigurationResponseCache::ConfigurationResponseCache()
+      : m_mutex ( ),
+        m_valid ( false ),
+        m_message ( ),
+        m_digest ( 0 )
+    {}
+
+    uint64_t
+    ConfigurationResponseCache::digest(const Message& response)
+    {
+      /* The 64-bit FNV-1a hash.  (The message's CRC-32 is too narrow to tell configurations
+         apart reliably.)  */
+      uint64_t out ( UINT64_C(14695981039346656037) );
+      if ( response.body )
+        {
+          const unsigned char* data ( reinterpret_cast<const unsigned char*>(response.body->data) );
+          for ( size_t i ( 0 ); i < response.body->length; ++i )
+            out = (out ^ data[i]) * UINT64_C(1099511628211);
+        }
+      return out ? out : 1;
+    }
+
+    void
+    ConfigurationResponseCache::refresh(const Configuration& config)
+    {
+      if ( m_valid )
+        return;
+
+      m_message = Message(config);
+      m_digest = digest(m_message);
+      m_valid = true;
+    }
+
+    Message
+    ConfigurationResponseCache::get(const Configuration& config)
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      refresh(config);
+      return m_message;
+    }
+
+    uint64_t
+    ConfigurationResponseCache::get_digest(const Configuration& config)
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      refresh(config);
+      return m_digest;
+    }
+
+    void
+    ConfigurationResponseCache::invalidate()
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      m_valid = false;
+      m_message = Message();
+    }
+  }
+}
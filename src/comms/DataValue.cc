@@ -14,7 +14,7 @@ namespace crisp
     }
 
     template <>
-    DataValue<>::DataValue(const DataDeclaration<>& _data_type, DecodeBuffer& buf)
+    DataValue<>::DataValue(const DataDeclaration<>& _data_type, DecodeBuffer& buf, bool copy)
       : data_type ( _data_type ),
 	value ( nullptr ),
 	owns_value ( true )
@@ -23,6 +23,14 @@ namespace crisp
       if ( data_type.is_array )
 	buf.read(&count, data_type.width);
 
+      if ( ! copy && buf.length - buf.offset >= count * data_type.width )
+        {
+          value = reinterpret_cast<uint8_t*>(buf.data + buf.offset);
+          owns_value = false;
+          buf.offset += count * data_type.width;
+          return;
+        }
+
       value = new uint8_t[count * data_type.width];
 
       if ( buf.length - buf.offset >= data_type.width )
@@ -1,5 +1,8 @@
 #include <crisp/comms/Handshake.hh>
 
+#include <algorithm>
+#include <cstddef>
+
 namespace crisp
 {
   namespace comms
@@ -8,21 +11,54 @@ namespace crisp
     Handshake::Handshake()
       : protocol { PROTOCOL_NAME },
       version { 0 },
-      role ( Role::MASTER )
+      role ( Role::MASTER ),
+      features ( 0 ),
+      configuration_digest ( 0 )
       {
 	memset(this, 0, sizeof(Handshake));
       }
 
-    Handshake::Handshake(uint32_t _version, Role _role)
-      : protocol { PROTOCOL_NAME },
-      version ( _version ),
-      role ( _role )
-      {}
+    Handshake::Handshake(uint32_t _version, Role _role, uint8_t _features,
+			 uint64_t _configuration_digest)
+      : Handshake()
+      {
+	/* (Start from a zeroed object, so that no uninitialized bytes reach the wire even if
+	   the compiler pads the structure.)  */
+	protocol = PROTOCOL_NAME;
+	version = _version;
+	role = _role;
+	features = _features;
+	configuration_digest = _configuration_digest;
+      }
+
+    constexpr uint8_t Handshake::FEATURE_MESSAGE_STAMPS;
+    constexpr uint8_t Handshake::FEATURE_COMPACT_CONTROL;
+
+    DecodeResult
+    Handshake::decode(DecodeBuffer& buffer)
+    {
+      size_t size ( std::min(buffer.length - buffer.offset, sizeof(Handshake)) );
+      if ( size < offsetof(Handshake, features) )
+	return DecodeResult::BUFFER_UNDERFLOW;
+
+      *this = Handshake();
+      DecodeResult result ( buffer.read(this, size) );
+
+      /* An older node's handshake may be followed by padding holding anything at all, so
+	 only trust the newer fields in a handshake that has all of them.  */
+      if ( size < sizeof(Handshake) )
+	{
+	  features = 0;
+	  configuration_digest = 0;
+	}
+      return result;
+    }
 
     Handshake
     Handshake::decode_copy(DecodeBuffer& buffer)
     { Handshake out;
-      buffer.read(&out, sizeof(out));
+      if ( out.decode(buffer) != DecodeResult::SUCCESS )
+	out = Handshake();
       return out; }
 
     bool
@@ -31,7 +67,9 @@ namespace crisp
       return
 	protocol == hs.protocol &&
 	version == hs.version &&
-	role == hs.role;
+	role == hs.role &&
+	features == hs.features &&
+	configuration_digest == hs.configuration_digest;
     }
   }
 }
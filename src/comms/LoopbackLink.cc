@@ -0,0 +1,165 @@
+#include <crisp/comms/LoopbackLink.hh>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+#include <unistd.h>
+
+#include <boost/asio/local/connect_pair.hpp>
+#include <boost/asio/write.hpp>
+
+namespace crisp
+{
+  namespace comms
+  {
+    LoopbackLink::Relay::Relay(boost::asio::io_service& service)
+      : in ( service ),
+        out ( service ),
+        mutex ( ),
+        cv ( ),
+        chunks ( ),
+        closed ( false ),
+        reader ( ),
+        writer ( )
+    {}
+
+
+    LoopbackLink::LoopbackLink(boost::asio::io_service& first_service,
+                               boost::asio::io_service& second_service,
+                               std::chrono::microseconds _delay)
+      : first ( first_service ),
+        second ( second_service ),
+        delay ( _delay ),
+        m_io_service ( ),
+        m_halting ( false ),
+        m_relays { nullptr, nullptr }
+    {
+      if ( delay.count() <= 0 )
+        {
+          boost::asio::local::connect_pair(first, second);
+          return;
+        }
+
+      /* first <-> relays[0].in ... relays[0].out <-> second, and the reverse. */
+      for ( Relay*& relay : m_relays )
+        relay = new Relay(m_io_service);
+
+      boost::asio::local::connect_pair(first, m_relays[0]->in);
+      boost::asio::local::connect_pair(m_relays[0]->out, second);
+
+      /* The reverse direction shares the same pair of connections. */
+      m_relays[1]->in.assign(Protocol(), dup(m_relays[0]->out.native_handle()));
+      m_relays[1]->out.assign(Protocol(), dup(m_relays[0]->in.native_handle()));
+
+      for ( Relay* relay : m_relays )
+        {
+          relay->reader = std::thread(&LoopbackLink::read_loop, this, std::ref(*relay));
+          relay->writer = std::thread(&LoopbackLink::write_loop, this, std::ref(*relay));
+        }
+    }
+
+    LoopbackLink::~LoopbackLink()
+    {
+      halt();
+      for ( Relay* relay : m_relays )
+        delete relay;
+    }
+
+    void
+    LoopbackLink::halt()
+    {
+      if ( m_halting.exchange(true) )
+        return;
+
+      boost::system::error_code ec;
+      for ( Relay* relay : m_relays )
+        if ( relay )
+          {
+            /* Wake the reader (if it's blocked in `read_some`) and the writer. */
+            relay->in.shutdown(Socket::shutdown_both, ec);
+            relay->out.shutdown(Socket::shutdown_both, ec);
+            {
+              std::unique_lock<std::mutex> lock ( relay->mutex );
+              relay->closed = true;
+            }
+            relay->cv.notify_all();
+          }
+
+      for ( Relay* relay : m_relays )
+        if ( relay )
+          {
+            if ( relay->reader.joinable() )
+              relay->reader.join();
+            if ( relay->writer.joinable() )
+              relay->writer.join();
+          }
+    }
+
+
+    void
+    LoopbackLink::read_loop(Relay& relay)
+    {
+      char buf[65536];
+      boost::system::error_code ec;
+
+      while ( ! m_halting )
+        {
+          size_t n ( relay.in.read_some(boost::asio::buffer(buf), ec) );
+          if ( ec || n == 0 )
+            break;
+
+          std::chrono::steady_clock::time_point due ( std::chrono::steady_clock::now() + delay );
+          {
+            std::unique_lock<std::mutex> lock ( relay.mutex );
+            relay.chunks.push_back({ due, std::vector<char>(buf, buf + n) });
+          }
+          relay.cv.notify_all();
+        }
+
+      {
+        std::unique_lock<std::mutex> lock ( relay.mutex );
+        relay.closed = true;
+      }
+      relay.cv.notify_all();
+    }
+
+    void
+    LoopbackLink::write_loop(Relay& relay)
+    {
+      boost::system::error_code ec;
+      std::unique_lock<std::mutex> lock ( relay.mutex );
+
+      while ( ! m_halting )
+        {
+          if ( relay.chunks.empty() )
+            {
+              if ( relay.closed )
+                break;
+              relay.cv.wait(lock);
+              continue;
+            }
+
+          /* Wait until the oldest chunk is due -- or we're told to stop. */
+          std::chrono::steady_clock::time_point due ( relay.chunks.front().due );
+          if ( std::chrono::steady_clock::now() < due )
+            {
+              relay.cv.wait_until(lock, due);
+              continue;
+            }
+
+          Relay::Chunk chunk ( std::move(relay.chunks.front()) );
+          relay.chunks.pop_front();
+
+          lock.unlock();
+          boost::asio::write(relay.out, boost::asio::buffer(chunk.data), ec);
+          lock.lock();
+          if ( ec )
+            break;
+        }
+
+      /* Pass end-of-file on to the far end. */
+      relay.out.shutdown(Socket::shutdown_send, ec);
+    }
+  }
+}
+
+#endif  /* BOOST_ASIO_HAS_LOCAL_SOCKETS */
@@ -27,7 +27,9 @@ namespace crisp
 	  { MTI_FOR(CONFIGURATION_QUERY), 	false, false,	FlowDirection::TO_SLAVE,  nullptr },
 	  { MTI_FOR(CONFIGURATION_RESPONSE), 	true, true,	FlowDirection::TO_MASTER, nullptr },
 	  { MTI_FOR(SENSOR_DATA), 		true, true, 	FlowDirection::TO_MASTER, nullptr },
-	  { MTI_FOR(MODULE_CONTROL), 		true, true,	FlowDirection::TO_SLAVE,  nullptr } };
+	  { MTI_FOR(MODULE_CONTROL), 		true, true,	FlowDirection::TO_SLAVE,  nullptr },
+	  { MTI_FOR(MODULE_CONTROL_COMPACT), 	true, true,	FlowDirection::TO_SLAVE,  nullptr },
+	  { MTI_FOR(SENSOR_POLL), 		true, true,	FlowDirection::TO_SLAVE,  nullptr } };
   
       static_assert(sizeof(message_type_info) / sizeof(MessageTypeInfo) == MESSAGE_TYPE_COUNT, "`message_type_info` array needs update!");
 
@@ -43,15 +45,12 @@ namespace crisp
 
 
     Message::Message()
-      : header {
-            0,
-	    MessageType::HANDSHAKE
-#if defined(MESSAGE_USE_SEQUENCE_ID) && MESSAGE_USE_SEQUENCE_ID
-	   , 0
-#endif
-       },
+      : header { 0, MessageType::HANDSHAKE },
       body ( nullptr ),
-      checksum ( 0 )
+      queued_at ( 0 ),
+      checksum ( 0 ),
+      m_cached_checksum ( 0 ),
+      m_checksum_cached ( false )
     {
       TRACE();
     }
@@ -59,16 +58,23 @@ namespace crisp
     Message::Message(Message&& m)
       : header ( std::move(m.header) ),
 	body ( std::move(m.body) ),
-	checksum ( 0 )
+	queued_at ( m.queued_at ),
+	checksum ( m.checksum ),
+	m_cached_checksum ( m.m_cached_checksum ),
+	m_checksum_cached ( m.m_checksum_cached )
     {
       TRACE();
       m.body.reset(nullptr);
+      m.m_checksum_cached = false;
     }
 
     Message::Message(const Message& m)
       : header ( m.header ),
 	body ( m.body ),
-	checksum ( m.checksum )
+	queued_at ( m.queued_at ),
+	checksum ( m.checksum ),
+	m_cached_checksum ( m.m_cached_checksum ),
+	m_checksum_cached ( m.m_checksum_cached )
     {
       TRACE();
     }
@@ -76,7 +82,10 @@ namespace crisp
     Message::Message(MessageType _type)
       : header { 0, _type },
         body ( nullptr ),
-        checksum ( 0 )
+        queued_at ( 0 ),
+        checksum ( 0 ),
+        m_cached_checksum ( 0 ),
+        m_checksum_cached ( false )
     {
       TRACE();
       header.length = get_encoded_size() - sizeof(Header);
@@ -88,7 +97,11 @@ namespace crisp
       TRACE();
       header = std::move(m.header);
       body = std::move(m.body);
+      queued_at = m.queued_at;
       checksum = std::move(m.checksum);
+      m_cached_checksum = m.m_cached_checksum;
+      m_checksum_cached = m.m_checksum_cached;
+      m.m_checksum_cached = false;
       return *this;
     }
 
@@ -114,7 +127,7 @@ namespace crisp
     }
 
     Message
-    Message::decode(DecodeBuffer& db)
+    Message::decode(DecodeBuffer& db, crisp::util::BufferPool* pool)
     {
       Message out;
 
@@ -123,7 +136,7 @@ namespace crisp
 
       if ( info.has_body )
 	{ size_t body_size ( out.header.length - ( info.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0 ) );
-          out.body.reset(new Buffer(body_size));
+          out.body.reset(pool ? pool->acquire(body_size) : new Buffer(body_size));
 	  db.read(out.body->data, body_size);
 	}
 
@@ -133,6 +146,30 @@ namespace crisp
       return out;
     }
 
+    Message
+    Message::decode_slice(DecodeBuffer& db, crisp::util::BufferPool* pool)
+    {
+      assert(db.buffer);
+      Message out;
+
+      db.read(&out.header, sizeof(Header));
+      const detail::MessageTypeInfo& info ( detail::get_type_info(out.header.type) );
+
+      if ( info.has_body )
+	{ size_t body_size ( out.header.length - ( info.has_checksum ? MESSAGE_CHECKSUM_SIZE : 0 ) );
+	  assert(db.offset + body_size <= db.length);
+	  out.body.reset(pool
+			 ? pool->slice(db.buffer.get(), db.offset, body_size)
+			 : Buffer::slice(db.buffer.get(), db.offset, body_size));
+	  db.offset += body_size;
+	}
+
+      if ( info.has_checksum )
+	db.read(&(out.checksum), sizeof(out.checksum));
+
+      return out;
+    }
+
     EncodeResult
     Message::encode(MemoryEncodeBuffer& buf) const
     {
@@ -185,6 +222,37 @@ namespace crisp
     }
 
 
+    constexpr size_t Message::MaxSegments;
+    constexpr uint8_t Message::StampedFlag;
+
+    size_t
+    Message::get_segments(Segment (&segments)[MaxSegments]) const
+    {
+      const detail::MessageTypeInfo& info ( detail::get_type_info(header.type) );
+      size_t n ( 0 );
+
+      segments[n++] = { &header, sizeof(Header) };
+
+      if ( info.has_body )
+	{
+	  if ( body )
+	    segments[n++] = { body->data, body->length };
+	  else
+	    {
+	      assert(info.body != nullptr);
+	      segments[n++] = { info.body, strlen(info.body) };
+	    }
+	}
+
+      if ( info.has_checksum )
+	{ checksum = compute_checksum();
+	  segments[n++] = { &checksum, MESSAGE_CHECKSUM_SIZE };
+	}
+
+      return n;
+    }
+
+
     /* Static method for encoding bodyless or pre-specified-body messages. */
     EncodeResult
     Message::encode(MemoryEncodeBuffer& buf, MessageType _type)
@@ -216,34 +284,38 @@ namespace crisp
     uint32_t
     Message::compute_checksum() const
     {
+      if ( m_checksum_cached )
+	return m_cached_checksum;
+
       const detail::MessageTypeInfo& info ( detail::get_type_info(header.type) );
       if ( ! info.has_checksum )
 	return 0;
 
-      /* Allocate memory for the buffers on the stack, since we don't need to pass it to any other
-	 functions.  */
-      size_t
-        body_size ( body ? body->length : strlen(info.body) ),
-        bufsize ( sizeof(Header) + body_size );
-      char buf[bufsize];
-
-      memcpy(buf, this, sizeof(Header));
+      /* Checksum the header and body where they lie instead of gathering them into a
+	 temporary buffer first.  */
+      uint32_t state ( crisp::util::crc32_begin() );
+      state = crisp::util::crc32_update(state, &header, sizeof(Header));
       if ( body )
-	memcpy(buf + sizeof(Header), body ? body->data : info.body, body_size);
+	state = crisp::util::crc32_update(state, body->data, body->length);
+      else if ( info.body )
+	state = crisp::util::crc32_update(state, info.body, strlen(info.body));
 
-      return crisp::util::crc32(buf, bufsize);
+      m_cached_checksum = crisp::util::crc32_finish(state);
+      m_checksum_cached = true;
+      return m_cached_checksum;
     }
 
     bool
     Message::operator ==(const Message& m) const
     {
+      /* Computed checksums are a pure function of header and body, so there's no need to
+	 compare them once those are known to match.  */
       return
 	header == m.header &&
 	( body == m.body ||
 	  ( body && m.body &&
 	    body->length == m.body->length &&
-	    ! memcmp(body->data, m.body->data, body->length) ) ) &&
-	compute_checksum() == m.compute_checksum();
+	    ! memcmp(body->data, m.body->data, body->length) ) );
     }
 
 
@@ -18,6 +18,8 @@ namespace crisp
     const MessageType ModuleControl::Type =
       MessageType::MODULE_CONTROL;
 
+    constexpr uint16_t ModuleControl::ClearBit;
+
     ModuleControl::ModuleControl()
       : module_id ( 0 ),
 	input_ids ( 0 ),
@@ -105,7 +107,7 @@ namespace crisp
     ModuleControl&
     ModuleControl::clear(const char* name)
     { assert(get_num_values() == 0);
-      input_ids |= 1 << (8 * sizeof(input_ids) - 1);
+      input_ids |= ClearBit;
       const ModuleInput<>* input ( module->find_input(name) );
       if ( input )
 	input_ids |= (1 << input->input_id);
@@ -115,7 +117,7 @@ namespace crisp
     ModuleControl&
     ModuleControl::clear(const ModuleInput<>& input)
     { assert(get_num_values() == 0);
-      input_ids |= 1 << (8 * sizeof(input_ids) - 1);
+      input_ids |= ClearBit;
       input_ids |= (1 << input.input_id);
       return *this;
     }
@@ -150,25 +152,20 @@ namespace crisp
       assert(input.input_id < module->num_inputs);
 #endif
   
-      struct iid_compare { bool operator()(const ValuePair& a, const ValuePair& b)
-	{ return a.input->input_id < b.input->input_id; } };
-
       if ( ! (input_ids & (1 << input.input_id)) )
-	{ /* Add a new value-pair.  */
+	{ /* Add a new value-pair, and move it into input-ID order.  Inputs are usually set in
+	     order, so this rarely moves anything.  */
+	  size_t index ( index_of(input.input_id) );
 	  input_ids |= (1 << input.input_id);
 	  values.push({ input, input.data_type });
-
-	  std::sort(values.begin(), values.end(),
-		    [](const ValuePair& a, const ValuePair& b)
-		    { return a.input->input_id < b.input->input_id; });
-	  return value_for(input);
-	}  
+	  std::rotate(values.begin() + index, values.end() - 1, values.end());
+	  return &(values[index].value);
+	}
       else
-	for ( const ValuePair& pair : values )
-	  if ( pair.input->input_id == input.input_id )
-	    return &(pair.value);
-
-      return nullptr;
+	{ /* "Clear" messages name inputs without holding values for them.  */
+	  size_t index ( index_of(input.input_id) );
+	  return index < values.size ? &(values[index].value) : nullptr;
+	}
     }
 
     EncodeResult
@@ -188,27 +185,42 @@ namespace crisp
     }
 
     DecodeResult
-    ModuleControl::decode(DecodeBuffer& buf, const Configuration& config)
+    ModuleControl::decode(DecodeBuffer& buf, const Configuration& config, bool copy_values)
     {
+      if ( buf.length - buf.offset < HeaderSize )
+	{ reset();
+	  return DecodeResult::BUFFER_UNDERFLOW; }
+
       module_id = *reinterpret_cast<uint8_t*>(buf.data + buf.offset);
-      reset(&config.modules[module_id]);
+      if ( module_id >= config.num_modules )
+	{ reset();
+	  return DecodeResult::INVALID_DATA; }
+
+      const Module& target ( config.modules[module_id] );
+      reset(&target);
       buf.read(this, HeaderSize);
 
+      /* Every input named must exist, whether or not a value follows for it.  */
+      if ( (input_ids & (ClearBit - 1)) >> target.num_inputs )
+	{ reset();
+	  return DecodeResult::INVALID_DATA; }
+
       if ( ! is_clear() )
 	{
 	  uint8_t num_values ( get_num_values() );
 	  if ( num_values > 0 )
 	    values.ensure_capacity(num_values);
 
-	  for ( size_t i ( 0 ); i < 8 * sizeof(ModuleControl::input_ids); ++i )
+	  for ( size_t i ( 0 ); i < target.num_inputs; ++i )
 	    if ( input_ids & (1 << i) )
 	      {
-#if defined(ENABLE_ASSERT) && ENABLE_ASSERT
-		assert(config.modules[module_id].num_inputs > i);
-#endif
+		if ( buf.length - buf.offset < target.inputs[i].data_type.width )
+		  { reset();
+		    return DecodeResult::BUFFER_UNDERFLOW; }
+
 		/* Construct the input-value structures in-place. */
-		values.push({ static_cast<const ModuleInput<>&>(config.modules[module_id].inputs[i]),
-		      DataValue<>(config.modules[module_id].inputs[i].data_type, buf) });
+		values.push({ static_cast<const ModuleInput<>&>(target.inputs[i]),
+		      DataValue<>(target.inputs[i].data_type, buf, copy_values) });
 	      }
 	}
       return DecodeResult::SUCCESS;
@@ -0,0 +1,267 @@
+#include <crisp/comms/NodeMetrics.hh>
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace crisp
+{
+  namespace comms
+  {
+    NodeMetrics::Snapshot::Snapshot()
+      : incoming { },
+        outgoing { },
+        checksum_failures ( 0 ),
+        resyncs ( 0 ),
+        discarded_bytes ( 0 ),
+        decode_errors ( 0 ),
+        encode_errors ( 0 ),
+        queue_depth ( 0 ),
+        queue_high_water ( 0 ),
+        stamps { },
+        clock_offset ( INT64_MAX )
+    {}
+
+    constexpr size_t NodeMetrics::LatencyBuckets;
+
+    /** Find the histogram bucket for a latency, in microseconds. */
+    static inline size_t
+    latency_bucket(uint64_t us)
+    {
+      if ( us == 0 )
+        return 0;
+      return std::min<size_t>(64 - __builtin_clzll(us), NodeMetrics::LatencyBuckets - 1);
+    }
+
+    uint64_t
+    NodeMetrics::Snapshot::percentile(const uint64_t (&histogram)[LatencyBuckets], double fraction)
+    {
+      uint64_t total ( 0 );
+      for ( uint64_t n : histogram )
+        total += n;
+      if ( total == 0 )
+        return 0;
+
+      uint64_t rank ( std::min<uint64_t>(total - 1, total * fraction) ), seen ( 0 );
+      size_t i ( 0 );
+      while ( (seen += histogram[i]) <= rank )
+        ++i;
+      return uint64_t(1) << i;
+    }
+
+    static NodeMetrics::Counts
+    sum(const NodeMetrics::Counts (&counts)[MESSAGE_TYPE_COUNT])
+    {
+      NodeMetrics::Counts out { 0, 0 };
+      for ( const NodeMetrics::Counts& c : counts )
+        {
+          out.messages += c.messages;
+          out.bytes += c.bytes;
+        }
+      return out;
+    }
+
+    NodeMetrics::Counts
+    NodeMetrics::Snapshot::total_incoming() const
+    { return sum(incoming); }
+
+    NodeMetrics::Counts
+    NodeMetrics::Snapshot::total_outgoing() const
+    { return sum(outgoing); }
+
+    NodeMetrics::Snapshot&
+    NodeMetrics::Snapshot::operator +=(const Snapshot& other)
+    {
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        {
+          incoming[i].messages += other.incoming[i].messages;
+          incoming[i].bytes += other.incoming[i].bytes;
+          outgoing[i].messages += other.outgoing[i].messages;
+          outgoing[i].bytes += other.outgoing[i].bytes;
+        }
+      checksum_failures += other.checksum_failures;
+      resyncs += other.resyncs;
+      discarded_bytes += other.discarded_bytes;
+      decode_errors += other.decode_errors;
+      encode_errors += other.encode_errors;
+      queue_depth += other.queue_depth;
+      queue_high_water += other.queue_high_water;
+
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        {
+          StampCounts& mine ( stamps[i] );
+          const StampCounts& theirs ( other.stamps[i] );
+          mine.received += theirs.received;
+          mine.lost += theirs.lost;
+          mine.reordered += theirs.reordered;
+          for ( size_t j ( 0 ); j < LatencyBuckets; ++j )
+            {
+              mine.transit[j] += theirs.transit[j];
+              mine.queue_delay[j] += theirs.queue_delay[j];
+            }
+        }
+      clock_offset = std::min(clock_offset, other.clock_offset);
+      return *this;
+    }
+
+    void
+    NodeMetrics::Snapshot::print(FILE* stream, const char* prefix) const
+    {
+      Counts in ( total_incoming() ), out ( total_outgoing() );
+      fprintf(stream, "%sin: %" PRIu64 " messages (%" PRIu64 " bytes); out: %" PRIu64 " messages (%" PRIu64 " bytes)\n",
+              prefix, in.messages, in.bytes, out.messages, out.bytes);
+
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        if ( incoming[i].messages || outgoing[i].messages )
+          fprintf(stream, "%s  %-22s in %10" PRIu64 " (%" PRIu64 " bytes), out %10" PRIu64 " (%" PRIu64 " bytes)\n",
+                  prefix, detail::get_type_info(static_cast<MessageType>(i)).name,
+                  incoming[i].messages, incoming[i].bytes, outgoing[i].messages, outgoing[i].bytes);
+
+      fprintf(stream, "%schecksum failures %" PRIu64 ", resyncs %" PRIu64 " (%" PRIu64 " bytes discarded)"
+              ", decode errors %" PRIu64 ", encode errors %" PRIu64 "\n",
+              prefix, checksum_failures, resyncs, discarded_bytes, decode_errors, encode_errors);
+      fprintf(stream, "%soutgoing queue depth %" PRIu64 " (high-water mark %" PRIu64 ")\n",
+              prefix, queue_depth, queue_high_water);
+
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        if ( stamps[i].received )
+          {
+            const StampCounts& st ( stamps[i] );
+            fprintf(stream, "%s  %-22s stamped %10" PRIu64 ", lost %" PRIu64 ", reordered %" PRIu64
+                    "; transit p50 < %" PRIu64 " us, p99 < %" PRIu64 " us; queued p50 < %" PRIu64
+                    " us, p99 < %" PRIu64 " us\n",
+                    prefix, detail::get_type_info(static_cast<MessageType>(i)).name,
+                    st.received, st.lost, st.reordered,
+                    percentile(st.transit, 0.5), percentile(st.transit, 0.99),
+                    percentile(st.queue_delay, 0.5), percentile(st.queue_delay, 0.99));
+          }
+      if ( clock_offset != INT64_MAX )
+        fprintf(stream, "%sclock offset (fastest transit) %" PRId64 " us\n", prefix, clock_offset);
+    }
+
+
+    NodeMetrics::NodeMetrics()
+      : m_checksum_failures ( 0 ),
+        m_resyncs ( 0 ),
+        m_discarded_bytes ( 0 ),
+        m_decode_errors ( 0 ),
+        m_encode_errors ( 0 ),
+        m_queue_depth ( 0 ),
+        m_queue_high_water ( 0 ),
+        m_clock_offset ( INT64_MAX )
+    {
+      reset();
+      for ( SequenceState& state : m_sequences )
+        state = { false, 0 };
+    }
+
+    void
+    NodeMetrics::record_stamp(MessageType type, const Message::Stamp& stamp, uint64_t received_at)
+    {
+      AtomicStampCounts& counts ( m_stamps[static_cast<size_t>(type)] );
+      SequenceState& state ( m_sequences[static_cast<size_t>(type)] );
+      counts.received.fetch_add(1, std::memory_order_relaxed);
+
+      /* Sequence numbers wrap around, so compare them by their signed difference. */
+      int32_t gap ( static_cast<int32_t>(stamp.sequence - state.expected) );
+      if ( ! state.started || gap >= 0 )
+        {
+          if ( state.started && gap > 0 )
+            counts.lost.fetch_add(gap, std::memory_order_relaxed);
+          state.started = true;
+          state.expected = stamp.sequence + 1;
+        }
+      else
+        {
+          /* A late arrival: it was counted as lost when we skipped over it.  */
+          counts.reordered.fetch_add(1, std::memory_order_relaxed);
+          if ( counts.lost.load(std::memory_order_relaxed) > 0 )
+            counts.lost.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+      int64_t offset ( static_cast<int64_t>(received_at - stamp.sent_at) );
+      int64_t min_offset ( m_clock_offset.load(std::memory_order_relaxed) );
+      if ( offset < min_offset )
+        m_clock_offset.store(min_offset = offset, std::memory_order_relaxed);
+
+      counts.transit[latency_bucket(offset - min_offset)].fetch_add(1, std::memory_order_relaxed);
+      counts.queue_delay[latency_bucket(stamp.queue_delay)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void
+    NodeMetrics::set_queue_depth(size_t depth)
+    {
+      m_queue_depth.store(depth, std::memory_order_relaxed);
+
+      uint64_t high ( m_queue_high_water.load(std::memory_order_relaxed) );
+      while ( depth > high &&
+              ! m_queue_high_water.compare_exchange_weak(high, depth, std::memory_order_relaxed) )
+        ;
+    }
+
+    NodeMetrics::Snapshot
+    NodeMetrics::snapshot() const
+    {
+      Snapshot out;
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        {
+          out.incoming[i] = { m_incoming[i].messages.load(std::memory_order_relaxed),
+                              m_incoming[i].bytes.load(std::memory_order_relaxed) };
+          out.outgoing[i] = { m_outgoing[i].messages.load(std::memory_order_relaxed),
+                              m_outgoing[i].bytes.load(std::memory_order_relaxed) };
+        }
+      out.checksum_failures = m_checksum_failures.load(std::memory_order_relaxed);
+      out.resyncs = m_resyncs.load(std::memory_order_relaxed);
+      out.discarded_bytes = m_discarded_bytes.load(std::memory_order_relaxed);
+      out.decode_errors = m_decode_errors.load(std::memory_order_relaxed);
+      out.encode_errors = m_encode_errors.load(std::memory_order_relaxed);
+      out.queue_depth = m_queue_depth.load(std::memory_order_relaxed);
+      out.queue_high_water = m_queue_high_water.load(std::memory_order_relaxed);
+
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        {
+          const AtomicStampCounts& in ( m_stamps[i] );
+          StampCounts& st ( out.stamps[i] );
+          st.received = in.received.load(std::memory_order_relaxed);
+          st.lost = in.lost.load(std::memory_order_relaxed);
+          st.reordered = in.reordered.load(std::memory_order_relaxed);
+          for ( size_t j ( 0 ); j < LatencyBuckets; ++j )
+            {
+              st.transit[j] = in.transit[j].load(std::memory_order_relaxed);
+              st.queue_delay[j] = in.queue_delay[j].load(std::memory_order_relaxed);
+            }
+        }
+      out.clock_offset = m_clock_offset.load(std::memory_order_relaxed);
+      return out;
+    }
+
+    void
+    NodeMetrics::reset()
+    {
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        {
+          m_incoming[i].messages = 0;
+          m_incoming[i].bytes = 0;
+          m_outgoing[i].messages = 0;
+          m_outgoing[i].bytes = 0;
+        }
+      m_checksum_failures = 0;
+      m_resyncs = 0;
+      m_discarded_bytes = 0;
+      m_decode_errors = 0;
+      m_encode_errors = 0;
+      m_queue_high_water = m_queue_depth.load();
+
+      for ( AtomicStampCounts& counts : m_stamps )
+        {
+          counts.received = 0;
+          counts.lost = 0;
+          counts.reordered = 0;
+          for ( size_t j ( 0 ); j < LatencyBuckets; ++j )
+            {
+              counts.transit[j] = 0;
+              counts.queue_delay[j] = 0;
+            }
+        }
+    }
+  }
+}
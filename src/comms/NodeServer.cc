@@ -1,6 +1,7 @@
 /** @file
  *
- * Explicit template instantiation of `NodeServer< BasicNode<boost::asio::tcp::ip> >`.
+ * Explicit template instantiations of `NodeServer< BasicNode<boost::asio::ip::tcp> >` and
+ * (where supported) `NodeServer< BasicNode<boost::asio::local::stream_protocol> >`.
  */
 #include <crisp/comms/NodeServer.hh>
 #include <crisp/comms/bits/NodeServer.tcc>
@@ -10,5 +11,8 @@ namespace crisp
   namespace comms
   {
     template class NodeServer< BasicNode<boost::asio::ip::tcp> >;
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    template class NodeServer< BasicNode<boost::asio::local::stream_protocol> >;
+#endif
   }
 }
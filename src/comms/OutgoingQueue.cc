@@ -0,0 +1,195 @@
+#include <crisp/comms/OutgoingQueue.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    static_assert((OUTGOING_QUEUE_COALESCING_SLOTS & (OUTGOING_QUEUE_COALESCING_SLOTS - 1)) == 0,
+                  "OUTGOING_QUEUE_COALESCING_SLOTS must be a power of two");
+
+    /* Layout of `Slot::state`: the key in the low 41 bits (see `get_key`), then the number of
+       queue entries referencing the slot (at most two at once), then the number of producers
+       using it.  */
+    static constexpr uint64_t SlotKeyMask ( (UINT64_C(1) << 41) - 1 );
+    static constexpr uint64_t SlotEntry ( UINT64_C(1) << 41 );
+    static constexpr uint64_t SlotProducer ( UINT64_C(1) << 48 );
+
+    /** Number of slots, starting at the one chosen by a key's hash, in which the key is looked
+        for.  */
+    static constexpr size_t SlotProbes ( OUTGOING_QUEUE_COALESCING_SLOTS < 8
+                                         ? OUTGOING_QUEUE_COALESCING_SLOTS : 8 );
+
+    OutgoingQueue::Entry::Entry()
+      : message ( ),
+        slot ( nullptr )
+    {}
+
+    OutgoingQueue::Entry::Entry(Message&& m)
+      : message ( std::move(m) ),
+        slot ( nullptr )
+    {}
+
+    OutgoingQueue::Entry::Entry(Slot* s)
+      : message ( ),
+        slot ( s )
+    {}
+
+
+    OutgoingQueue::Slot::Slot()
+      : state ( 0 ),
+        pending ( nullptr )
+    {}
+
+
+    OutgoingQueue::OutgoingQueue()
+      : m_queue ( OUTGOING_QUEUE_RESERVED_ENTRIES ),
+        m_messages ( 2 * OUTGOING_QUEUE_COALESCING_SLOTS ),
+        m_num_coalesced ( 0 ),
+        m_size ( 0 )
+    {
+      for ( size_t i ( 0 ); i < MESSAGE_TYPE_COUNT; ++i )
+        m_policies[i] = QueuePolicy::FIFO;
+      m_policies[static_cast<size_t>(MessageType::MODULE_CONTROL)] = QueuePolicy::LATEST_VALUE;
+    }
+
+    OutgoingQueue::~OutgoingQueue()
+    {
+      for ( Slot& slot : m_slots )
+        m_messages.destroy(slot.pending.load());
+    }
+
+    void
+    OutgoingQueue::set_policy(MessageType type, QueuePolicy policy)
+    {
+      assert(static_cast<size_t>(type) < MESSAGE_TYPE_COUNT);
+      m_policies[static_cast<size_t>(type)].store(policy, std::memory_order_relaxed);
+    }
+
+    QueuePolicy
+    OutgoingQueue::get_policy(MessageType type) const
+    {
+      assert(static_cast<size_t>(type) < MESSAGE_TYPE_COUNT);
+      return m_policies[static_cast<size_t>(type)].load(std::memory_order_relaxed);
+    }
+
+    uint64_t
+    OutgoingQueue::get_key(const Message& m)
+    {
+      /* Bit 40 is always set, so that no valid key is zero.  */
+      uint64_t key ( (UINT64_C(1) << 40) | (static_cast<uint64_t>(m.header.type) << 32) );
+
+      if ( m.header.type == MessageType::MODULE_CONTROL && m.body &&
+           m.body->length >= ModuleControl::HeaderSize )
+        {
+          const unsigned char* data ( reinterpret_cast<const unsigned char*>(m.body->data) );
+          uint16_t input_ids;
+          memcpy(&input_ids, data + 1, sizeof(input_ids));
+          key |= (static_cast<uint64_t>(data[0]) << 16) | input_ids;
+        }
+      return key;
+    }
+
+    OutgoingQueue::Slot*
+    OutgoingQueue::acquire_slot(uint64_t key)
+    {
+      /* Slots are released again, so the slot for a key isn't necessarily the first free one
+         among its probes: look for it in all of them before claiming one.  */
+      size_t index ( static_cast<size_t>((key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) );
+      for ( ;; )
+        {
+          Slot* free_slot ( nullptr );
+          for ( size_t probe ( 0 ); probe < SlotProbes; ++probe )
+            {
+              Slot& slot ( m_slots[(index + probe) & (OUTGOING_QUEUE_COALESCING_SLOTS - 1)] );
+              uint64_t state ( slot.state.load() );
+              while ( (state & SlotKeyMask) == key )
+                if ( slot.state.compare_exchange_weak(state, state + SlotProducer) )
+                  return &slot;
+              if ( state == 0 && ! free_slot )
+                free_slot = &slot;
+            }
+          if ( ! free_slot )
+            return nullptr;
+
+          /* If another thread claims the free slot first, look again: it may have claimed it
+             for this key.  */
+          uint64_t expected ( 0 );
+          if ( free_slot->state.compare_exchange_strong(expected, key + SlotProducer) )
+            return free_slot;
+        }
+    }
+
+    void
+    OutgoingQueue::release_slot(Slot* slot, uint64_t reference)
+    {
+      /* The slot can't take a new pending message without a producer reference, or hold one
+         without an entry reference, so once both are gone it's safe to release.  */
+      uint64_t state ( slot->state.load() ), rest;
+      do
+        rest = state - reference;
+      while ( ! slot->state.compare_exchange_weak(state, (rest & ~SlotKeyMask) ? rest : 0) );
+    }
+
+    void
+    OutgoingQueue::push(const Message& m)
+    {
+      push(Message(m));
+    }
+
+    void
+    OutgoingQueue::push(Message&& m)
+    {
+      Slot* slot;
+      if ( get_policy(m.header.type) == QueuePolicy::LATEST_VALUE && (slot = acquire_slot(get_key(m))) )
+        {
+          /* If there was already a message pending in this slot, it's already got a place in
+             the queue -- so just replace it.  */
+          Message* previous ( slot->pending.exchange(m_messages.create(std::move(m))) );
+          if ( previous )
+            {
+              m_messages.destroy(previous);
+              m_num_coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+          else
+            {
+              /* Count the entry before the consumer can see it.  */
+              slot->state.fetch_add(SlotEntry);
+              m_size.fetch_add(1, std::memory_order_relaxed);
+              m_queue.emplace(slot);
+            }
+          release_slot(slot, SlotProducer);
+          return;
+        }
+
+      m_size.fetch_add(1, std::memory_order_relaxed);
+      m_queue.emplace(std::move(m));
+    }
+
+    bool
+    OutgoingQueue::try_pop(Message& out)
+    {
+      Entry entry;
+      while ( m_queue.try_pop(entry) )
+        {
+          m_size.fetch_sub(1, std::memory_order_relaxed);
+          if ( ! entry.slot )
+            {
+              out = std::move(entry.message);
+              return true;
+            }
+
+          /* Take the slot's message, then drop the entry's reference to it.  */
+          Message* pending ( entry.slot->pending.exchange(nullptr) );
+          release_slot(entry.slot, SlotEntry);
+          if ( pending )
+            {
+              out = std::move(*pending);
+              m_messages.destroy(pending);
+              return true;
+            }
+        }
+      return false;
+    }
+  }
+}
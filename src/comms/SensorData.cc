@@ -0,0 +1,204 @@
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/Configuration.hh>
+
+#include <limits>
+
+namespace crisp
+{
+  namespace comms
+  {
+    const MessageType SensorData::Type =
+      MessageType::SENSOR_DATA;
+
+    const size_t SensorData::HeaderSize =
+      sizeof(uint64_t);
+
+    const size_t SensorData::RunHeaderSize =
+      2 * sizeof(uint8_t) + sizeof(uint16_t);
+
+    const size_t SensorData::MaxEncodedSize =
+      std::numeric_limits<uint16_t>::max() - MESSAGE_CHECKSUM_SIZE;
+
+    SensorData::SensorData(uint64_t _base_time)
+      : base_time ( _base_time ),
+	samples ( ),
+	configuration ( ),
+	m_values ( ),
+	m_encoded_size ( HeaderSize ),
+	m_run_length ( 0 )
+    {}
+
+    void
+    SensorData::clear(uint64_t _base_time)
+    {
+      base_time = _base_time;
+      samples.clear();
+      m_values.clear();
+      m_encoded_size = HeaderSize;
+      m_run_length = 0;
+    }
+
+    size_t
+    SensorData::run_overhead(uint8_t module_id, const Sensor<>& sensor) const
+    {
+      if ( samples.empty() || samples.back().module_id != module_id ||
+	   samples.back().sensor->id != sensor.id ||
+	   m_run_length == std::numeric_limits<uint16_t>::max() )
+	return RunHeaderSize;
+      else
+	return 0;
+    }
+
+    bool
+    SensorData::has_room_for(uint8_t module_id, const Sensor<>& sensor) const
+    {
+      return m_encoded_size + run_overhead(module_id, sensor) + sizeof(uint32_t) + sensor.data_type.width
+	<= MaxEncodedSize;
+    }
+
+    bool
+    SensorData::add(uint8_t module_id, const Sensor<>& sensor, uint64_t timestamp, const void* value)
+    {
+      if ( timestamp < base_time || timestamp - base_time > std::numeric_limits<uint32_t>::max() )
+	return false;
+
+      size_t overhead ( run_overhead(module_id, sensor) );
+      size_t width ( sensor.data_type.width );
+      if ( m_encoded_size + overhead + sizeof(uint32_t) + width > MaxEncodedSize )
+	return false;
+
+      m_run_length = overhead ? 1 : m_run_length + 1;
+      m_encoded_size += overhead + sizeof(uint32_t) + width;
+
+      samples.push_back({ module_id, &sensor, timestamp, m_values.size() });
+      const uint8_t* bytes ( static_cast<const uint8_t*>(value) );
+      m_values.insert(m_values.end(), bytes, bytes + width);
+      return true;
+    }
+
+    bool
+    SensorData::operator ==(const SensorData& sd) const
+    {
+      if ( base_time != sd.base_time || samples.size() != sd.samples.size() )
+	return false;
+
+      for ( size_t i ( 0 ); i < samples.size(); ++i )
+	{
+	  const Sample& a ( samples[i] );
+	  const Sample& b ( sd.samples[i] );
+	  if ( a.module_id != b.module_id || a.timestamp != b.timestamp || *a.sensor != *b.sensor ||
+	       memcmp(value_data(a), sd.value_data(b), a.sensor->data_type.width) )
+	    return false;
+	}
+      return true;
+    }
+
+    EncodeResult
+    SensorData::encode(MemoryEncodeBuffer& buf) const
+    {
+      EncodeResult r;
+      if ( (r = buf.write(&base_time, sizeof(base_time))) != EncodeResult::SUCCESS )
+	return r;
+
+      size_t i ( 0 );
+      while ( i < samples.size() )
+	{
+	  /* Find the end of this run. */
+	  size_t end ( i + 1 );
+	  while ( end < samples.size() && end - i < std::numeric_limits<uint16_t>::max() &&
+		  samples[end].module_id == samples[i].module_id &&
+		  samples[end].sensor->id == samples[i].sensor->id )
+	    ++end;
+
+	  uint8_t ids[2] = { samples[i].module_id, static_cast<uint8_t>(samples[i].sensor->id) };
+	  uint16_t count ( end - i );
+	  if ( (r = buf.write(ids, sizeof(ids))) != EncodeResult::SUCCESS ||
+	       (r = buf.write(&count, sizeof(count))) != EncodeResult::SUCCESS )
+	    return r;
+
+	  size_t width ( samples[i].sensor->data_type.width );
+	  for ( ; i < end; ++i )
+	    {
+	      uint32_t offset ( samples[i].timestamp - base_time );
+	      if ( (r = buf.write(&offset, sizeof(offset))) != EncodeResult::SUCCESS ||
+		   (r = buf.write(value_data(samples[i]), width)) != EncodeResult::SUCCESS )
+		return r;
+	    }
+	}
+
+      return EncodeResult::SUCCESS;
+    }
+
+    DecodeResult
+    SensorData::decode(DecodeBuffer& buf, const Configuration& config)
+    {
+      clear();
+      configuration.reset();
+
+      DecodeResult r;
+      if ( (r = buf.read(&base_time, sizeof(base_time))) != DecodeResult::SUCCESS )
+	return r;
+
+      while ( buf.offset < buf.length )
+	{
+	  uint8_t ids[2];
+	  uint16_t count;
+	  if ( (r = buf.read(ids, sizeof(ids))) != DecodeResult::SUCCESS ||
+	       (r = buf.read(&count, sizeof(count))) != DecodeResult::SUCCESS )
+	    break;
+
+	  /* Sensor IDs are assigned in order, so the sensor is normally found at the index
+	     matching its ID. */
+	  const Sensor<>* sensor ( nullptr );
+	  if ( ids[0] < config.num_modules )
+	    {
+	      const Module& module ( config.modules[ids[0]] );
+	      if ( ids[1] < module.num_sensors && module.sensors[ids[1]].id == ids[1] )
+		sensor = &module.sensors[ids[1]];
+	      else
+		for ( size_t j ( 0 ); j < module.num_sensors && ! sensor; ++j )
+		  if ( module.sensors[j].id == ids[1] )
+		    sensor = &module.sensors[j];
+	    }
+	  if ( ! sensor || count == 0 )
+	    {
+	      r = DecodeResult::INVALID_DATA;
+	      break;
+	    }
+
+	  size_t width ( sensor->data_type.width );
+	  if ( buf.length - buf.offset < count * (sizeof(uint32_t) + width) )
+	    {
+	      r = DecodeResult::BUFFER_UNDERFLOW;
+	      break;
+	    }
+
+	  for ( uint16_t k ( 0 ); k < count; ++k )
+	    {
+	      uint32_t offset;
+	      buf.read(&offset, sizeof(offset));
+	      samples.push_back({ ids[0], sensor, base_time + offset, m_values.size() });
+	      const uint8_t* bytes ( reinterpret_cast<const uint8_t*>(buf.data + buf.offset) );
+	      m_values.insert(m_values.end(), bytes, bytes + width);
+	      buf.offset += width;
+	    }
+	  m_run_length = count;
+	  m_encoded_size += RunHeaderSize + count * (sizeof(uint32_t) + width);
+	}
+
+      if ( r != DecodeResult::SUCCESS )
+	clear();
+      return r;
+    }
+
+    DecodeResult
+    SensorData::decode(DecodeBuffer& buf, const std::shared_ptr<const Configuration>& config)
+    {
+      std::shared_ptr<const Configuration> keep ( config );
+      DecodeResult r ( decode(buf, *keep) );
+      if ( r == DecodeResult::SUCCESS )
+	configuration = std::move(keep);
+      return r;
+    }
+  }
+}
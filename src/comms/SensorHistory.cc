@@ -0,0 +1,258 @@
+#include <crisp/comms/SensorHistory.hh>
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/Configuration.hh>
+
+#include <cstring>
+
+namespace crisp
+{
+  namespace comms
+  {
+    constexpr size_t SensorSeries::DecimationFactor;
+    constexpr size_t SensorHistory::DefaultCapacity;
+
+    /** Find the index of the first entry in a ring with a timestamp at or after the given
+        time, assuming the entries are in timestamp order.  */
+    template < typename _Tp >
+    static uint64_t
+    lower_bound(const crisp::util::HistoryRing<_Tp>& ring, uint64_t since)
+    {
+      uint64_t lo ( ring.begin() ), hi ( ring.end() );
+      while ( lo < hi )
+        {
+          uint64_t mid ( lo + (hi - lo) / 2 );
+          _Tp entry;
+          if ( ! ring.get(mid, entry) || entry.timestamp < since )
+            lo = mid + 1;	/* (Entries that have been overwritten are too old anyway.) */
+          else
+            hi = mid;
+        }
+      return lo;
+    }
+
+    /** Key of a sensor's series in `SensorHistory::m_series`. */
+    static inline uint32_t
+    series_key(uint8_t module_id, uint16_t sensor_id)
+    { return static_cast<uint32_t>(module_id) << 16 | sensor_id; }
+
+    SensorSeries::SensorSeries(uint8_t _module_id, const Sensor<>& sensor, size_t capacity)
+      : SensorSeries(_module_id, sensor.id, sensor.data_type, capacity)
+    {}
+
+    SensorSeries::SensorSeries(uint8_t _module_id, uint16_t _sensor_id,
+                               const DataDeclaration<>& _data_type, size_t capacity)
+      : module_id ( _module_id ),
+        sensor_id ( _sensor_id ),
+        data_type ( _data_type ),
+        m_raw ( capacity ),
+        m_decimated { { capacity }, { capacity } },
+        m_accumulators ( ),
+        m_latest ( 0 )
+    {}
+
+    bool
+    SensorSeries::can_record(const DataDeclaration<>& type)
+    {
+      if ( type.is_array )
+        return false;
+      switch ( type.type )
+        {
+        case DataType::BOOLEAN:
+        case DataType::INTEGER:
+          return type.width == 1 || type.width == 2 || type.width == 4 || type.width == 8;
+        case DataType::FLOAT:
+          return type.width == sizeof(float) || type.width == sizeof(double);
+        default:
+          return false;
+        }
+    }
+
+    double
+    SensorSeries::to_double(const DataDeclaration<>& type, const uint8_t* value)
+    {
+      if ( type.type == DataType::FLOAT )
+        {
+          if ( type.width == sizeof(float) )
+            { float f;
+              memcpy(&f, value, sizeof(f));
+              return f; }
+          double d;
+          memcpy(&d, value, sizeof(d));
+          return d;
+        }
+
+      uint64_t v ( 0 );
+      memcpy(&v, value, type.width);
+      if ( type.type == DataType::BOOLEAN )
+        return v ? 1 : 0;
+      if ( type.is_signed && type.width < 8 )
+        {
+          unsigned shift ( 64 - 8 * type.width );
+          return static_cast<double>(static_cast<int64_t>(v << shift) >> shift);
+        }
+      return type.is_signed ? static_cast<double>(static_cast<int64_t>(v)) : static_cast<double>(v);
+    }
+
+    void
+    SensorSeries::accumulate(size_t level, const SensorSummary& entry)
+    {
+      Accumulator& acc ( m_accumulators[level] );
+      if ( acc.entries == 0 )
+        {
+          acc.summary = entry;
+          acc.sum = entry.mean * entry.count;
+        }
+      else
+        {
+          if ( entry.minimum < acc.summary.minimum )
+            acc.summary.minimum = entry.minimum;
+          if ( entry.maximum > acc.summary.maximum )
+            acc.summary.maximum = entry.maximum;
+          acc.summary.count += entry.count;
+          acc.sum += entry.mean * entry.count;
+        }
+
+      if ( ++acc.entries == DecimationFactor )
+        {
+          acc.summary.mean = acc.sum / acc.summary.count;
+          m_decimated[level].push(acc.summary);
+          acc.entries = 0;
+          if ( level + 1 < sizeof(m_decimated) / sizeof(m_decimated[0]) )
+            accumulate(level + 1, acc.summary);
+        }
+    }
+
+    void
+    SensorSeries::record(uint64_t timestamp, const uint8_t* value)
+    {
+      if ( timestamp < m_latest )
+        return;
+      m_latest = timestamp;
+
+      double v ( to_double(data_type, value) );
+      m_raw.push({ timestamp, v });
+      accumulate(0, { timestamp, 1, v, v, v });
+    }
+
+    uint64_t
+    SensorSeries::latest_timestamp() const
+    {
+      SensorSample sample;
+      uint64_t end ( m_raw.end() );
+      return end > 0 && m_raw.get(end - 1, sample) ? sample.timestamp : 0;
+    }
+
+    size_t
+    SensorSeries::read(uint64_t since, std::vector<SensorSample>& out) const
+    {
+      m_raw.read(lower_bound(m_raw, since), out);
+      return out.size();
+    }
+
+    size_t
+    SensorSeries::read(HistoryResolution resolution, uint64_t since, std::vector<SensorSummary>& out) const
+    {
+      if ( resolution != HistoryResolution::RAW )
+        {
+          const crisp::util::HistoryRing<SensorSummary>&
+            ring ( m_decimated[static_cast<size_t>(resolution) - 1] );
+          ring.read(lower_bound(ring, since), out);
+          return out.size();
+        }
+
+      out.clear();
+      SensorSample sample;
+      for ( uint64_t i ( lower_bound(m_raw, since) ), end ( m_raw.end() ); i < end; ++i )
+        if ( m_raw.get(i, sample) )
+          out.push_back({ sample.timestamp, 1, sample.value, sample.value, sample.value });
+      return out.size();
+    }
+
+    size_t
+    SensorSeries::read_last(HistoryResolution resolution, uint64_t duration, std::vector<SensorSummary>& out) const
+    {
+      uint64_t latest ( latest_timestamp() );
+      return read(resolution, latest > duration ? latest - duration : 0, out);
+    }
+
+
+    SensorHistory::SensorHistory(size_t _capacity)
+      : capacity ( _capacity ),
+        m_update_mutex ( ),
+        m_series ( std::make_shared<SeriesMap>() )
+    {}
+
+    void
+    SensorHistory::configure(const Configuration& config)
+    {
+      std::unique_lock<std::mutex> lock ( m_update_mutex );
+      std::shared_ptr<const SeriesMap> current ( std::atomic_load(&m_series) );
+      std::shared_ptr<SeriesMap> series ( std::make_shared<SeriesMap>() );
+
+      for ( uint8_t i ( 0 ); i < config.num_modules; ++i )
+        {
+          const Module& module ( config.modules[i] );
+          for ( const Sensor<>& sensor : module.sensors )
+            {
+              if ( ! SensorSeries::can_record(sensor.data_type) )
+                continue;
+
+              uint32_t key ( series_key(module.id, sensor.id) );
+              auto it ( current->find(key) );
+              (*series)[key] = it != current->end() && it->second->data_type == sensor.data_type
+                ? it->second
+                : std::make_shared<SensorSeries>(module.id, sensor, capacity);
+            }
+        }
+
+      std::atomic_store(&m_series, std::shared_ptr<const SeriesMap>(series));
+    }
+
+    void
+    SensorHistory::record(const SensorData& data)
+    {
+      std::shared_ptr<const SeriesMap> series_map ( std::atomic_load(&m_series) );
+
+      /* Samples come in runs from a single sensor, so only look the series up when the
+         sensor changes.  */
+      SensorSeries* series ( nullptr );
+      const Sensor<>* last ( nullptr );
+      uint8_t last_module ( 0 );
+      for ( const SensorData::Sample& sample : data.samples )
+        {
+          if ( sample.sensor != last || sample.module_id != last_module )
+            {
+              last = sample.sensor;
+              last_module = sample.module_id;
+              auto it ( series_map->find(series_key(sample.module_id, sample.sensor->id)) );
+              series = it != series_map->end() && it->second->data_type == sample.sensor->data_type
+                ? it->second.get()
+                : nullptr;
+            }
+
+          if ( series )
+            series->record(sample.timestamp, data.value_data(sample));
+        }
+    }
+
+    std::shared_ptr<const SensorSeries>
+    SensorHistory::find(uint8_t module_id, uint16_t sensor_id) const
+    {
+      std::shared_ptr<const SeriesMap> series ( std::atomic_load(&m_series) );
+      auto it ( series->find(series_key(module_id, sensor_id)) );
+      return it == series->end() ? nullptr : it->second;
+    }
+
+    void
+    SensorHistory::clear()
+    {
+      std::unique_lock<std::mutex> lock ( m_update_mutex );
+      std::shared_ptr<const SeriesMap> current ( std::atomic_load(&m_series) );
+      std::shared_ptr<SeriesMap> series ( std::make_shared<SeriesMap>() );
+      for ( const SeriesMap::value_type& entry : *current )
+        (*series)[entry.first] = std::make_shared<SensorSeries>
+          (entry.second->module_id, entry.second->sensor_id, entry.second->data_type, capacity);
+      std::atomic_store(&m_series, std::shared_ptr<const SeriesMap>(series));
+    }
+  }
+}
@@ -0,0 +1,141 @@
+#include <crisp/comms/SensorPoll.hh>
+
+#include <algorithm>
+#include <cstring>
+
+namespace crisp
+{
+  namespace comms
+  {
+    const MessageType SensorPoll::Type =
+      MessageType::SENSOR_POLL;
+
+    constexpr size_t SensorPoll::MaxSensors;
+
+    SensorPoll::SensorPoll()
+      : modules ( )
+    {}
+
+    SensorPoll&
+    SensorPoll::add(uint8_t module_id, uint16_t sensor_id)
+    {
+      if ( sensor_id >= MaxSensors )
+	return *this;
+
+      auto it ( std::lower_bound(modules.begin(), modules.end(), module_id,
+				 [](const ModuleSensors& ms, uint8_t id) { return ms.module_id < id; }) );
+      if ( it == modules.end() || it->module_id != module_id )
+	{
+	  ModuleSensors ms;
+	  memset(&ms, 0, sizeof(ms));
+	  ms.module_id = module_id;
+	  it = modules.insert(it, ms);
+	}
+
+      size_t byte ( sensor_id / 8 );
+      it->bitmap[byte] |= 1 << (sensor_id % 8);
+      if ( it->length <= byte )
+	it->length = byte + 1;
+      return *this;
+    }
+
+    SensorPoll&
+    SensorPoll::add(const Module& module, const Sensor<>& sensor)
+    { return add(module.id, sensor.id); }
+
+    SensorPoll&
+    SensorPoll::remove(uint8_t module_id, uint16_t sensor_id)
+    {
+      for ( auto it ( modules.begin() ); it != modules.end(); ++it )
+	if ( it->module_id == module_id )
+	  {
+	    if ( sensor_id < 8u * it->length )
+	      it->bitmap[sensor_id / 8] &= ~(1 << (sensor_id % 8));
+	    while ( it->length > 0 && ! it->bitmap[it->length - 1] )
+	      --it->length;
+	    if ( it->length == 0 )
+	      modules.erase(it);
+	    break;
+	  }
+      return *this;
+    }
+
+    bool
+    SensorPoll::contains(uint8_t module_id, uint16_t sensor_id) const
+    {
+      for ( const ModuleSensors& ms : modules )
+	if ( ms.module_id == module_id )
+	  return sensor_id < 8u * ms.length && (ms.bitmap[sensor_id / 8] & (1 << (sensor_id % 8)));
+      return false;
+    }
+
+    size_t
+    SensorPoll::size() const
+    {
+      size_t out ( 0 );
+      for ( const ModuleSensors& ms : modules )
+	for ( size_t i ( 0 ); i < ms.length; ++i )
+	  out += __builtin_popcount(ms.bitmap[i]);
+      return out;
+    }
+
+    size_t
+    SensorPoll::get_encoded_size() const
+    {
+      size_t out ( 0 );
+      for ( const ModuleSensors& ms : modules )
+	out += 2 * sizeof(uint8_t) + ms.length;
+      return out;
+    }
+
+    bool
+    SensorPoll::operator ==(const SensorPoll& poll) const
+    {
+      if ( modules.size() != poll.modules.size() )
+	return false;
+      for ( size_t i ( 0 ); i < modules.size(); ++i )
+	if ( modules[i].module_id != poll.modules[i].module_id || modules[i].length != poll.modules[i].length ||
+	     memcmp(modules[i].bitmap, poll.modules[i].bitmap, modules[i].length) )
+	  return false;
+      return true;
+    }
+
+    EncodeResult
+    SensorPoll::encode(MemoryEncodeBuffer& buf) const
+    {
+      EncodeResult r;
+      for ( const ModuleSensors& ms : modules )
+	if ( (r = buf.write(&ms, 2 * sizeof(uint8_t) + ms.length)) != EncodeResult::SUCCESS )
+	  return r;
+      return EncodeResult::SUCCESS;
+    }
+
+    DecodeResult
+    SensorPoll::decode(DecodeBuffer& buf)
+    {
+      modules.clear();
+
+      DecodeResult r ( DecodeResult::SUCCESS );
+      while ( buf.offset < buf.length )
+	{
+	  ModuleSensors ms;
+	  memset(&ms, 0, sizeof(ms));
+	  if ( (r = buf.read(&ms, 2 * sizeof(uint8_t))) != DecodeResult::SUCCESS )
+	    break;
+	  if ( ms.length > sizeof(ms.bitmap) ||
+	       (! modules.empty() && modules.back().module_id >= ms.module_id) )
+	    {
+	      r = DecodeResult::INVALID_DATA;
+	      break;
+	    }
+	  if ( (r = buf.read(ms.bitmap, ms.length)) != DecodeResult::SUCCESS )
+	    break;
+	  modules.push_back(ms);
+	}
+
+      if ( r != DecodeResult::SUCCESS )
+	modules.clear();
+      return r;
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#include <crisp/comms/SensorReaders.hh>
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/SensorData.hh>
+#include <crisp/comms/SensorPoll.hh>
+
+namespace crisp
+{
+  namespace comms
+  {
+    SensorReaders::SensorReaders()
+      : m_mutex ( ),
+        m_readers ( )
+    {}
+
+    void
+    SensorReaders::set(uint8_t module_id, uint16_t sensor_id, Function function)
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      m_readers[static_cast<uint32_t>(module_id) << 16 | sensor_id] = function;
+    }
+
+    void
+    SensorReaders::remove(uint8_t module_id, uint16_t sensor_id)
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      m_readers.erase(static_cast<uint32_t>(module_id) << 16 | sensor_id);
+    }
+
+    size_t
+    SensorReaders::read(const SensorPoll& poll, const Configuration& config, SensorData& out) const
+    {
+      std::unique_lock<std::mutex> lock ( m_mutex );
+      size_t count ( 0 );
+      uint8_t value[UINT8_MAX];
+
+      poll.for_each
+        ([&](uint8_t module_id, uint16_t sensor_id)
+         {
+           if ( module_id >= config.num_modules )
+             return;
+           auto it ( m_readers.find(static_cast<uint32_t>(module_id) << 16 | sensor_id) );
+           if ( it == m_readers.end() )
+             return;
+
+           const Module& module ( config.modules[module_id] );
+           for ( size_t i ( 0 ); i < module.num_sensors; ++i )
+             if ( module.sensors[i].id == sensor_id )
+               {
+                 if ( it->second(value) && out.add(module_id, module.sensors[i], out.base_time, value) )
+                   ++count;
+                 break;
+               }
+         });
+      return count;
+    }
+  }
+}
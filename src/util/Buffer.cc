@@ -1,4 +1,5 @@
 #include <crisp/util/Buffer.hh>
+#include <crisp/util/BufferPool.hh>
 #include <cstring>
 
 namespace crisp
@@ -9,7 +10,10 @@ namespace crisp
       : data ( const_cast<char*>(_data) ),
         length ( _length ),
         owns_data ( false ),
-        free_function ( nullptr )
+        free_function ( nullptr ),
+        owner ( ),
+        pool ( ),
+        size_class ( 0 )
     {}
 
 
@@ -17,14 +21,20 @@ namespace crisp
       : data ( _data ),
         length ( _length ),
         owns_data ( true ),
-        free_function ( ff )
+        free_function ( ff ),
+        owner ( ),
+        pool ( ),
+        size_class ( 0 )
     {}
 
     Buffer::Buffer(size_t _length)
       : data ( static_cast<char*>(malloc(_length)) ),
 	length ( _length ),
 	owns_data ( true ),
-	free_function ( free )
+	free_function ( free ),
+	owner ( ),
+	pool ( ),
+	size_class ( 0 )
     {
       assert(data != nullptr);
       memset(data, 0, _length);
@@ -34,23 +44,34 @@ namespace crisp
       : data ( b.data ),
 	length ( b.length ),
 	owns_data ( b.owns_data ),
-	free_function ( b.free_function )
+	free_function ( b.free_function ),
+	owner ( std::move(b.owner) ),
+	pool ( ),
+	size_class ( 0 )
     {
+      /* `b` no longer has the data it was allocated with, so it can't go back to its pool. */
       b.owns_data = false;
+      b.pool.reset();
     }
 
     Buffer::Buffer()
       : data ( nullptr ),
         length ( 0 ),
         owns_data ( false ),
-        free_function ( nullptr )
+        free_function ( nullptr ),
+        owner ( ),
+        pool ( ),
+        size_class ( 0 )
     {}
 
     Buffer::Buffer(const Buffer& b)
       : data ( static_cast<char*>(malloc(b.length)) ),
 	length ( b.length ),
 	owns_data ( true ),
-	free_function ( free )
+	free_function ( free ),
+	owner ( ),
+	pool ( ),
+	size_class ( 0 )
     {
       memcpy(data, b.data, length);
     }
@@ -62,6 +83,19 @@ namespace crisp
       data = nullptr;
     }
 
+    void
+    Buffer::dispose()
+    {
+      if ( pool )
+	{
+	  /* Hold the pool reference until `recycle` is done with it. */
+	  RefTraits<BufferPool>::stored_ref p ( std::move(pool) );
+	  p->recycle(this);
+	}
+      else
+	delete this;
+    }
+
     void
     Buffer::resize(size_t capacity)
     {
@@ -71,13 +105,15 @@ namespace crisp
 	  memcpy(ndata, data, std::min(length, capacity));
 	  if ( length < capacity )
 	    memset(ndata + length, 0, capacity - length);
-	  data = ndata; length = capacity; owns_data = true;
+	  data = ndata; length = capacity; owns_data = true; free_function = free;
+	  owner.reset();
 	}
       else
 	{
 	  data = static_cast<char*>(realloc(data, capacity * sizeof( char)));
 	  length = capacity;
 	}
+      pool.reset();
     }
 
     void
@@ -89,8 +125,11 @@ namespace crisp
       length = b.length;
       owns_data = b.owns_data;
       free_function = b.free_function;
+      owner = std::move(b.owner);
+      pool.reset();
 
       b.data = nullptr;
+      b.pool.reset();
       b.owns_data = false;
       b.free_function = nullptr;
     }
@@ -113,6 +152,16 @@ namespace crisp
     }
 
 
+    Buffer*
+    Buffer::slice(Buffer* parent, size_t offset, size_t length)
+    {
+      assert(offset + length <= parent->length);
+      Buffer* out ( new Buffer(parent->data + offset, length) );
+      out->owner.reset(parent);
+      return out;
+    }
+
+
     Buffer
     Buffer::copy(const Buffer& buf)
     {
@@ -0,0 +1,145 @@
+#include <crisp/util/BufferPool.hh>
+#include <cassert>
+#include <cstdlib>
+
+namespace crisp
+{
+  namespace util
+  {
+    constexpr size_t BufferPool::MinSize;
+    constexpr size_t BufferPool::MaxSize;
+    constexpr size_t BufferPool::NumSizeClasses;
+    constexpr uint8_t BufferPool::SliceClass;
+
+    static_assert((BufferPool::MinSize << (BufferPool::NumSizeClasses - 1)) == BufferPool::MaxSize,
+                  "BufferPool size classes don't match MinSize and MaxSize");
+
+    /** Get the smallest size class that can hold the given number of bytes. */
+    static inline uint8_t
+    size_class_for(size_t length)
+    {
+      uint8_t c ( 0 );
+      while ( (BufferPool::MinSize << c) < length )
+        ++c;
+      return c;
+    }
+
+    BufferPool::BufferPool(size_t max_free_per_class)
+      : m_max_free_per_class ( max_free_per_class ),
+        m_free ( ),
+        m_hits ( 0 ),
+        m_misses ( 0 ),
+        m_returns ( 0 ),
+        m_discards ( 0 )
+    {
+      for ( FreeList& list : m_free )
+        list.buffers.reserve(max_free_per_class);
+    }
+
+    BufferPool::~BufferPool()
+    {
+      for ( FreeList& list : m_free )
+        for ( Buffer* buffer : list.buffers )
+          delete buffer;
+    }
+
+    Buffer*
+    BufferPool::take(uint8_t size_class)
+    {
+      FreeList& list ( m_free[size_class] );
+      std::unique_lock<std::mutex> lock ( list.mutex );
+      if ( list.buffers.empty() )
+        return nullptr;
+
+      Buffer* out ( list.buffers.back() );
+      list.buffers.pop_back();
+      return out;
+    }
+
+    Buffer*
+    BufferPool::acquire(size_t length)
+    {
+      if ( length > MaxSize )
+        {
+          ++m_misses;
+          return new Buffer(length);
+        }
+
+      uint8_t size_class ( size_class_for(length) );
+      Buffer* out ( take(size_class) );
+      if ( out )
+        ++m_hits;
+      else
+        {
+          ++m_misses;
+          size_t capacity ( MinSize << size_class );
+          out = new Buffer(static_cast<char*>(malloc(capacity)), capacity, &free);
+          out->size_class = size_class;
+        }
+
+      out->length = length;
+      out->pool.reset(this);
+      return out;
+    }
+
+    Buffer*
+    BufferPool::slice(Buffer* parent, size_t offset, size_t length)
+    {
+      assert(offset + length <= parent->length);
+
+      Buffer* out ( take(SliceClass) );
+      if ( out )
+        ++m_hits;
+      else
+        {
+          ++m_misses;
+          out = new Buffer();
+          out->size_class = SliceClass;
+        }
+
+      out->data = parent->data + offset;
+      out->length = length;
+      out->owner.reset(parent);
+      out->pool.reset(this);
+      return out;
+    }
+
+    void
+    BufferPool::recycle(Buffer* buffer)
+    {
+      if ( buffer->size_class == SliceClass )
+        {
+          /* This may well return the parent buffer to the pool too. */
+          buffer->owner.reset();
+          buffer->data = nullptr;
+          buffer->length = 0;
+        }
+      else
+        buffer->length = MinSize << buffer->size_class;
+
+      {
+        FreeList& list ( m_free[buffer->size_class] );
+        std::unique_lock<std::mutex> lock ( list.mutex );
+        if ( list.buffers.size() < m_max_free_per_class )
+          {
+            list.buffers.push_back(buffer);
+            buffer = nullptr;
+          }
+      }
+
+      if ( buffer )
+        {
+          ++m_discards;
+          delete buffer;
+        }
+      else
+        ++m_returns;
+    }
+
+    BufferPool::Statistics
+    BufferPool::get_statistics() const
+    {
+      return { m_hits.load(), m_misses.load(), m_returns.load(), m_discards.load() };
+    }
+  }
+}
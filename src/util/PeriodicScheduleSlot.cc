@@ -82,7 +82,12 @@ namespace crisp
     PeriodicScheduleSlot::timer_expiry_handler(const boost::system::error_code& ec)
     {
       if ( ! ec )
-        reset_timer();
+        {
+          /* The last action may have been removed after the timer expired but before this
+             handler ran; re-arming the timer then would keep the io_service busy forever.  */
+          if ( ! m_actions.empty() )
+            reset_timer();
+        }
       else if ( ec != boost::asio::error::operation_aborted )
         fprintf(stderr, "timer error: %s\n", ec.message().c_str());
     }
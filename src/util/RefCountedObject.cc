@@ -16,5 +16,11 @@ namespace crisp
       else if ( refCount < 0 )
 	throw std::runtime_error("In RefCountedObject::~RefCountedObject(): destructor called with refCount < 0");
     }
+
+    void
+    RefCountedObject::dispose()
+    {
+      delete this;
+    }
   }
 }
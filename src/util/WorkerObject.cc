@@ -44,10 +44,13 @@ namespace crisp
     {
       bool running ( thread.joinable() );
       if ( ! running )
+        /* `run` only returns once the service runs out of work, which it may never do while
+           other objects share it (or while `halt` is flooding it with wake-up handlers), so
+           check the halt flag after every handler instead.  */
         thread = std::thread([&]()
                              {
                                while ( ! should_halt )
-                                 service.run();
+                                 service.run_one();
                              });
       return ! running;
     }
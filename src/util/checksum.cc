@@ -1,4 +1,12 @@
 #include <crisp/util/checksum.hh>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define CRISP_HAVE_CRC32_CLMUL 1
+#  include <cpuid.h>
+#  include <immintrin.h>
+#endif
+
 
 /* For information on how this table was generated, see pretty much any good CRC32 reference
    implementation.
@@ -57,13 +65,306 @@ update_crc32(uint32_t crc, const unsigned char *buf, size_t len)
   return c;
 }
 
+/* ----------------------------------------------------------------
+ * Slicing-by-N kernels.
+ *
+ * Table k maps a byte to the CRC contribution of that byte followed by k zero bytes, which
+ * lets us fold N input bytes into the running CRC with N independent table lookups per
+ * iteration instead of N dependent ones.  The tables are derived from `crc32_table` on first
+ * use.
+ */
+namespace
+{
+  struct SliceTables
+  {
+    uint32_t t[16][256];
+
+    SliceTables()
+    {
+      for ( size_t i = 0; i < 256; ++i )
+        t[0][i] = crc32_table[i];
+      for ( size_t k = 1; k < 16; ++k )
+        for ( size_t i = 0; i < 256; ++i )
+          t[k][i] = (t[k - 1][i] >> 8) ^ crc32_table[t[k - 1][i] & 0xFF];
+    }
+  };
+
+  const SliceTables&
+  slice_tables()
+  {
+    static const SliceTables tables;
+    return tables;
+  }
+
+  inline uint32_t
+  load_le32(const unsigned char* p)
+  {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    return static_cast<uint32_t>(p[0])
+      | (static_cast<uint32_t>(p[1]) << 8)
+      | (static_cast<uint32_t>(p[2]) << 16)
+      | (static_cast<uint32_t>(p[3]) << 24);
+#endif
+  }
+
+  uint32_t
+  update_crc32_slice8(uint32_t c, const unsigned char* p, size_t n)
+  {
+    const uint32_t (&t)[16][256] ( slice_tables().t );
+
+    for ( ; n >= 8; p += 8, n -= 8 )
+      {
+        uint32_t one ( load_le32(p) ^ c );
+        uint32_t two ( load_le32(p + 4) );
+        c = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^ t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24]
+          ^ t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^ t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+      }
+    return update_crc32(c, p, n);
+  }
+
+  uint32_t
+  update_crc32_slice16(uint32_t c, const unsigned char* p, size_t n)
+  {
+    const uint32_t (&t)[16][256] ( slice_tables().t );
+
+    for ( ; n >= 16; p += 16, n -= 16 )
+      {
+        uint32_t one ( load_le32(p) ^ c );
+        uint32_t two ( load_le32(p + 4) );
+        uint32_t three ( load_le32(p + 8) );
+        uint32_t four ( load_le32(p + 12) );
+        c = t[15][one & 0xFF] ^ t[14][(one >> 8) & 0xFF] ^ t[13][(one >> 16) & 0xFF] ^ t[12][one >> 24]
+          ^ t[11][two & 0xFF] ^ t[10][(two >> 8) & 0xFF] ^ t[9][(two >> 16) & 0xFF] ^ t[8][two >> 24]
+          ^ t[7][three & 0xFF] ^ t[6][(three >> 8) & 0xFF] ^ t[5][(three >> 16) & 0xFF] ^ t[4][three >> 24]
+          ^ t[3][four & 0xFF] ^ t[2][(four >> 8) & 0xFF] ^ t[1][(four >> 16) & 0xFF] ^ t[0][four >> 24];
+      }
+    return update_crc32_slice8(c, p, n);
+  }
+
+
+  /* ----------------------------------------------------------------
+   * Carry-less multiplication kernel.
+   *
+   * Folds four 128-bit lanes at a time using PCLMULQDQ, then reduces to 32 bits with a
+   * Barrett reduction; this is the algorithm from Intel's "Fast CRC Computation for Generic
+   * Polynomials Using PCLMULQDQ Instruction" white paper, with the constants for the
+   * bit-reflected IEEE polynomial.  Only the x86 build contains it, and it is only selected
+   * when CPUID reports PCLMULQDQ and SSE4.1 support, so the rest of the library can still be
+   * built for a baseline target.
+   */
+#ifdef CRISP_HAVE_CRC32_CLMUL
+  /* Inputs shorter than this aren't worth the setup cost of the folding loop. */
+  constexpr size_t CLMUL_MINIMUM_LENGTH = 64;
+
+  bool
+  cpu_has_clmul()
+  {
+    unsigned int eax, ebx, ecx, edx;
+    if ( ! __get_cpuid(1, &eax, &ebx, &ecx, &edx) )
+      return false;
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSE4_1);
+  }
+
+  /* Requires `n >= 64` and `n % 16 == 0`. */
+  __attribute__ (( target("pclmul,sse4.1") ))
+  uint32_t
+  fold_crc32_clmul(uint32_t crc, const unsigned char* p, size_t n)
+  {
+    const __m128i k1k2 ( _mm_set_epi64x(0x01C6E41596, 0x0154442BD4) );
+    const __m128i k3k4 ( _mm_set_epi64x(0x00CCAA009E, 0x01751997D0) );
+    const __m128i k5k0 ( _mm_set_epi64x(0x0000000000, 0x0163CD6124) );
+    const __m128i poly ( _mm_set_epi64x(0x01F7011641, 0x01DB710641) );
+    const __m128i mask32 ( _mm_setr_epi32(~0, 0, ~0, 0) );
+
+    __m128i x1 ( _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)) );
+    __m128i x2 ( _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)) );
+    __m128i x3 ( _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)) );
+    __m128i x4 ( _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)) );
+    __m128i x5, x6, x7, x8;
+
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    p += 64;
+    n -= 64;
+
+    /* Fold 512 bits at a time. */
+    for ( ; n >= 64; p += 64, n -= 64 )
+      {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 0x30)));
+      }
+
+    /* Fold the four lanes into one. */
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* Fold any remaining 128-bit blocks. */
+    for ( ; n >= 16; p += 16, n -= 16 )
+      {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), x5);
+      }
+
+    /* 128 bits -> 64 bits. */
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits. */
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+  }
+
+  uint32_t
+  update_crc32_clmul(uint32_t c, const unsigned char* p, size_t n)
+  {
+    if ( n >= CLMUL_MINIMUM_LENGTH )
+      {
+        size_t folded ( n & ~static_cast<size_t>(15) );
+        c = fold_crc32_clmul(c, p, folded);
+        p += folded;
+        n -= folded;
+      }
+    return update_crc32_slice8(c, p, n);
+  }
+#endif	/* CRISP_HAVE_CRC32_CLMUL */
+
+
+  typedef uint32_t (*UpdateFunction)(uint32_t, const unsigned char*, size_t);
+
+  UpdateFunction
+  get_update_function(crisp::util::CRC32Kernel kernel)
+  {
+    using crisp::util::CRC32Kernel;
+    switch ( kernel )
+      {
+      case CRC32Kernel::BYTEWISE: return update_crc32;
+      case CRC32Kernel::SLICE_BY_8: return update_crc32_slice8;
+      case CRC32Kernel::SLICE_BY_16: return update_crc32_slice16;
+#ifdef CRISP_HAVE_CRC32_CLMUL
+      case CRC32Kernel::CLMUL: return update_crc32_clmul;
+#else
+      case CRC32Kernel::CLMUL: break;
+#endif
+      }
+    return nullptr;
+  }
+
+  crisp::util::CRC32Kernel
+  select_kernel()
+  {
+    using crisp::util::CRC32Kernel;
+#ifdef CRISP_HAVE_CRC32_CLMUL
+    if ( cpu_has_clmul() )
+      return CRC32Kernel::CLMUL;
+    return CRC32Kernel::SLICE_BY_16;
+#else
+    /* The small L1 caches on our ARM targets don't have room for sixteen tables. */
+    return CRC32Kernel::SLICE_BY_8;
+#endif
+  }
+
+  struct DefaultKernel
+  {
+    crisp::util::CRC32Kernel kernel;
+    UpdateFunction update;
+
+    DefaultKernel()
+      : kernel ( select_kernel() ),
+        update ( get_update_function(kernel) )
+    {}
+  };
+
+  const DefaultKernel&
+  default_kernel()
+  {
+    static const DefaultKernel k;
+    return k;
+  }
+}
+
 namespace crisp
 {
   namespace util
   {
     uint32_t crc32(const void* data, size_t length)
     {
-      return update_crc32(0xffffffffL, reinterpret_cast<const unsigned char*>(data), length) ^ 0xffffffffL;
+      return crc32_finish(crc32_update(crc32_begin(), data, length));
+    }
+
+    uint32_t crc32_update(uint32_t state, const void* data, size_t length)
+    {
+      /* Message headers and tiny bodies aren't worth an indirect call.  */
+      if ( length < 8 )
+        return update_crc32(state, reinterpret_cast<const unsigned char*>(data), length);
+      return default_kernel().update(state, reinterpret_cast<const unsigned char*>(data), length);
+    }
+
+    uint32_t crc32_update(CRC32Kernel kernel, uint32_t state, const void* data, size_t length)
+    {
+      return get_update_function(kernel)(state, reinterpret_cast<const unsigned char*>(data), length);
+    }
+
+    bool crc32_kernel_supported(CRC32Kernel kernel)
+    {
+      if ( kernel == CRC32Kernel::CLMUL )
+#ifdef CRISP_HAVE_CRC32_CLMUL
+        return cpu_has_clmul();
+#else
+        return false;
+#endif
+      return true;
+    }
+
+    CRC32Kernel crc32_default_kernel()
+    {
+      return default_kernel().kernel;
+    }
+
+    const char* crc32_kernel_name(CRC32Kernel kernel)
+    {
+      switch ( kernel )
+        {
+        case CRC32Kernel::BYTEWISE: return "bytewise";
+        case CRC32Kernel::SLICE_BY_8: return "slice-by-8";
+        case CRC32Kernel::SLICE_BY_16: return "slice-by-16";
+        case CRC32Kernel::CLMUL: return "clmul";
+        }
+      return "unknown";
     }
   }
 }
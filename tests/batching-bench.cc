@@ -0,0 +1,139 @@
+/** @file
+ *
+ * Outgoing-message coalescing benchmark.  Connects a master and a slave node over TCP
+ * loopback, floods the slave with MODULE_CONTROL messages under several batching settings,
+ * and reports messages per second and write and read syscalls per message.
+ *
+ * Syscalls are counted by interposing the libc socket-IO functions in this executable.
+ */
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef BasicNode<boost::asio::ip::tcp> Node;
+
+/* ****************************************************************
+ * Syscall counting.
+ */
+static std::atomic<unsigned long> write_syscalls ( 0 ), read_syscalls ( 0 );
+
+#define INTERPOSE(counter, ret, name, params, args)                     \
+  extern "C" ret name params                                            \
+  {                                                                     \
+    typedef ret (*function_type) params;                                \
+    static function_type real ( reinterpret_cast<function_type>(dlsym(RTLD_NEXT, #name)) ); \
+    ++counter;                                                          \
+    return real args;                                                   \
+  }
+
+INTERPOSE(write_syscalls, ssize_t, sendmsg, (int fd, const struct msghdr* msg, int flags), (fd, msg, flags))
+INTERPOSE(write_syscalls, ssize_t, send, (int fd, const void* buf, size_t len, int flags), (fd, buf, len, flags))
+INTERPOSE(write_syscalls, ssize_t, writev, (int fd, const struct iovec* iov, int iovcnt), (fd, iov, iovcnt))
+INTERPOSE(read_syscalls, ssize_t, recvmsg, (int fd, struct msghdr* msg, int flags), (fd, msg, flags))
+INTERPOSE(read_syscalls, ssize_t, recv, (int fd, void* buf, size_t len, int flags), (fd, buf, len, flags))
+INTERPOSE(read_syscalls, ssize_t, readv, (int fd, const struct iovec* iov, int iovcnt), (fd, iov, iovcnt))
+/* **************************************************************** */
+
+
+static void
+run(const char* label, Node& master, size_t max_messages, std::chrono::microseconds max_delay,
+    const Message& message, size_t count, std::atomic<size_t>& received)
+{
+  master.set_batching({ max_messages, 16384, max_delay });
+
+  size_t initial_received ( received );
+  unsigned long initial_writes ( write_syscalls ), initial_reads ( read_syscalls );
+  std::chrono::steady_clock::time_point start ( std::chrono::steady_clock::now() );
+
+  for ( size_t i = 0; i < count; ++i )
+    master.send(message);
+
+  while ( received - initial_received < count )
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+
+  std::chrono::duration<double> elapsed ( std::chrono::steady_clock::now() - start );
+  unsigned long
+    writes ( write_syscalls - initial_writes ),
+    reads ( read_syscalls - initial_reads );
+
+  printf("%-28s %12.0f %12.3f %12.3f\n", label, count / elapsed.count(),
+         static_cast<double>(writes) / count, static_cast<double>(reads) / count);
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 200000 );
+
+  using namespace crisp::comms::keywords;
+  namespace ip = boost::asio::ip;
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  /* Each node gets its own io_service so that neither can starve the other's worker pool. */
+  boost::asio::io_service master_service, slave_service;
+
+  /* Set up a connected pair of sockets over loopback. */
+  ip::tcp::acceptor acceptor ( slave_service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) );
+  ip::tcp::socket master_socket ( master_service ), slave_socket ( slave_service );
+  master_socket.connect(acceptor.local_endpoint());
+  acceptor.accept(slave_socket);
+
+  Node
+    slave ( std::move(slave_socket), NodeRole::SLAVE ),
+    master ( std::move(master_socket), NodeRole::MASTER );
+
+  slave.configuration.add_module( "drive", 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } });
+  master.configuration = slave.configuration;
+
+  /* Every message sent should arrive. */
+  master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+
+  /* Silence the default (printing) handlers. */
+  std::atomic<size_t> received ( 0 );
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect([&](Node&, const ModuleControl&) { ++received; });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  slave.launch();
+  master.launch();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  ModuleControl control ( &master.configuration.modules[0] );
+  control.set<int8_t>("speed", 100);
+  control.set<int8_t>("turn", -20);
+  const Message message ( std::move(control) );
+
+  printf("%-28s %12s %12s %12s\n", "batching", "messages/s", "writes/msg", "reads/msg");
+  run("off", master, 1, std::chrono::microseconds(0), message, count, received);
+  run("16 messages", master, 16, std::chrono::microseconds(0), message, count, received);
+  run("64 messages", master, 64, std::chrono::microseconds(0), message, count, received);
+  run("64 messages, 100 us delay", master, 64, std::chrono::microseconds(100), message, count, received);
+
+  crisp::util::BufferPool::Statistics pool ( slave.buffer_pool->get_statistics() );
+  printf("receiver buffer pool: %zu hits, %zu misses, %zu discards\n",
+         pool.hits, pool.misses, pool.discards);
+
+  master.halt();
+  slave.halt();
+  return 0;
+}
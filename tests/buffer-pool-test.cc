@@ -0,0 +1,119 @@
+/** @file
+ *
+ * Test for BufferPool: buffers and slices must be recycled when released, slices must keep
+ * their parent buffers alive, and messages built from pooled buffers must round-trip.
+ */
+#include <crisp/util/BufferPool.hh>
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/ModuleControl.hh>
+#include <crisp/comms/Configuration.hh>
+
+#include <cstdio>
+#include <cstring>
+
+using namespace crisp::util;
+using namespace crisp::comms;
+
+static size_t failures ( 0 );
+
+#define CHECK(cond)                                                     \
+  do { if ( ! (cond) ) { ++failures; fprintf(stderr, "FAIL (line %d): %s\n", __LINE__, #cond); } } while ( 0 )
+
+int
+main()
+{
+  using namespace crisp::comms::keywords;
+  RefTraits<BufferPool>::stored_ref pool ( new BufferPool(4) );
+
+  /* A released buffer is handed out again by a request in the same size class. */
+  {
+    boost::intrusive_ptr<Buffer> a ( pool->acquire(100) );
+    CHECK(a->length == 100);
+    CHECK(a->pool == pool);
+    const char* data ( a->data );
+    a.reset();
+
+    a.reset(pool->acquire(120));
+    CHECK(a->data == data);
+    CHECK(a->length == 120);
+
+    BufferPool::Statistics stats ( pool->get_statistics() );
+    CHECK(stats.misses == 1);
+    CHECK(stats.hits == 1);
+    CHECK(stats.returns == 1);
+  }
+
+  /* Oversized requests bypass the pool. */
+  {
+    boost::intrusive_ptr<Buffer> big ( pool->acquire(BufferPool::MaxSize + 1) );
+    CHECK(big->length == BufferPool::MaxSize + 1);
+    CHECK(! big->pool);
+  }
+
+  /* A slice keeps its parent alive, and both go back to the pool once released. */
+  {
+    BufferPool::Statistics before ( pool->get_statistics() );
+    boost::intrusive_ptr<Buffer> slice;
+    {
+      boost::intrusive_ptr<Buffer> parent ( pool->acquire(64) );
+      memcpy(parent->data, "0123456789abcdef", 16);
+      slice.reset(pool->slice(parent.get(), 4, 8));
+    }
+    CHECK(slice->length == 8);
+    CHECK(memcmp(slice->data, "456789ab", 8) == 0);
+    CHECK(pool->get_statistics().returns == before.returns);
+
+    slice.reset();
+    CHECK(pool->get_statistics().returns == before.returns + 2);
+  }
+
+  /* Buffers beyond the per-class limit are freed. */
+  {
+    BufferPool::Statistics before ( pool->get_statistics() );
+    {
+      boost::intrusive_ptr<Buffer> held[6];
+      for ( boost::intrusive_ptr<Buffer>& b : held )
+        b.reset(pool->acquire(16));
+    }
+    CHECK(pool->get_statistics().discards == before.discards + 2);
+  }
+
+  /* Messages encoded into, and decoded from, pooled buffers round-trip. */
+  {
+    Configuration config;
+    config.add_module("drive", 1)
+      .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -100, _maximum = 100 } });
+
+    ModuleControl control ( &config.modules[0] );
+    control.set<int8_t>("speed", -42);
+    Message m ( control, pool.get() );
+    CHECK(m.body->pool == pool);
+
+    MemoryEncodeBuffer eb ( m.get_encoded_size(), *pool );
+    m.encode(eb);
+
+    BufferPool::Statistics before ( pool->get_statistics() );
+    for ( size_t i ( 0 ); i < 1000; ++i )
+      {
+        DecodeBuffer db ( eb.buffer );
+        Message d ( Message::decode_slice(db, pool.get()) );
+        CHECK(d.checksum_ok());
+        ModuleControl dc ( d.as<ModuleControl>(config) );
+        CHECK(dc.get_num_values() == 1 && dc.values[0].value.get<int8_t>() == -42);
+        if ( failures )
+          break;
+      }
+    CHECK(pool->get_statistics().misses == before.misses);
+  }
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  BufferPool::Statistics stats ( pool->get_statistics() );
+  fprintf(stderr, "All checks passed (%zu hits, %zu misses, %zu returns, %zu discards).\n",
+          stats.hits, stats.misses, stats.returns, stats.discards);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/** @file
+ *
+ * CRC-32 throughput benchmark.  Reports MB/s for each supported kernel at buffer sizes from
+ * 8 bytes (a tiny message) to 64 KiB (the largest possible message body).
+ */
+#include <crisp/util/checksum.hh>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace crisp::util;
+
+static const CRC32Kernel kernels[] =
+  { CRC32Kernel::BYTEWISE, CRC32Kernel::SLICE_BY_8, CRC32Kernel::SLICE_BY_16, CRC32Kernel::CLMUL };
+
+int
+main(int argc, char* argv[])
+{
+  /* Approximate number of bytes to checksum per measurement. */
+  size_t volume ( argc > 1 ? strtoul(argv[1], NULL, 0) : (256u << 20) );
+
+  std::vector<unsigned char> data ( 65536 );
+  for ( size_t i = 0; i < data.size(); ++i )
+    data[i] = static_cast<unsigned char>(i * 2654435761u >> 24);
+
+  printf("%-12s", "size");
+  for ( CRC32Kernel kernel : kernels )
+    if ( crc32_kernel_supported(kernel) )
+      printf(" %12s", crc32_kernel_name(kernel));
+  printf("   (MB/s; default kernel is %s)\n", crc32_kernel_name(crc32_default_kernel()));
+
+  for ( size_t size = 8; size <= data.size(); size *= 2 )
+    {
+      printf("%-12zu", size);
+      size_t iterations ( volume / size );
+
+      for ( CRC32Kernel kernel : kernels )
+        {
+          if ( ! crc32_kernel_supported(kernel) )
+            continue;
+
+          uint32_t state ( crc32_begin() );
+          /* Warm up tables and caches. */
+          for ( size_t i = 0; i < iterations / 16 + 1; ++i )
+            state = crc32_update(kernel, state, data.data(), size);
+
+          std::chrono::steady_clock::time_point start ( std::chrono::steady_clock::now() );
+          for ( size_t i = 0; i < iterations; ++i )
+            state = crc32_update(kernel, state, data.data(), size);
+          std::chrono::duration<double> elapsed ( std::chrono::steady_clock::now() - start );
+
+          /* Print the state so the loop can't be optimized away. */
+          volatile uint32_t sink ( state );
+          (void) sink;
+          printf(" %12.1f", (iterations * size) / elapsed.count() / 1e6);
+        }
+      printf("\n");
+    }
+  return 0;
+}
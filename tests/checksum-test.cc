@@ -0,0 +1,107 @@
+/** @file
+ *
+ * Conformance test for the CRC-32 kernels: every kernel, and the incremental interface, must
+ * produce exactly the same results as the original bytewise implementation for arbitrary
+ * lengths, alignments, and split points.
+ */
+#include <crisp/util/checksum.hh>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace crisp::util;
+
+static const CRC32Kernel kernels[] =
+  { CRC32Kernel::BYTEWISE, CRC32Kernel::SLICE_BY_8, CRC32Kernel::SLICE_BY_16, CRC32Kernel::CLMUL };
+
+/* Bit-at-a-time CRC-32; deliberately shares no code or tables with the library. */
+static uint32_t
+reference_crc32(const unsigned char* p, size_t n)
+{
+  uint32_t c ( 0xFFFFFFFF );
+  while ( n-- )
+    {
+      c ^= *p++;
+      for ( int k = 0; k < 8; ++k )
+        c = (c >> 1) ^ (0xEDB88320 & (0 - (c & 1)));
+    }
+  return c ^ 0xFFFFFFFF;
+}
+
+static size_t failures ( 0 );
+
+static void
+check(const char* what, CRC32Kernel kernel, size_t offset, size_t length, uint32_t expected, uint32_t actual)
+{
+  if ( expected != actual )
+    {
+      fprintf(stderr, "FAIL: %s [%s] offset %zu length %zu: expected 0x%08X, got 0x%08X\n",
+              what, crc32_kernel_name(kernel), offset, length, expected, actual);
+      ++failures;
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+  unsigned int seed ( argc > 1 ? strtoul(argv[1], NULL, 0) : 0x5EED );
+  std::mt19937 rng ( seed );
+
+  fprintf(stderr, "Default kernel: %s\n", crc32_kernel_name(crc32_default_kernel()));
+
+  /* Standard check value. */
+  check("check value", crc32_default_kernel(), 0, 9, 0xCBF43926, crc32("123456789", 9));
+
+  static constexpr size_t max_length ( 70000 );
+  std::vector<unsigned char> data ( max_length + 16 );
+  for ( unsigned char& c : data )
+    c = static_cast<unsigned char>(rng());
+
+  /* Every length up to a few cache lines, at every alignment, then a spread of larger ones. */
+  std::vector<size_t> lengths;
+  for ( size_t n = 0; n <= 300; ++n )
+    lengths.push_back(n);
+  for ( size_t n = 512; n <= 65536; n *= 2 )
+    {
+      lengths.push_back(n - 1);
+      lengths.push_back(n);
+      lengths.push_back(n + 1);
+    }
+  for ( size_t i = 0; i < 64; ++i )
+    lengths.push_back(rng() % max_length);
+
+  for ( size_t length : lengths )
+    for ( size_t offset = 0; offset < 16; ++offset )
+      {
+        const unsigned char* p ( data.data() + offset );
+        uint32_t expected ( reference_crc32(p, length) );
+
+        check("crc32", crc32_default_kernel(), offset, length, expected, crc32(p, length));
+
+        for ( CRC32Kernel kernel : kernels )
+          if ( crc32_kernel_supported(kernel) )
+            check("kernel", kernel, offset, length, expected,
+                  crc32_finish(crc32_update(kernel, crc32_begin(), p, length)));
+
+        /* Incremental use, split at a random point. */
+        size_t split ( length ? rng() % (length + 1) : 0 );
+        uint32_t state ( crc32_begin() );
+        state = crc32_update(state, p, split);
+        state = crc32_update(state, p + split, length - split);
+        check("incremental", crc32_default_kernel(), offset, length, expected, crc32_finish(state));
+      }
+
+  if ( ! crc32_kernel_supported(CRC32Kernel::CLMUL) )
+    fprintf(stderr, "note: CLMUL kernel not supported on this machine; not tested\n");
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+  fprintf(stderr, "All CRC-32 results match the reference.\n");
+  return 0;
+}
@@ -0,0 +1,162 @@
+/** @file
+ *
+ * Control-latency benchmark for the outgoing-queue policies.  A master node streams
+ * MODULE_CONTROL messages to a slave node through a relay that limits the master-to-slave
+ * link to a fixed bandwidth -- lower than the control stream needs -- and the slave measures
+ * how old each control value is when it arrives.  Runs once with each queue policy.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef BasicNode<boost::asio::ip::tcp> Node;
+typedef std::chrono::steady_clock Clock;
+namespace ip = boost::asio::ip;
+
+/** Forward data from one socket to another, optionally limiting the rate at which it's
+    forwarded.  Returns when either socket is closed. */
+static void
+relay(ip::tcp::socket& from, ip::tcp::socket& to, size_t bytes_per_second)
+{
+  char buf[256];
+  size_t total ( 0 );
+  Clock::time_point start ( Clock::now() );
+  boost::system::error_code ec;
+
+  while ( true )
+    {
+      size_t n ( from.read_some(boost::asio::buffer(buf, bytes_per_second ? 64 : sizeof(buf)), ec) );
+      if ( ec )
+        break;
+      boost::asio::write(to, boost::asio::buffer(buf, n), ec);
+      if ( ec )
+        break;
+
+      total += n;
+      if ( bytes_per_second )
+        std::this_thread::sleep_until(start + std::chrono::microseconds(total * 1000000 / bytes_per_second));
+    }
+  to.shutdown(ip::tcp::socket::shutdown_both, ec);
+}
+
+static void
+run(const char* label, QueuePolicy policy, unsigned int rate, double duration, size_t link_bytes_per_second)
+{
+  using namespace crisp::comms::keywords;
+
+  boost::asio::io_service master_service, slave_service, relay_service;
+
+  /* master <-> relay_in ... relay_out <-> slave */
+  ip::tcp::acceptor
+    master_acceptor ( relay_service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) ),
+    slave_acceptor ( slave_service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) );
+  ip::tcp::socket
+    master_socket ( master_service ), relay_in ( relay_service ),
+    relay_out ( relay_service ), slave_socket ( slave_service );
+
+  /* Keep the kernel's socket buffers small, so that the backlog (if any) stays in the
+     master's outgoing queue.  */
+  master_socket.open(ip::tcp::v4());
+  master_socket.set_option(boost::asio::socket_base::send_buffer_size(1024));
+  master_socket.connect(master_acceptor.local_endpoint());
+  master_acceptor.accept(relay_in);
+  relay_in.set_option(boost::asio::socket_base::receive_buffer_size(1024));
+  relay_out.connect(slave_acceptor.local_endpoint());
+  slave_acceptor.accept(slave_socket);
+
+  std::thread
+    upstream ( [&]() { relay(relay_in, relay_out, link_bytes_per_second); } ),
+    downstream ( [&]() { relay(relay_out, relay_in, 0); } );
+
+  Node
+    slave ( std::move(slave_socket), NodeRole::SLAVE ),
+    master ( std::move(master_socket), NodeRole::MASTER );
+
+  slave.configuration.add_module( "drive", 1 )
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  master.configuration = slave.configuration;
+  master.set_queue_policy(MessageType::MODULE_CONTROL, policy);
+
+  const size_t count ( static_cast<size_t>(rate * duration) );
+  std::vector<Clock::time_point> sent_at ( count );
+  std::vector<double> latencies;
+  std::mutex latencies_mutex;
+  std::atomic<uint32_t> last_received ( 0 );
+
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       Clock::time_point now ( Clock::now() );
+       uint32_t sequence ( control.values[0].value.get<uint32_t>() );
+       std::unique_lock<std::mutex> lock ( latencies_mutex );
+       latencies.push_back(std::chrono::duration<double, std::milli>(now - sent_at[sequence]).count());
+       if ( sequence > last_received )
+         last_received = sequence;
+     });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  slave.launch();
+  master.launch();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  /* Stream control values at a fixed rate. */
+  Clock::time_point start ( Clock::now() );
+  for ( size_t i = 0; i < count; ++i )
+    {
+      std::this_thread::sleep_until(start + std::chrono::microseconds(i * 1000000 / rate));
+      ModuleControl control ( &master.configuration.modules[0] );
+      control.set<uint32_t>("sequence", i);
+      sent_at[i] = Clock::now();
+      master.send(Message(std::move(control)));
+    }
+
+  /* Wait for the final value to arrive. */
+  for ( size_t i = 0; i < 3000 && last_received + 1 < count; ++i )
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  master.halt();
+  slave.halt();
+  upstream.join();
+  downstream.join();
+
+  std::unique_lock<std::mutex> lock ( latencies_mutex );
+  std::sort(latencies.begin(), latencies.end());
+  if ( latencies.empty() )
+    latencies.push_back(0);
+
+  printf("%-14s %8zu %9zu %10zu %10.1f %10.1f %10.1f\n", label, count, latencies.size(),
+         master.get_num_coalesced(),
+         latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+int
+main(int argc, char* argv[])
+{
+  unsigned int rate ( argc > 1 ? strtoul(argv[1], NULL, 0) : 1000 );
+  double duration ( argc > 2 ? strtod(argv[2], NULL) : 3.0 );
+  size_t link ( argc > 3 ? strtoul(argv[3], NULL, 0) : 8000 );
+
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  printf("%u control messages/s for %.1f s over a %zu B/s link\n", rate, duration, link);
+  printf("%-14s %8s %9s %10s %10s %10s %10s\n",
+         "policy", "sent", "received", "coalesced", "p50 ms", "p99 ms", "max ms");
+  run("FIFO", QueuePolicy::FIFO, rate, duration, link);
+  run("LATEST_VALUE", QueuePolicy::LATEST_VALUE, rate, duration, link);
+  return 0;
+}
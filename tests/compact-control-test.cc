@@ -0,0 +1,410 @@
+/** @file
+ *
+ * Compact-control test.  Round-trips a random walk of control values through
+ * CompactControlCodec, in delta and stateless modes, checking that each expands to exactly
+ * the original message and reporting the space saved; checks that malformed compact bodies
+ * are rejected, and that a decoder that may have missed a message accepts no deltas until
+ * the next keyframe.  Then connects a master and a slave node over TCP loopback with compact
+ * controls enabled, and checks that every control value arrives intact and in compact form;
+ * and writes a stream of compact controls with one corrupt frame to a slave node, checking
+ * that no control arrives with the wrong values.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/asio/write.hpp>
+#include <crisp/comms/CompactControl.hh>
+#include <crisp/comms/ModuleControl.hh>
+#include "node-pair.hh"
+
+using namespace crisp::comms;
+
+/** Add the test module to a configuration. */
+static void
+configure(Configuration& config)
+{
+  using namespace crisp::comms::keywords;
+  config.add_module( "drive", 5 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int16_t>({ "turn", { _neutral = 0, _minimum = -1000, _maximum = 1000 } })
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } })
+    .add_input<float>({ "gain", { _neutral = 1, _minimum = 0, _maximum = 10 } })
+    .add_input<uint8_t>({ "enable", { _neutral = 0, _minimum = 0, _maximum = 1 } });
+}
+
+/** Control for step `i` of a random walk: speed and turn drift, the sequence counts up, and
+    the gain and enable flag change only occasionally.  Not every input is set every time.  */
+static ModuleControl
+make_control(const Module& module, size_t i, std::mt19937& rng)
+{
+  static int speed ( 0 ), turn ( 0 );
+  static float gain ( 1 );
+  std::uniform_int_distribution<int> step ( -3, 3 );
+  speed = std::max(-127, std::min(127, speed + step(rng)));
+  turn = std::max(-1000, std::min(1000, turn + 50 * step(rng)));
+  if ( i % 50 == 0 )
+    gain = std::uniform_real_distribution<float>(0, 10)(rng);
+
+  ModuleControl control ( &module );
+  control.set<int8_t>("speed", speed);
+  if ( i % 3 )
+    control.set<int16_t>("turn", turn);
+  control.set<uint32_t>("sequence", i);
+  control.set<float>("gain", gain);
+  control.set<uint8_t>("enable", (i / 100) % 2);
+  return control;
+}
+
+/** Round-trip `count` controls through a pair of codecs. */
+static size_t
+check_codec(const Configuration& config, bool delta, size_t count)
+{
+  size_t failures ( 0 ), full_bytes ( 0 ), compact_bytes ( 0 ), num_compacted ( 0 );
+  CompactControlCodec encoder, decoder;
+  std::mt19937 rng ( 1 );
+
+  for ( size_t i ( 1 ); i <= count; ++i )
+    {
+      Message full ( make_control(config.modules[0], i, rng) ), compact, expanded;
+      full_bytes += full.get_encoded_size();
+      if ( ! encoder.compact(full, config, delta, nullptr, compact) )
+        {
+          compact_bytes += full.get_encoded_size();
+          continue;
+        }
+      ++num_compacted;
+      compact_bytes += compact.get_encoded_size();
+
+      if ( compact.header.type != MessageType::MODULE_CONTROL_COMPACT || ! compact.checksum_ok() ||
+           ! decoder.expand(compact, config, nullptr, expanded) )
+        {
+          if ( failures++ < 10 )
+            fprintf(stderr, "FAIL: %s control %zu did not expand\n", delta ? "delta" : "stateless", i);
+          continue;
+        }
+      if ( expanded.header.type != MessageType::MODULE_CONTROL || ! expanded.checksum_ok() ||
+           expanded.body->length != full.body->length ||
+           memcmp(expanded.body->data, full.body->data, full.body->length) )
+        if ( failures++ < 10 )
+          fprintf(stderr, "FAIL: %s control %zu expanded incorrectly\n", delta ? "delta" : "stateless", i);
+    }
+
+  fprintf(stderr, "%-9s %zu of %zu controls compacted; %zu bytes -> %zu bytes (%.1f%%)\n",
+          delta ? "delta:" : "stateless:", num_compacted, count, full_bytes, compact_bytes,
+          100.0 * compact_bytes / full_bytes);
+  if ( num_compacted < count / 2 || compact_bytes >= full_bytes )
+    {
+      fprintf(stderr, "FAIL: compaction saved too little\n");
+      ++failures;
+    }
+  return failures;
+}
+
+/** Check that a clear message is sent as-is, and that malformed compact bodies are
+    rejected without disturbing the decoder's state.  */
+static size_t
+check_edge_cases(const Configuration& config)
+{
+  size_t failures ( 0 );
+  CompactControlCodec encoder, decoder;
+  std::mt19937 rng ( 2 );
+
+  ModuleControl clear ( &config.modules[0] );
+  clear.clear("speed", "turn");
+  Message clear_message ( clear ), out;
+  if ( encoder.compact(clear_message, config, true, nullptr, out) )
+    {
+      fprintf(stderr, "FAIL: clear control was compacted\n");
+      ++failures;
+    }
+
+  Message full ( make_control(config.modules[0], 1, rng) ), compact;
+  if ( ! encoder.compact(full, config, true, nullptr, compact) )
+    {
+      fprintf(stderr, "FAIL: control was not compacted\n");
+      return failures + 1;
+    }
+
+  /* Truncated, over-long, and addressed to a module that doesn't exist. */
+  for ( int variant ( 0 ); variant < 3; ++variant )
+    {
+      size_t length ( compact.body->length + (variant == 1 ? 1 : 0) - (variant == 0 ? 1 : 0) );
+      Message bad ( MessageType::MODULE_CONTROL_COMPACT );
+      bad.body.reset(new crisp::util::Buffer(length));
+      memset(bad.body->data, 0, length);
+      memcpy(bad.body->data, compact.body->data, std::min(length, compact.body->length));
+      if ( variant == 2 )
+        bad.body->data[1] = 7;
+
+      if ( decoder.expand(bad, config, nullptr, out) )
+        {
+          fprintf(stderr, "FAIL: malformed compact control %d was expanded\n", variant);
+          ++failures;
+        }
+    }
+
+  Message expanded;
+  if ( ! decoder.expand(compact, config, nullptr, expanded) ||
+       memcmp(expanded.body->data, full.body->data, full.body->length) )
+    {
+      fprintf(stderr, "FAIL: decoder state was disturbed by malformed controls\n");
+      ++failures;
+    }
+  return failures;
+}
+
+/** Drop one compact control between an encoder and a decoder, reset the decoder (as a node
+    does when it resynchronizes), and check that every control it then accepts expands
+    correctly, and that it accepts them all again from the encoder's next keyframe.  */
+static size_t
+check_lost_control(const Configuration& config)
+{
+  size_t failures ( 0 ), rejected ( 0 );
+  CompactControlCodec encoder, decoder;
+  std::mt19937 rng ( 4 );
+  const size_t lost ( CompactControlCodec::KeyframeInterval + 10 );
+
+  for ( size_t i ( 1 ); i <= 3 * CompactControlCodec::KeyframeInterval; ++i )
+    {
+      Message full ( make_control(config.modules[0], i, rng) ), compact, expanded;
+      if ( ! encoder.compact(full, config, true, nullptr, compact) )
+        continue;
+      if ( i == lost )
+        {
+          decoder.reset();
+          continue;
+        }
+
+      if ( ! decoder.expand(compact, config, nullptr, expanded) )
+        {
+          ++rejected;
+          if ( i > lost + CompactControlCodec::KeyframeInterval && failures++ < 10 )
+            fprintf(stderr, "FAIL: control %zu rejected after the next keyframe\n", i);
+        }
+      else if ( expanded.body->length != full.body->length ||
+                memcmp(expanded.body->data, full.body->data, full.body->length) )
+        if ( failures++ < 10 )
+          fprintf(stderr, "FAIL: control %zu expanded incorrectly after a lost control\n", i);
+    }
+
+  fprintf(stderr, "lost:     %zu controls rejected after a lost control\n", rejected);
+  if ( ! rejected || rejected >= CompactControlCodec::KeyframeInterval )
+    {
+      fprintf(stderr, "FAIL: unexpected number of rejected controls\n");
+      ++failures;
+    }
+  return failures;
+}
+
+/** Send `count` controls from a master to a slave node over TCP loopback, with compact
+    controls enabled, and check that the slave receives each of them intact.  */
+static size_t
+check_nodes(size_t count)
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  configure(slave.configuration);
+  master.configuration = slave.configuration;
+
+  /* Build the expected controls up front, from the same random walk the master sends. */
+  std::vector<Message> expected;
+  std::mt19937 rng ( 3 );
+  for ( size_t i ( 1 ); i <= count; ++i )
+    expected.emplace_back(make_control(master.configuration.modules[0], i, rng));
+
+  size_t failures ( 0 );
+  std::mutex mutex;
+  std::atomic<size_t> received ( 0 );
+  Waiter waiter;
+
+  slave.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       Message m ( control );
+       std::unique_lock<std::mutex> lock ( mutex );
+       size_t i ( received++ );
+       if ( i >= expected.size() || m.body->length != expected[i].body->length ||
+            memcmp(m.body->data, expected[i].body->data, m.body->length) )
+         if ( failures++ < 10 )
+           fprintf(stderr, "FAIL: control %zu received incorrectly\n", i + 1);
+       waiter.notify();
+     });
+  master.dispatcher.module_control.sent.clear();
+
+  /* Each node starts compacting before dispatching the other's handshake.  */
+  for ( Node* node : { &slave, &master } )
+    node->dispatcher.handshake.received.connect([&](Node&, const Handshake&) { waiter.notify(); });
+
+  master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+  master.request_compact_control();
+  slave.request_compact_control();
+
+  nodes.launch();
+
+  if ( ! waiter.wait([&]() { return master.compact_control_active() && slave.compact_control_active(); }) )
+    {
+      fprintf(stderr, "FAIL: compact controls not negotiated\n");
+      ++failures;
+    }
+
+  for ( const Message& m : expected )
+    master.send(m);
+  waiter.wait([&]() { return received >= count; });
+  nodes.halt();
+
+  NodeMetrics::Snapshot metrics ( slave.get_metrics() );
+  const NodeMetrics::Counts&
+    compact ( metrics.incoming[static_cast<size_t>(MessageType::MODULE_CONTROL_COMPACT)] ),
+    full ( metrics.incoming[static_cast<size_t>(MessageType::MODULE_CONTROL)] );
+  fprintf(stderr, "nodes:    slave received %zu of %zu controls; %" PRIu64 " compact (%" PRIu64 " bytes), "
+          "%" PRIu64 " full (%" PRIu64 " bytes)\n",
+          received.load(), count, compact.messages, compact.bytes, full.messages, full.bytes);
+  if ( received != count || compact.messages + full.messages != count || compact.messages < count / 2 ||
+       metrics.decode_errors )
+    {
+      fprintf(stderr, "FAIL: unexpected metrics:\n");
+      metrics.print(stderr, "    ");
+      ++failures;
+    }
+  return failures;
+}
+
+/** Append a message's wire form to a stream. */
+static void
+append(std::string& stream, const Message& m)
+{
+  Message::Segment segments[Message::MaxSegments];
+  size_t n ( m.get_segments(segments) );
+  for ( size_t i ( 0 ); i < n; ++i )
+    stream.append(static_cast<const char*>(segments[i].data), segments[i].length);
+}
+
+/** Write `count` controls to a slave node over TCP loopback in delta-compacted form, as a
+    master would, but with one compact frame corrupted (and followed by a SYNC message), and
+    check that the slave receives no control with the wrong values and resumes delivery by
+    the end of the stream.  */
+static size_t
+check_corrupt_stream(size_t count)
+{
+  namespace ip = boost::asio::ip;
+  boost::asio::io_service service;
+  ip::tcp::acceptor acceptor ( service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) );
+  ip::tcp::socket writer ( service ), slave_socket ( service );
+  writer.connect(acceptor.local_endpoint());
+  acceptor.accept(slave_socket);
+
+  Node slave ( std::move(slave_socket), NodeRole::SLAVE );
+  configure(slave.configuration);
+  slave.request_compact_control();
+  slave.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  slave.dispatcher.handshake.sent.clear();
+
+  /* Build the stream, corrupting a compact frame half-way through.  */
+  CompactControlCodec encoder;
+  std::vector<Message> expected;
+  std::string stream;
+  std::mt19937 rng ( 5 );
+  bool corrupted ( false );
+  for ( size_t i ( 1 ); i <= count; ++i )
+    {
+      Message full ( make_control(slave.configuration.modules[0], i, rng) ), compact;
+      bool compacted ( encoder.compact(full, slave.configuration, true, nullptr, compact) );
+      if ( compacted && ! corrupted && i >= count / 2 )
+        {
+          std::string bad;
+          append(bad, compact);
+          bad.back() ^= 0x5A;
+          stream += bad;
+          append(stream, Message(MessageType::SYNC));
+          corrupted = true;
+          continue;
+        }
+      append(stream, compacted ? compact : full);
+      expected.push_back(std::move(full));
+    }
+
+  size_t failures ( 0 ), next ( 0 );
+  std::atomic<size_t> received ( 0 );
+  std::atomic<bool> done ( false );
+  Waiter waiter;
+
+  /* Controls arrive in order, so each must match a later expected one.  */
+  slave.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       Message m ( control );
+       size_t j ( next );
+       while ( j < expected.size() &&
+               (m.body->length != expected[j].body->length ||
+                memcmp(m.body->data, expected[j].body->data, m.body->length)) )
+         ++j;
+       if ( j == expected.size() )
+         {
+           if ( failures++ < 10 )
+             fprintf(stderr, "FAIL: control received with the wrong values after a corrupt frame\n");
+         }
+       else
+         next = j + 1;
+       ++received;
+       done = j + 1 == expected.size();
+       waiter.notify();
+     });
+
+  slave.launch();
+  boost::asio::write(writer, boost::asio::buffer(stream));
+  waiter.wait([&]() { return done.load(); });
+  slave.halt();
+
+  NodeMetrics::Snapshot metrics ( slave.get_metrics() );
+  fprintf(stderr, "corrupt:  slave received %zu of %zu controls; %" PRIu64 " resync(s), %" PRIu64
+          " delta(s) rejected\n", received.load(), expected.size(), metrics.resyncs,
+          metrics.decode_errors);
+  if ( ! corrupted || ! done || metrics.resyncs != 1 ||
+       received + metrics.decode_errors != expected.size() ||
+       metrics.decode_errors >= CompactControlCodec::KeyframeInterval )
+    {
+      fprintf(stderr, "FAIL: corrupt compact frame mishandled\n");
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 2000 );
+
+  Configuration config;
+  configure(config);
+
+  size_t failures ( 0 );
+  failures += check_codec(config, true, count);
+  failures += check_codec(config, false, count);
+  failures += check_edge_cases(config);
+  failures += check_lost_control(config);
+  failures += check_nodes(count);
+  failures += check_corrupt_stream(count);
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Compact controls OK.\n");
+  return 0;
+}
@@ -0,0 +1,152 @@
+/** @file
+ *
+ * Configuration-cache test.  Connects a master node to a slave node over TCP loopback twice,
+ * with the master keeping an on-disk configuration cache in a temporary directory.  The first
+ * time, the master should query the slave for its configuration and cache it; the second,
+ * it should load the cached copy (keyed by the digest in the slave's handshake) without
+ * querying.  Finally, checks that a changed configuration has a different digest, and that a
+ * cache file whose contents don't match its name is ignored.
+ */
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "node-pair.hh"
+
+using namespace crisp::comms;
+
+static void
+configure(Configuration& config)
+{
+  using namespace crisp::comms::keywords;
+  config.add_module( "drive", 2, 1 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_sensor<uint16_t>({ "front proximity", SensorType::PROXIMITY, { _minimum = 50, _maximum = 500 } });
+  config.add_module( "arm", 2 )
+    .add_input<float>({ "joint0", { _minimum = -1.5, _maximum = 1.5 } })
+    .add_input<float>({ "joint1", { _minimum = -1.5, _maximum = 1.5 } });
+}
+
+/** Connect a master to a slave, have the master fetch the slave's configuration, and report
+ * whether it arrived and whether the slave was queried for it.
+ *
+ * @return Number of failures.
+ */
+static size_t
+connect(const std::string& cache_dir, bool expect_query, uint64_t& digest)
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  configure(slave.configuration);
+  digest = slave.dispatcher.configuration_cache.get_digest(slave.configuration);
+
+  std::atomic<bool> configured ( false );
+  Waiter waiter;
+  master.dispatcher.configuration_response.received.clear();
+  master.dispatcher.configuration_response.received.connect
+    ([&](Node& node, const Configuration& config)
+     {
+       node.configuration = config;
+       configured = true;
+       waiter.notify();
+     });
+
+  master.use_configuration_cache(cache_dir);
+  nodes.launch();
+  master.request_configuration();
+
+  waiter.wait([&]() { return configured.load(); });
+
+  /* The master stores the configuration in a task it posts from the receive loop, which may
+     still be running on another worker thread.  */
+  std::string path ( ConfigurationDiskCache(cache_dir).path_for(digest) );
+  for ( size_t i ( 0 ); i < 500 && access(path.c_str(), R_OK) != 0; ++i )
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  nodes.halt();
+
+  size_t failures ( 0 );
+  uint64_t queries ( slave.get_metrics().incoming[static_cast<size_t>(MessageType::CONFIGURATION_QUERY)].messages );
+  fprintf(stderr, "configuration %016" PRIx64 " %s; slave queried %llu time(s)\n", digest,
+          configured ? "received" : "NOT received", static_cast<unsigned long long>(queries));
+
+  if ( ! configured || ! (master.configuration == slave.configuration) )
+    {
+      fprintf(stderr, "FAIL: master did not get the slave's configuration\n");
+      ++failures;
+    }
+  if ( queries != (expect_query ? 1 : 0) )
+    {
+      fprintf(stderr, "FAIL: expected %s query\n", expect_query ? "one" : "no");
+      ++failures;
+    }
+  if ( access(path.c_str(), R_OK) != 0 )
+    {
+      fprintf(stderr, "FAIL: configuration not cached at %s\n", path.c_str());
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  char dir_template[] = "/tmp/crisp-config-cache-XXXXXX";
+  if ( ! mkdtemp(dir_template) )
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  std::string cache_dir ( std::string(dir_template) + "/cache" );
+
+  uint64_t first_digest, second_digest;
+  size_t failures ( 0 );
+  failures += connect(cache_dir, true, first_digest);
+  failures += connect(cache_dir, false, second_digest);
+  if ( first_digest != second_digest )
+    {
+      fprintf(stderr, "FAIL: digest of an identical configuration changed\n");
+      ++failures;
+    }
+
+  /* A changed configuration must not match the cached copy. */
+  Configuration changed;
+  configure(changed);
+  changed.modules[1].add_input<float>({ "joint2", { } });
+  ConfigurationResponseCache response;
+  if ( response.get_digest(changed) == first_digest )
+    {
+      fprintf(stderr, "FAIL: changed configuration has the same digest\n");
+      ++failures;
+    }
+
+  /* Nor may a cached file whose contents don't hash to its name be used.  */
+  ConfigurationDiskCache disk ( cache_dir );
+  Message loaded;
+  if ( ! disk.store(response.get(changed)) ||
+       rename(disk.path_for(response.get_digest(changed)).c_str(), disk.path_for(first_digest).c_str()) != 0 ||
+       disk.load(first_digest, loaded) )
+    {
+      fprintf(stderr, "FAIL: mismatched cache file was loaded\n");
+      ++failures;
+    }
+
+  unlink(disk.path_for(first_digest).c_str());
+  rmdir(cache_dir.c_str());
+  rmdir(dir_template);
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Configuration cache OK.\n");
+  return 0;
+}
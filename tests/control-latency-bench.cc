@@ -0,0 +1,213 @@
+/** @file
+ *
+ * End-to-end control-latency benchmark.  A master node sends MODULE_CONTROL messages to a
+ * slave node over TCP loopback at fixed rates, and the slave's `module_control.received`
+ * handler -- dispatched asynchronously, on the node's worker pool, as in a real deployment --
+ * timestamps each one on arrival.  For each worker-pool size and send rate, reports the
+ * one-way latency percentiles and the rate at which the handler actually ran.
+ *
+ * Paced runs use the default (latest-value) queue policy, so at rates the link or handlers
+ * can't sustain, superseded values are coalesced away and "received" falls below "sent".  A
+ * final unpaced run per pool size queues every message (FIFO), and so gives the maximum
+ * sustained rate; its latencies are dominated by queueing.
+ *
+ * Usage: control-latency-bench [--threads=N[,N...]] [--rates=HZ[,HZ...]] [--duration=SECONDS]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef std::chrono::steady_clock Clock;
+typedef BasicNode<boost::asio::ip::tcp> Node;
+namespace ip = boost::asio::ip;
+
+/** Fewest messages to send at any rate, so that the slowest rates still give a usable
+    sample. */
+static const size_t MinimumCount = 50;
+
+/** Parse a comma-separated list of numbers. */
+static std::vector<double>
+parse_list(const char* s)
+{
+  std::vector<double> out;
+  char* end;
+  for ( double v ( strtod(s, &end) ); end != s; v = strtod(s, &end) )
+    {
+      out.push_back(v);
+      s = *end == ',' ? end + 1 : end;
+    }
+  return out;
+}
+
+/** Value at the given fraction of a sorted sample. */
+static double
+percentile(const std::vector<double>& sorted, double fraction)
+{
+  if ( sorted.empty() )
+    return 0;
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * fraction))];
+}
+
+/** Connect a master and a slave node with `threads` worker threads each, send control
+ * messages at `rate` per second (or back-to-back if `rate` is zero) for `duration` seconds,
+ * and print latency statistics for the messages the slave receives.
+ */
+static void
+run(size_t threads, double rate, double duration)
+{
+  using namespace crisp::comms::keywords;
+
+  boost::asio::io_service master_service, slave_service;
+  ip::tcp::acceptor acceptor ( slave_service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) );
+  ip::tcp::socket master_socket ( master_service ), slave_socket ( slave_service );
+  master_socket.connect(acceptor.local_endpoint());
+  acceptor.accept(slave_socket);
+  master_socket.set_option(ip::tcp::no_delay(true));
+  slave_socket.set_option(ip::tcp::no_delay(true));
+
+  Node
+    slave ( std::move(slave_socket), NodeRole::SLAVE, nullptr, threads ),
+    master ( std::move(master_socket), NodeRole::MASTER, nullptr, threads );
+
+  slave.configuration.add_module( "drive", 1 )
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  master.configuration = slave.configuration;
+  if ( rate <= 0 )
+    master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+
+  /* Unpaced runs are bounded by time as well as count. */
+  size_t count ( rate > 0 ? std::max<size_t>(MinimumCount, rate * duration) : 200000 * duration );
+  std::unique_ptr<std::atomic<int64_t>[]> sent_at ( new std::atomic<int64_t>[count] );
+  std::unique_ptr<std::atomic<int64_t>[]> received_at ( new std::atomic<int64_t>[count] );
+  for ( size_t i ( 0 ); i < count; ++i )
+    received_at[i] = -1;
+  std::atomic<size_t> received ( 0 );
+
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       int64_t now ( Clock::now().time_since_epoch().count() );
+       /* Values start at one, so that they differ from the input's neutral value. */
+       uint32_t sequence ( control.values[0].value.get<uint32_t>() );
+       if ( sequence > 0 && sequence <= count )
+         received_at[sequence - 1] = now;
+       ++received;
+     });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  slave.launch();
+  master.launch();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  /* Send at the requested rate.  If we fall behind, send immediately rather than trying to
+     catch up with a burst. */
+  Clock::time_point start ( Clock::now() ), deadline ( start + std::chrono::duration_cast<Clock::duration>
+                                                        (std::chrono::duration<double>(duration)) );
+  Clock::duration period ( rate > 0
+                           ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / rate))
+                           : Clock::duration::zero() );
+  Clock::time_point next ( start );
+  size_t sent ( 0 );
+  while ( sent < count && ( rate > 0 || Clock::now() < deadline ) )
+    {
+      if ( rate > 0 )
+        {
+          std::this_thread::sleep_until(next);
+          next = std::max(next + period, Clock::now());
+        }
+
+      ModuleControl control ( &master.configuration.modules[0] );
+      control.set<uint32_t>("sequence", sent + 1);
+      sent_at[sent] = Clock::now().time_since_epoch().count();
+      master.send(std::move(control));
+      ++sent;
+    }
+
+  /* Wait for the slave to go quiet. */
+  for ( size_t last ( SIZE_MAX ); received != last; )
+    {
+      last = received;
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+  master.halt();
+  slave.halt();
+
+  std::vector<double> latencies;
+  latencies.reserve(received);
+  int64_t last_arrival ( start.time_since_epoch().count() );
+  for ( size_t i ( 0 ); i < sent; ++i )
+    if ( received_at[i] >= 0 )
+      {
+        latencies.push_back(std::chrono::duration<double, std::micro>
+                            (Clock::duration(received_at[i] - sent_at[i])).count());
+        last_arrival = std::max<int64_t>(last_arrival, received_at[i]);
+      }
+  std::sort(latencies.begin(), latencies.end());
+  std::chrono::duration<double> elapsed ( Clock::duration(last_arrival) - start.time_since_epoch() );
+
+  char rate_label[32];
+  if ( rate > 0 )
+    snprintf(rate_label, sizeof(rate_label), "%.0f", rate);
+  else
+    strcpy(rate_label, "max");
+
+  printf("%8zu %8s %10zu %10zu %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+         threads, rate_label, sent, latencies.size(), elapsed.count() > 0 ? latencies.size() / elapsed.count() : 0.0,
+         percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 0.999),
+         latencies.empty() ? 0.0 : latencies.back());
+}
+
+int
+main(int argc, char* argv[])
+{
+  std::vector<double> thread_counts { 1, 2, NODE_DEFAULT_WORKER_THREADS };
+  std::vector<double> rates { 10, 100, 1000, 10000 };
+  double duration ( 2 );
+
+  for ( int i ( 1 ); i < argc; ++i )
+    {
+      const char* arg ( argv[i] );
+      if ( ! strncmp(arg, "--threads=", 10) && ! parse_list(arg + 10).empty() )
+        thread_counts = parse_list(arg + 10);
+      else if ( ! strncmp(arg, "--rates=", 8) && ! parse_list(arg + 8).empty() )
+        rates = parse_list(arg + 8);
+      else if ( ! strncmp(arg, "--duration=", 11) && strtod(arg + 11, NULL) > 0 )
+        duration = strtod(arg + 11, NULL);
+      else
+        {
+          fprintf(stderr, "Usage: %s [--threads=N[,N...]] [--rates=HZ[,HZ...]] [--duration=SECONDS]\n",
+                  argv[0]);
+          return 2;
+        }
+    }
+
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  printf("%8s %8s %10s %10s %12s %10s %10s %10s %10s\n", "threads", "rate Hz", "sent", "received",
+         "received/s", "p50 us", "p99 us", "p99.9 us", "max us");
+  for ( double threads : thread_counts )
+    {
+      for ( double rate : rates )
+        run(threads, rate, duration);
+      run(threads, 0, duration);
+    }
+
+  return 0;
+}
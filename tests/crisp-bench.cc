@@ -0,0 +1,270 @@
+/** @file
+ *
+ * Codec micro-benchmarks.  Times encoding and decoding of each of the protocol's
+ * transcodable types, and CRC-32 over several buffer sizes, and reports the median and
+ * 99th-percentile time per operation in a human-readable table, JSON, or CSV.
+ *
+ * Each benchmark is warmed up for `--warmup-ms` milliseconds, calibrated to run in batches
+ * of at least `--batch-us` microseconds, and then timed over `--samples` batches.
+ *
+ * Usage: crisp-bench [--format=table|json|csv] [--filter=SUBSTRING] [--samples=N]
+ *                    [--warmup-ms=N] [--batch-us=N]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/Handshake.hh>
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/ModuleControl.hh>
+#include <crisp/comms/Sensor.hh>
+#include <crisp/util/BufferPool.hh>
+#include <crisp/util/checksum.hh>
+
+using namespace crisp::comms;
+typedef std::chrono::steady_clock Clock;
+
+/** Harness settings, from the command line. */
+static struct
+{
+  std::string format = "table";
+  std::string filter;
+  size_t samples = 200;
+  size_t warmup_ms = 50;
+  size_t batch_us = 20;
+} options;
+
+/** Summary of one benchmark's samples, in nanoseconds per operation. */
+struct Result
+{
+  std::string name;
+  size_t bytes;                 /**< Bytes processed per operation, or zero. */
+  size_t batch;                 /**< Operations per sample. */
+  size_t samples;
+  double median;
+  double p99;
+  double min;
+  double mean;
+};
+
+static std::vector<Result> results;
+
+/* Values computed by benchmark bodies are accumulated here so that the compiler can't
+   discard the work. */
+static volatile size_t sink;
+
+/** Time a batch of `n` calls to `fn`, returning nanoseconds per call. */
+template < typename _Fn >
+static double
+time_batch(_Fn& fn, size_t n)
+{
+  Clock::time_point start ( Clock::now() );
+  for ( size_t i ( 0 ); i < n; ++i )
+    fn();
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / n;
+}
+
+/** Run a benchmark and record its result.
+ *
+ * @param name Benchmark name, of the form "type/operation".
+ *
+ * @param bytes Bytes processed per call, used to report throughput; may be zero.
+ *
+ * @param fn Benchmark body.
+ */
+template < typename _Fn >
+static void
+run(const std::string& name, size_t bytes, _Fn fn)
+{
+  if ( ! options.filter.empty() && name.find(options.filter) == std::string::npos )
+    return;
+
+  /* Warm up caches, branch predictors and lazily-initialized state (e.g. the CRC-32 kernel
+     selection) before calibrating, so that one slow first call can't skew the batch size. */
+  Clock::time_point warmup_end ( Clock::now() + std::chrono::milliseconds(options.warmup_ms) );
+  do
+    time_batch(fn, 16);
+  while ( Clock::now() < warmup_end );
+
+  /* Calibrate: find a batch size long enough to swamp the clock's overhead. */
+  size_t batch ( 1 );
+  while ( batch < (1u << 24) && time_batch(fn, batch) * batch < options.batch_us * 1000.0 )
+    batch *= 2;
+
+  std::vector<double> samples ( options.samples );
+  for ( double& sample : samples )
+    sample = time_batch(fn, batch);
+  std::sort(samples.begin(), samples.end());
+
+  double total ( 0 );
+  for ( double sample : samples )
+    total += sample;
+
+  results.push_back({ name, bytes, batch, samples.size(), samples[samples.size() / 2],
+                      samples[std::min(samples.size() - 1, samples.size() * 99 / 100)],
+                      samples.front(), total / samples.size() });
+}
+
+/** Benchmark encoding and decoding of a transcodable object.
+ *
+ * @param name Type name to use in the benchmarks' names.
+ *
+ * @param obj Object to encode.
+ *
+ * @param args Extra arguments to `decode`.
+ */
+template < typename _T, typename... _Args >
+static void
+run_transcode(const char* name, const _T& obj, _Args&... args)
+{
+  typedef typename _T::TranscodeAsType TranscodeAsType;
+  size_t size ( obj.get_encoded_size() );
+
+  MemoryEncodeBuffer eb ( size );
+  run(std::string(name) + "/encode", size,
+      [&]() { eb.reset(); obj.encode(eb); sink += eb.offset; });
+
+  eb.reset();
+  if ( obj.encode(eb) != EncodeResult::SUCCESS )
+    {
+      fprintf(stderr, "%s: encode failed\n", name);
+      exit(1);
+    }
+
+  DecodeBuffer db ( eb.data, eb.offset );
+  run(std::string(name) + "/decode", size,
+      [&]()
+      {
+        db.offset = 0;
+        TranscodeAsType out;
+        out.decode(db, args...);
+        sink += db.offset;
+      });
+}
+
+static void
+print_results()
+{
+  if ( options.format == "json" )
+    {
+      printf("{\n  \"benchmarks\": [\n");
+      for ( size_t i ( 0 ); i < results.size(); ++i )
+        {
+          const Result& r ( results[i] );
+          printf("    { \"name\": \"%s\", \"bytes\": %zu, \"batch\": %zu, \"samples\": %zu, "
+                 "\"median_ns\": %.2f, \"p99_ns\": %.2f, \"min_ns\": %.2f, \"mean_ns\": %.2f }%s\n",
+                 r.name.c_str(), r.bytes, r.batch, r.samples, r.median, r.p99, r.min, r.mean,
+                 i + 1 < results.size() ? "," : "");
+        }
+      printf("  ]\n}\n");
+    }
+  else if ( options.format == "csv" )
+    {
+      printf("name,bytes,batch,samples,median_ns,p99_ns,min_ns,mean_ns\n");
+      for ( const Result& r : results )
+        printf("%s,%zu,%zu,%zu,%.2f,%.2f,%.2f,%.2f\n",
+               r.name.c_str(), r.bytes, r.batch, r.samples, r.median, r.p99, r.min, r.mean);
+    }
+  else
+    {
+      printf("%-28s %8s %12s %12s %12s %12s\n",
+             "benchmark", "bytes", "median ns", "p99 ns", "min ns", "MB/s");
+      for ( const Result& r : results )
+        {
+          printf("%-28s %8zu %12.1f %12.1f %12.1f", r.name.c_str(), r.bytes, r.median, r.p99, r.min);
+          if ( r.bytes )
+            printf(" %12.1f", r.bytes / r.median * 1e3);
+          printf("\n");
+        }
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+  for ( int i ( 1 ); i < argc; ++i )
+    {
+      const char* arg ( argv[i] );
+      const char* eq ( strchr(arg, '=') );
+      std::string key ( arg, eq ? eq : arg + strlen(arg) );
+      const char* value ( eq ? eq + 1 : "" );
+
+      if ( key == "--format" && ( ! strcmp(value, "table") || ! strcmp(value, "json") || ! strcmp(value, "csv") ) )
+        options.format = value;
+      else if ( key == "--filter" )
+        options.filter = value;
+      else if ( key == "--samples" && strtoul(value, NULL, 0) > 0 )
+        options.samples = strtoul(value, NULL, 0);
+      else if ( key == "--warmup-ms" )
+        options.warmup_ms = strtoul(value, NULL, 0);
+      else if ( key == "--batch-us" )
+        options.batch_us = strtoul(value, NULL, 0);
+      else
+        {
+          fprintf(stderr, "Usage: %s [--format=table|json|csv] [--filter=SUBSTRING] [--samples=N] "
+                  "[--warmup-ms=N] [--batch-us=N]\n", argv[0]);
+          return 2;
+        }
+    }
+
+  using namespace crisp::comms::keywords;
+  Configuration config;
+  config.add_module( "drive", 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } });
+  config.add_module( "arm", 2 )
+    .add_input<float>({ "joint0", { _minimum = -M_PI_2, _maximum = M_PI_2 } })
+    .add_input<float>({ "joint1", { _minimum = -M_PI_2, _maximum = M_PI_2 } });
+  config.modules[0]
+    .add_sensor<uint16_t>({ "front proximity", SensorType::PROXIMITY, { _minimum = 50, _maximum = 500 } });
+
+  ModuleControl control ( &config.modules[0] );
+  control.set<int8_t>("speed", 100);
+  control.set<int8_t>("turn", -20);
+
+  run_transcode("Configuration", config);
+  run_transcode("Module", config.modules[0]);
+  run_transcode("ModuleInput", config.modules[1].inputs[0]);
+  run_transcode("Sensor", config.modules[0].sensors[0]);
+  run_transcode("ModuleControl", control, config);
+  run_transcode("Handshake", Handshake(0, NodeRole::MASTER));
+
+  /* Messages: construction encodes the body; encoding copies it and the checksum out. */
+  {
+    run("Message/construct", 0, [&]() { Message m ( control ); sink += m.header.length; });
+
+    const Message message ( control );
+    size_t size ( message.get_encoded_size() );
+    MemoryEncodeBuffer eb ( size );
+    run("Message/encode", size, [&]() { eb.reset(); message.encode(eb); sink += eb.offset; });
+
+    DecodeBuffer db ( eb.buffer );
+    run("Message/decode", size,
+        [&]() { db.offset = 0; Message m ( Message::decode(db) ); sink += m.header.length; });
+
+    crisp::util::RefTraits<crisp::util::BufferPool>::stored_ref pool ( new crisp::util::BufferPool() );
+    run("Message/decode-pooled", size,
+        [&]() { db.offset = 0; Message m ( Message::decode(db, pool.get()) ); sink += m.header.length; });
+
+    run("Message/checksum", size,
+        [&]() { message.invalidate_checksum(); sink += message.compute_checksum(); });
+  }
+
+  /* CRC-32 with the default kernel. */
+  std::vector<unsigned char> data ( 65536 );
+  for ( size_t i ( 0 ); i < data.size(); ++i )
+    data[i] = static_cast<unsigned char>(i * 2654435761u >> 24);
+  for ( size_t size : { 16, 256, 4096, 65536 } )
+    run("crc32/" + std::to_string(size), size,
+        [&]() { sink += crisp::util::crc32(data.data(), size); });
+
+  print_results();
+  return 0;
+}
@@ -0,0 +1,255 @@
+/** @file
+ *
+ * Datagram-transport test.  Connects a master and a slave `BasicNode<udp>` over loopback
+ * through a relay that drops and reorders datagrams, then checks that the handshake and a
+ * configuration query complete over the reliable channel, and that the control values the
+ * slave receives for each of two modules never go backwards.  Message stamps are enabled, and
+ * the slave's loss and reordering counts checked against what the relay did.  Finally,
+ * restarts the slave and checks that the master handshakes with it again.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#include <boost/asio/ip/udp.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef BasicNode<boost::asio::ip::udp> Node;
+namespace ip = boost::asio::ip;
+
+/** Forward datagrams from one socket to another until told to stop, dropping some and
+    delaying others until after the next.  */
+static void
+relay(ip::udp::socket& from, ip::udp::socket& to, const std::atomic<bool>& stop, unsigned int seed,
+      double drop_probability, double reorder_probability, std::atomic<size_t>& dropped,
+      std::atomic<size_t>& reordered)
+{
+  std::mt19937 rng ( seed );
+  std::uniform_real_distribution<double> uniform ( 0, 1 );
+  char buf[65536], held[65536];
+  size_t held_length ( 0 );
+  boost::system::error_code ec;
+
+  while ( ! stop )
+    {
+      size_t n ( from.receive(boost::asio::buffer(buf), 0, ec) );
+      if ( ec == boost::asio::error::connection_refused )
+        continue;
+      if ( ec || stop )
+        break;
+
+      double r ( uniform(rng) );
+      if ( r < drop_probability )
+        {
+          ++dropped;
+          continue;
+        }
+      if ( ! held_length && r < drop_probability + reorder_probability )
+        {
+          memcpy(held, buf, n);
+          held_length = n;
+          ++reordered;
+          continue;
+        }
+
+      to.send(boost::asio::buffer(buf, n), 0, ec);
+      if ( held_length )
+        {
+          to.send(boost::asio::buffer(held, held_length), 0, ec);
+          held_length = 0;
+        }
+    }
+}
+
+/** Create a UDP socket bound to an ephemeral loopback port. */
+static ip::udp::socket
+bound_socket(boost::asio::io_service& service)
+{
+  return ip::udp::socket ( service, ip::udp::endpoint(ip::address_v4::loopback(), 0) );
+}
+
+int
+main(int argc, char* argv[])
+{
+  unsigned int seed ( argc > 1 ? strtoul(argv[1], NULL, 0) : 0x5EED );
+  double drop ( argc > 2 ? strtod(argv[2], NULL) : 0.2 );
+  double reorder ( argc > 3 ? strtod(argv[3], NULL) : 0.1 );
+
+  using namespace crisp::comms::keywords;
+  boost::asio::io_service master_service, slave_service, relay_service;
+
+  /* master <-> relay_master ... relay_slave <-> slave */
+  ip::udp::socket
+    master_socket ( bound_socket(master_service) ), relay_master ( bound_socket(relay_service) ),
+    relay_slave ( bound_socket(relay_service) ), slave_socket ( bound_socket(slave_service) );
+  master_socket.connect(relay_master.local_endpoint());
+  relay_master.connect(master_socket.local_endpoint());
+  relay_slave.connect(slave_socket.local_endpoint());
+  slave_socket.connect(relay_slave.local_endpoint());
+
+  std::atomic<bool> stop ( false );
+  std::atomic<size_t> dropped ( 0 ), reordered ( 0 );
+  std::thread
+    upstream ( [&]() { relay(relay_master, relay_slave, stop, seed, drop, reorder, dropped, reordered); } ),
+    downstream ( [&]() { relay(relay_slave, relay_master, stop, seed + 1, drop, reorder, dropped, reordered); } );
+
+  Node
+    slave ( std::move(slave_socket), NodeRole::SLAVE ),
+    master ( std::move(master_socket), NodeRole::MASTER );
+
+  slave.configuration.add_module( "drive", 1 )
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  slave.configuration.add_module( "steer", 1 )
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+
+  size_t failures ( 0 );
+  std::mutex mutex;
+  std::atomic<bool> configured ( false );
+  std::atomic<size_t> received ( 0 );
+  uint32_t last[2] { 0, 0 };
+
+  master.dispatcher.configuration_response.received.clear();
+  master.dispatcher.configuration_response.received.connect
+    ([&](Node& node, const Configuration& config)
+     {
+       node.configuration = config;
+       configured = true;
+     });
+
+  /* Asynchronous handlers may run out of order, so have them called in the order the
+     messages arrive.  */
+  slave.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       uint32_t sequence ( control.values[0].value.get<uint32_t>() );
+       std::unique_lock<std::mutex> lock ( mutex );
+       uint32_t& module_last ( last[control.module_id] );
+       if ( sequence <= module_last && failures++ < 10 )
+         fprintf(stderr, "FAIL: received control value %u for module %u after %u\n", sequence,
+                 control.module_id, module_last);
+       module_last = sequence;
+       ++received;
+     });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  /* Send every value, so that datagrams carry several at a time. */
+  master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+  master.request_message_stamps();
+  slave.request_message_stamps();
+
+  slave.launch();
+  master.launch();
+
+  /* The master needs the slave's configuration before it can build control messages. */
+  master.send(MessageType::CONFIGURATION_QUERY);
+  for ( size_t i ( 0 ); i < 500 && ! configured; ++i )
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  const size_t count ( 2000 );
+  if ( ! configured )
+    {
+      fprintf(stderr, "FAIL: configuration not received\n");
+      ++failures;
+    }
+  else
+    {
+      /* Send the control values in bursts, with every tenth one for the second module --
+         which is often alone in its datagram, and must not be dropped just because a newer
+         datagram carried controls for the first.  */
+      for ( size_t i ( 1 ); i <= count; ++i )
+        {
+          ModuleControl control ( &master.configuration.modules[i % 10 == 0 ? 1 : 0] );
+          control.set<uint32_t>("sequence", i);
+          master.send(std::move(control));
+          if ( i % 10 == 0 )
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+  /* Restart the slave on the same port, as if its process had been restarted: the master
+     must deliver the new slave's handshake although the old slave's reliable channel had got
+     further, and the new slave must accept the master's response although the master's had
+     too.  */
+  slave.halt();
+  std::atomic<bool> reconnected ( false );
+  {
+    boost::asio::io_service restarted_service;
+    ip::udp::socket restarted_socket ( restarted_service );
+    restarted_socket.open(ip::udp::v4());
+    restarted_socket.set_option(ip::udp::socket::reuse_address(true));
+    restarted_socket.bind(relay_slave.remote_endpoint());
+    restarted_socket.connect(relay_slave.local_endpoint());
+
+    Node restarted ( std::move(restarted_socket), NodeRole::SLAVE );
+    restarted.dispatcher.handshake_response.received.connect
+      ([&](Node&, const HandshakeResponse& hs)
+       { reconnected = hs.acknowledge == HandshakeAcknowledge::ACK; });
+    restarted.launch();
+    for ( size_t i ( 0 ); i < 300 && ! reconnected; ++i )
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    restarted.halt();
+  }
+  master.halt();
+  if ( ! reconnected )
+    {
+      fprintf(stderr, "FAIL: restarted slave's handshake not answered\n");
+      ++failures;
+    }
+
+  /* Shutting the relay's sockets down wakes its threads. */
+  stop = true;
+  boost::system::error_code ec;
+  relay_master.shutdown(ip::udp::socket::shutdown_both, ec);
+  relay_slave.shutdown(ip::udp::socket::shutdown_both, ec);
+  upstream.join();
+  downstream.join();
+
+  fprintf(stderr, "relay dropped %zu and reordered %zu datagrams; slave received %zu of %zu "
+          "control values (%zu dropped as stale, %zu coalesced by the sender)\n",
+          dropped.load(), reordered.load(), received.load(), count,
+          slave.get_num_stale_dropped(), master.get_num_coalesced());
+
+  if ( configured && received == 0 )
+    {
+      fprintf(stderr, "FAIL: no control values received\n");
+      ++failures;
+    }
+
+  /* The master has the slave's handshake by the time it has its configuration, so every
+     control value it sent was stamped -- and every one that reached the slave (stale or not)
+     was counted.  */
+  NodeMetrics::Snapshot metrics ( slave.get_metrics() );
+  const NodeMetrics::StampCounts& stamps ( metrics.stamps[static_cast<size_t>(MessageType::MODULE_CONTROL)] );
+  if ( configured &&
+       ( ! master.message_stamps_active() || ! slave.message_stamps_active() ||
+         stamps.received != received + slave.get_num_stale_dropped() ||
+         stamps.received + stamps.lost > count ||
+         (dropped > 0 && stamps.lost == 0) || (slave.get_num_stale_dropped() > 0 && stamps.reordered == 0) ) )
+    {
+      fprintf(stderr, "FAIL: unexpected stamp statistics:\n");
+      metrics.print(stderr, "    ");
+      ++failures;
+    }
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Datagram transport OK.\n");
+  return 0;
+}
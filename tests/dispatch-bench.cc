@@ -0,0 +1,146 @@
+/** @file
+ *
+ * Dispatch benchmark for MessageDispatcher: measures the time from `dispatch` to handler
+ * invocation, dispatch throughput, and heap allocations per message for each dispatch mode.
+ */
+#define NODE_NO_DISPATCHER_CONTROL 1
+#include <crisp/comms/MessageDispatcher.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace crisp::comms;
+typedef std::chrono::steady_clock Clock;
+
+/* Count heap allocations made anywhere in the process.  */
+static std::atomic<size_t> allocations ( 0 );
+
+void*
+operator new(size_t size)
+{
+  ++allocations;
+  void* p ( malloc(size ? size : 1) );
+  if ( ! p )
+    throw std::bad_alloc();
+  return p;
+}
+
+void
+operator delete(void* p) noexcept
+{ free(p); }
+
+void
+operator delete(void* p, size_t) noexcept
+{ free(p); }
+
+
+/** Minimal node type: just enough for MessageDispatcher. */
+struct Node
+{
+  boost::asio::io_service& io_service;
+  MessageDispatcher<Node> dispatcher;
+  Configuration configuration;
+  NodeRole role;
+
+  inline boost::asio::io_service&
+  get_io_service() { return io_service; }
+
+  Node(boost::asio::io_service& service)
+    : io_service ( service ),
+      dispatcher ( *this ),
+      configuration ( ),
+      role ( NodeRole::SLAVE )
+  {}
+
+  /* The default handlers reply to some messages; we don't need to. */
+  template < typename _T >
+  inline void
+  send(const _T&) {}
+};
+
+static void
+run(const char* label, DispatchMode mode, Node& node, const Message& message, size_t count)
+{
+  node.dispatcher.set_dispatch_mode(mode);
+
+  std::atomic<size_t> handled ( 0 );
+  std::atomic<int64_t> total ( 0 );
+  std::atomic<bool> record_latency ( true );
+  Clock::time_point dispatched_at;
+  std::vector<double> latencies;
+  latencies.reserve(count);
+
+  node.dispatcher.module_control.received.clear();
+  node.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       if ( record_latency )
+         latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - dispatched_at).count());
+       total += control.values[0].value.get<int8_t>();
+       ++handled;
+     });
+
+  /* Latency: one message in flight at a time. */
+  size_t initial_allocations ( allocations );
+  for ( size_t i ( 0 ); i < count; ++i )
+    {
+      dispatched_at = Clock::now();
+      node.dispatcher.dispatch(Message(message), MessageDirection::INCOMING);
+      while ( handled <= i )
+        std::this_thread::yield();
+    }
+  double allocations_per_message ( static_cast<double>(allocations - initial_allocations) / count );
+
+  /* Throughput: dispatch as fast as possible, then wait for the handlers to catch up. */
+  record_latency = false;
+  handled = 0;
+  Clock::time_point start ( Clock::now() );
+  for ( size_t i ( 0 ); i < count; ++i )
+    node.dispatcher.dispatch(Message(message), MessageDirection::INCOMING);
+  while ( handled < count )
+    std::this_thread::yield();
+  std::chrono::duration<double> elapsed ( Clock::now() - start );
+
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-14s %12.0f %10.2f %10.2f %10.2f %12.2f\n", label, count / elapsed.count(),
+         latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back(),
+         allocations_per_message);
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 100000 );
+
+  using namespace crisp::comms::keywords;
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  boost::asio::io_service service;
+  boost::asio::io_service::work work ( service );
+  std::thread worker ( [&]() { service.run(); } );
+
+  Node node ( service );
+  node.configuration.add_module( "drive", 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } });
+
+  ModuleControl control ( &node.configuration.modules[0] );
+  control.set<int8_t>("speed", 100);
+  control.set<int8_t>("turn", -20);
+  const Message message ( std::move(control) );
+
+  printf("%-14s %12s %10s %10s %10s %12s\n",
+         "mode", "messages/s", "p50 us", "p99 us", "max us", "allocs/msg");
+  run("ASYNCHRONOUS", DispatchMode::ASYNCHRONOUS, node, message, count);
+  run("SYNCHRONOUS", DispatchMode::SYNCHRONOUS, node, message, count);
+
+  service.stop();
+  worker.join();
+  return 0;
+}
@@ -73,5 +73,71 @@ main(int argc, char* argv[])
 
   service.run();
 
-  return 0;
+  /* Configuration responses are encoded once, and re-encoded when a new configuration is
+     installed or the cache is invalidated.  */
+  int status ( 0 );
+  node.configuration = configuration;
+  Message first ( node.dispatcher.configuration_cache.get(node.configuration) ),
+    second ( node.dispatcher.configuration_cache.get(node.configuration) );
+  if ( first.body.get() != second.body.get() || ! (first.as<Configuration>() == configuration) )
+    {
+      fprintf(stderr, "FAIL: configuration response not cached\n");
+      status = 1;
+    }
+
+  node.configuration.modules[1].add_input<float>({ "joint2", {} });
+  if ( node.dispatcher.configuration_cache.get(node.configuration).body.get() != first.body.get() )
+    {
+      fprintf(stderr, "FAIL: configuration response re-encoded on a cache hit\n");
+      status = 1;
+    }
+  node.dispatcher.configuration_cache.invalidate();
+  Message grown ( node.dispatcher.configuration_cache.get(node.configuration) );
+  if ( grown.body.get() == first.body.get() || ! (grown.as<Configuration>() == node.configuration) )
+    {
+      fprintf(stderr, "FAIL: configuration response not re-encoded after adding an input\n");
+      status = 1;
+    }
+
+  uint64_t grown_digest ( node.dispatcher.configuration_cache.get_digest(node.configuration) );
+  node.configuration.modules[1].name = "manipulator";
+  node.dispatcher.configuration_cache.invalidate();
+  Message renamed ( node.dispatcher.configuration_cache.get(node.configuration) );
+  if ( renamed.body.get() == grown.body.get() || ! (renamed.as<Configuration>() == node.configuration) ||
+       node.dispatcher.configuration_cache.get_digest(node.configuration) == grown_digest )
+    {
+      fprintf(stderr, "FAIL: configuration response not re-encoded after renaming a module\n");
+      status = 1;
+    }
+
+  node.dispatcher.configuration_cache.invalidate();
+  if ( node.dispatcher.configuration_cache.get(node.configuration).body.get() == renamed.body.get() )
+    {
+      fprintf(stderr, "FAIL: configuration response cache not invalidated\n");
+      status = 1;
+    }
+
+  /* Synchronous dispatch skips the handlers for bodies that fail to decode.  */
+  size_t controls ( 0 );
+  node.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  node.dispatcher.module_control.received.clear();
+  node.dispatcher.module_control.received.connect([&](Node&, const ModuleControl&) { ++controls; });
+
+  ModuleControl control ( &node.configuration.modules[0] );
+  control.set<int8_t>("speed", 10).set<int8_t>("turn", -10);
+  Message valid ( control ), truncated ( control ), unknown ( control );
+  truncated.body = new crisp::util::Buffer(*valid.body);
+  truncated.body->length -= 1;
+  unknown.body = new crisp::util::Buffer(*valid.body);
+  unknown.body->data[0] = 7;
+
+  if ( ! node.dispatcher.dispatch(std::move(valid), MessageDirection::INCOMING) ||
+       node.dispatcher.dispatch(std::move(truncated), MessageDirection::INCOMING) ||
+       node.dispatcher.dispatch(std::move(unknown), MessageDirection::INCOMING) || controls != 1 )
+    {
+      fprintf(stderr, "FAIL: malformed module controls dispatched synchronously\n");
+      status = 1;
+    }
+
+  return status;
 }
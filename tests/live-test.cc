@@ -3,6 +3,7 @@
  * Simple example of setting up a protocol node in either server or client mode.
  *
  */
+#include <chrono>
 #include <cstdio>
 
 
@@ -17,6 +18,7 @@ Static-protocol test program.\n\
 Options:\n\
   -s	Listen for incoming connections on the specified port and interface.\n\
 	If this flag is NOT given, client mode is assumed.\n\
+  -m MS	Print each node's traffic metrics every MS milliseconds.\n\
   -h	Show this help.\n"
 /* **************************************************************** */
 
@@ -46,15 +48,22 @@ main(int argc, char* argv[])
   } mode ( Mode::CLIENT );
 
 
+  /* Interval at which to print node metrics, or zero to not print them. */
+  std::chrono::milliseconds metrics_interval ( 0 );
+
   /* Parse user options. */
   int c;
-  while ( (c = getopt(argc, argv, "sh")) != -1 )
+  while ( (c = getopt(argc, argv, "shm:")) != -1 )
     switch ( c )
       {
       case 's':
 	mode = Mode::SERVER;
 	break;
 
+      case 'm':
+	metrics_interval = std::chrono::milliseconds(strtoul(optarg, NULL, 0));
+	break;
+
       case 'h':
 	PRINT_USAGE(stdout);
 	fputs(HELP_TEXT, stdout);
@@ -130,9 +139,10 @@ main(int argc, char* argv[])
         .add_input<float>({ "joint0", { _minimum = -M_PI_2, _maximum = M_PI_2 }})
         .add_input<float>({ "joint1", { _minimum = -M_PI_2, _maximum = M_PI_2 }});
 
-      server.on_connect([](crisp::comms::NodeServer<Node>&, Node&)
+      server.on_connect([&](crisp::comms::NodeServer<Node>&, Node& node)
                            {
                              fputs("Client connect!\n", stderr);
+                             node.dump_metrics(metrics_interval);
                            });
 
       boost::asio::signal_set ss ( service, SIGINT );
@@ -177,6 +187,7 @@ main(int argc, char* argv[])
                      });
 
           node.send(MessageType::CONFIGURATION_QUERY);
+          node.dump_metrics(metrics_interval);
 
           boost::asio::signal_set ss ( service, SIGINT );
           ss.async_wait([&](const boost::system::error_code& error, int sig)
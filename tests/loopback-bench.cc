@@ -0,0 +1,116 @@
+/** @file
+ *
+ * Loopback-link benchmark: runs a master and a slave node over an in-process LoopbackLink,
+ * and measures MODULE_CONTROL throughput and one-way latency with each of several injected
+ * link delays.  Measured latency should track the injected delay plus a small, stable
+ * overhead.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/LoopbackLink.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef std::chrono::steady_clock Clock;
+typedef BasicNode<LoopbackLink::Protocol> Node;
+
+static void
+run(std::chrono::microseconds delay, size_t count, size_t latency_count)
+{
+  using namespace crisp::comms::keywords;
+
+  boost::asio::io_service master_service, slave_service;
+  LoopbackLink link ( master_service, slave_service, delay );
+
+  Node
+    slave ( std::move(link.second), NodeRole::SLAVE ),
+    master ( std::move(link.first), NodeRole::MASTER );
+
+  slave.configuration.add_module( "drive", 1 )
+    .add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  master.configuration = slave.configuration;
+  master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+
+  std::atomic<size_t> received ( 0 );
+  std::atomic<int64_t> sent_at ( 0 );
+  std::vector<double> latencies;
+  latencies.reserve(latency_count);
+  std::atomic<bool> record_latency ( false );
+
+  slave.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl&)
+     {
+       if ( record_latency )
+         latencies.push_back(std::chrono::duration<double, std::micro>
+                             (Clock::now().time_since_epoch() - Clock::duration(sent_at.load())).count());
+       ++received;
+     });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  slave.launch();
+  master.launch();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200) + 2 * delay);
+
+  ModuleControl control ( &master.configuration.modules[0] );
+  control.set<uint32_t>("sequence", 1);
+  const Message message ( std::move(control) );
+
+  /* Throughput, including the time for the last message to cross the link. */
+  Clock::time_point start ( Clock::now() );
+  for ( size_t i ( 0 ); i < count; ++i )
+    master.send(message);
+  while ( received < count )
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  std::chrono::duration<double> elapsed ( Clock::now() - start );
+
+  /* Latency: one message in flight at a time. */
+  received = 0;
+  record_latency = true;
+  for ( size_t i ( 0 ); i < latency_count; ++i )
+    {
+      sent_at = Clock::now().time_since_epoch().count();
+      master.send(message);
+      while ( received <= i )
+        std::this_thread::yield();
+    }
+  record_latency = false;
+
+  master.halt();
+  slave.halt();
+  link.halt();
+
+  std::sort(latencies.begin(), latencies.end());
+  double p50 ( latencies[latencies.size() / 2] );
+  printf("%10lld %12.0f %10.1f %10.1f %10.1f %10.1f\n",
+         static_cast<long long>(delay.count()), count / elapsed.count(), p50,
+         latencies[latencies.size() * 99 / 100], latencies.back(), p50 - delay.count());
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 100000 );
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  printf("%10s %12s %10s %10s %10s %10s\n",
+         "delay us", "messages/s", "p50 us", "p99 us", "max us", "overhead");
+  for ( long delay : { 0, 100, 1000, 5000 } )
+    run(std::chrono::microseconds(delay), count,
+        /* Keep the serial latency runs short with long delays. */
+        delay ? std::min<size_t>(count, 2000000 / (delay + 1000)) : std::min<size_t>(count, 20000));
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+/** @file
+ *
+ * Message-checksum benchmark.  Compares the old gather-copy-then-checksum approach with the
+ * streaming `Message::compute_checksum` (cold and cached) for CONFIGURATION_RESPONSE- and
+ * MODULE_CONTROL-sized messages.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/Message.hh>
+#include <crisp/comms/Module.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+
+/* What `Message::compute_checksum` used to do: copy the header and body into a temporary
+   buffer, then run the bytewise CRC over it.  */
+static uint32_t
+legacy_checksum(const Message& m)
+{
+  size_t bufsize ( sizeof(Message::Header) + m.body->length );
+  char buf[bufsize];
+  memcpy(buf, &m.header, sizeof(Message::Header));
+  memcpy(buf + sizeof(Message::Header), m.body->data, m.body->length);
+  using namespace crisp::util;
+  return crc32_finish(crc32_update(CRC32Kernel::BYTEWISE, crc32_begin(), buf, bufsize));
+}
+
+template < typename _Function >
+static double
+measure(size_t iterations, size_t bytes_per_iteration, _Function fn)
+{
+  uint32_t sink ( 0 );
+  for ( size_t i = 0; i < iterations / 16 + 1; ++i )
+    sink ^= fn();
+
+  std::chrono::steady_clock::time_point start ( std::chrono::steady_clock::now() );
+  for ( size_t i = 0; i < iterations; ++i )
+    sink ^= fn();
+  std::chrono::duration<double> elapsed ( std::chrono::steady_clock::now() - start );
+
+  volatile uint32_t v ( sink );
+  (void) v;
+  return iterations * bytes_per_iteration / elapsed.count();
+}
+
+static void
+run(const char* label, const Message& m, size_t iterations)
+{
+  size_t bytes ( sizeof(Message::Header) + m.body->length );
+
+  double legacy ( measure(iterations, bytes, [&]() { return legacy_checksum(m); }) );
+  double streaming ( measure(iterations, bytes, [&]() { m.invalidate_checksum(); return m.compute_checksum(); }) );
+  /* `checksum_ok` followed by an encode used to checksum the message twice. */
+  double cached ( measure(iterations, bytes, [&]() { return static_cast<uint32_t>(m.checksum_ok()) ^ m.compute_checksum(); }) );
+
+  printf("%-24s %8zu %14.1f %14.1f %14.1f\n", label, bytes, legacy / 1e6, streaming / 1e6, cached / 1e6);
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t iterations ( argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000 );
+  using namespace crisp::comms::keywords;
+
+  Configuration config;
+  config.add_module( "drive", 2, 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_sensor<uint16_t>({ "front proximity", SensorType::PROXIMITY, { _minimum = 50, _maximum = 500 } })
+    .add_sensor<uint16_t>({ "rear proximity", SensorType::PROXIMITY, { _minimum = 50, _maximum = 500 } });
+  config.add_module( "arm", 3 )
+    .add_input<float>({ "rotation", { _minimum = -M_PI_2, _maximum = M_PI_2 }})
+    .add_input<float>({ "joint0", { _minimum = -M_PI_2, _maximum = M_PI_2 }})
+    .add_input<float>({ "joint1", { _minimum = -M_PI_2, _maximum = M_PI_2 }});
+
+  ModuleControl control ( &config.modules[0] );
+  control.set<int8_t>("speed", 100);
+  control.set<int8_t>("turn", -20);
+
+  Message
+    configuration_message ( config ),
+    control_message ( std::move(control) );
+
+  printf("%-24s %8s %14s %14s %14s\n", "message", "bytes", "legacy MB/s", "stream MB/s", "cached MB/s");
+  run("CONFIGURATION_RESPONSE", configuration_message, iterations / 10);
+  run("MODULE_CONTROL", control_message, iterations);
+  return 0;
+}
@@ -0,0 +1,71 @@
+/** @file
+ *
+ * Stress test for MPSCQueue: several producer threads push numbered items while a single
+ * consumer pops them, checking that nothing is lost or duplicated and that each producer's
+ * items come out in the order they were pushed.  The queue preallocates fewer nodes than the
+ * backlog usually reaches, so both pooled and heap-allocated nodes are used.
+ */
+#include <crisp/util/MPSCQueue.hh>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using crisp::util::MPSCQueue;
+
+int
+main(int argc, char* argv[])
+{
+  size_t
+    num_producers ( argc > 1 ? strtoul(argv[1], NULL, 0) : 4 ),
+    per_producer ( argc > 2 ? strtoul(argv[2], NULL, 0) : 1000000 );
+
+  /* Items are (producer, sequence number) pairs. */
+  typedef std::pair<size_t, size_t> Item;
+  MPSCQueue<Item> queue ( 256 );
+
+  std::vector<std::thread> producers;
+  for ( size_t p ( 0 ); p < num_producers; ++p )
+    producers.emplace_back([&queue, p, per_producer]()
+                           {
+                             for ( size_t i ( 0 ); i < per_producer; ++i )
+                               queue.emplace(p, i);
+                           });
+
+  std::vector<size_t> next ( num_producers, 0 );
+  size_t received ( 0 ), failures ( 0 );
+  Item item;
+  while ( received < num_producers * per_producer )
+    if ( queue.try_pop(item) )
+      {
+        if ( item.first >= num_producers || item.second != next[item.first] )
+          {
+            if ( failures++ < 10 )
+              fprintf(stderr, "FAIL: got item %zu from producer %zu; expected item %zu\n",
+                      item.second, item.first, item.first < num_producers ? next[item.first] : 0);
+          }
+        else
+          ++next[item.first];
+        ++received;
+      }
+
+  for ( std::thread& t : producers )
+    t.join();
+
+  if ( queue.try_pop(item) || ! queue.empty() )
+    {
+      fprintf(stderr, "FAIL: queue not empty after all items were received\n");
+      ++failures;
+    }
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "All %zu items received in order.\n", received);
+  return 0;
+}
@@ -0,0 +1,169 @@
+/** @file
+ *
+ * Name-index test.  Checks that modules, inputs and sensors are found by name before and after
+ * a configuration's name index is built, that handles still resolve once the configuration has
+ * been encoded and decoded or grown, and compares the cost of indexed and linear lookups.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/Message.hh>
+
+using namespace crisp::comms;
+
+static const size_t NumModules ( 32 ), NumInputs ( 15 ), NumSensors ( 40 );
+
+/** Names for the configuration's items; configurations built by hand reference them rather
+    than copying them.  */
+static std::vector<std::string> module_names, input_names, sensor_names;
+
+static void
+configure(Configuration& config)
+{
+  using namespace crisp::comms::keywords;
+  for ( size_t i ( 0 ); i < NumModules; ++i )
+    module_names.push_back("module " + std::to_string(i));
+  for ( size_t i ( 0 ); i < NumInputs; ++i )
+    input_names.push_back("input " + std::to_string(i));
+  for ( size_t i ( 0 ); i < NumSensors; ++i )
+    sensor_names.push_back("sensor " + std::to_string(i));
+
+  for ( size_t m ( 0 ); m < NumModules; ++m )
+    {
+      Module& module ( config.add_module( module_names[m].c_str(), NumInputs, NumSensors ) );
+      for ( size_t i ( 0 ); i < NumInputs; ++i )
+        module.add_input<int16_t>({ input_names[i].c_str(), { _neutral = 0, _minimum = -100, _maximum = 100 } });
+      for ( size_t s ( 0 ); s < NumSensors; ++s )
+        module.add_sensor<uint16_t>({ sensor_names[s].c_str(), SensorType::PROXIMITY, { } });
+    }
+}
+
+/** Check every lookup against the configuration's layout. */
+static size_t
+check_lookups(const Configuration& config, const char* what)
+{
+  size_t failures ( 0 );
+  for ( size_t m ( 0 ); m < NumModules; ++m )
+    {
+      const char* module_name ( module_names[m].c_str() );
+      NameHandle module ( config.find_module(module_name) );
+      if ( ! module || config.get_module(module) != &config.modules[m] )
+        ++failures;
+      for ( size_t i ( 0 ); i < NumInputs; ++i )
+        {
+          NameHandle input ( config.find_input(module_name, input_names[i].c_str()) );
+          if ( ! input || config.get_input(input) != &config.modules[m].inputs[i] || config.get_sensor(input) )
+            ++failures;
+        }
+      for ( size_t s ( 0 ); s < NumSensors; ++s )
+        {
+          NameHandle sensor ( config.find_sensor(module_name, sensor_names[s].c_str()) );
+          if ( ! sensor || config.get_sensor(sensor) != &config.modules[m].sensors[s] || config.get_input(sensor) )
+            ++failures;
+        }
+    }
+
+  if ( config.find_module("module") || config.find_module("module 1000") ||
+       config.find_input("module 1", "sensor 1") || config.find_sensor("module 1", "input 1") ||
+       config.find_input("module", "input 1") || config.find_sensor("module 1", "sensor 400") )
+    ++failures;
+
+  if ( failures )
+    fprintf(stderr, "FAIL: %zu wrong lookups %s\n", failures, what);
+  return failures;
+}
+
+/** Time resolving every input of every module by name. */
+static double
+time_lookups(const Configuration& config, size_t rounds)
+{
+  auto start ( std::chrono::steady_clock::now() );
+  size_t found ( 0 );
+  for ( size_t r ( 0 ); r < rounds; ++r )
+    for ( size_t m ( 0 ); m < NumModules; ++m )
+      for ( size_t i ( 0 ); i < NumInputs; ++i )
+        found += static_cast<bool>(config.find_input(module_names[m].c_str(), input_names[i].c_str()));
+  std::chrono::duration<double, std::nano> elapsed ( std::chrono::steady_clock::now() - start );
+  return found == rounds * NumModules * NumInputs ? elapsed.count() / found : -1;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t failures ( 0 );
+  Configuration config;
+  configure(config);
+
+  /* Before the index is built, lookups search linearly.  */
+  failures += check_lookups(config, "without an index");
+  double linear ( time_lookups(config, 20) );
+
+  config.build_index();
+  failures += check_lookups(config, "with an index");
+  double indexed ( time_lookups(config, 20) );
+  fprintf(stderr, "lookup:   %.0f ns linear, %.0f ns indexed (%zu slots)\n",
+          linear, indexed, config.name_index.size);
+
+  /* Handles found on one copy resolve on another, decoded from it.  */
+  NameHandle input ( config.find_input("module 7", "input 3") ), sensor ( config.find_sensor("module 31", "sensor 39") );
+  Message m ( config );
+  Configuration decoded ( m.as<Configuration>() );
+  failures += check_lookups(decoded, "after decoding");
+  const ModuleInput<>* decoded_input ( decoded.get_input(input) );
+  const Sensor<>* decoded_sensor ( decoded.get_sensor(sensor) );
+  if ( ! decoded_input || *decoded_input != config.modules[7].inputs[3] ||
+       ! decoded_sensor || *decoded_sensor != config.modules[31].sensors[39] )
+    {
+      fprintf(stderr, "FAIL: handles do not resolve on the decoded configuration\n");
+      ++failures;
+    }
+
+  /* Adding a module drops the index; lookups still see every module.  */
+  Configuration copy ( decoded );
+  copy.add_module( "extra" );
+  if ( copy.name_index.size != 0 || ! copy.find_module("extra") || ! copy.find_sensor("module 3", "sensor 3") )
+    {
+      fprintf(stderr, "FAIL: lookups wrong after adding a module\n");
+      ++failures;
+    }
+
+  /* Inputs and sensors added after the index was built are still found.  */
+  {
+    using namespace crisp::comms::keywords;
+    Configuration grown;
+    Module& module ( grown.add_module( "grown", 2, 1 ) );
+    module.add_input<int16_t>({ "before", { _neutral = 0, _minimum = -100, _maximum = 100 } });
+    grown.build_index();
+    module.add_input<int16_t>({ "after", { _neutral = 0, _minimum = -100, _maximum = 100 } });
+    module.add_sensor<uint16_t>({ "late", SensorType::PROXIMITY, { } });
+    if ( grown.get_input(grown.find_input("grown", "after")) != &module.inputs[1] ||
+         grown.get_sensor(grown.find_sensor("grown", "late")) != &module.sensors[0] ||
+         ! grown.find_input("grown", "before") || grown.find_input("grown", "late") )
+      {
+        fprintf(stderr, "FAIL: lookups wrong after adding to an indexed module\n");
+        ++failures;
+      }
+
+    /* Rebuilding the index makes it cover them again.  */
+    grown.build_index();
+    if ( grown.indexed_items != 4 || ! grown.find_input("grown", "after") ||
+         ! grown.find_sensor("grown", "late") || grown.find_input("grown", "missing") )
+      {
+        fprintf(stderr, "FAIL: lookups wrong after rebuilding the index\n");
+        ++failures;
+      }
+  }
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Name index OK.\n");
+  return 0;
+}
@@ -0,0 +1,116 @@
+/** @file
+ *
+ * Scaffolding shared by the tests that run a master and a slave node against each other over
+ * TCP loopback.
+ */
+#ifndef crisp_tests_node_pair_hh
+#define crisp_tests_node_pair_hh 1
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <crisp/comms/BasicNode.hh>
+
+typedef crisp::comms::BasicNode<boost::asio::ip::tcp> Node;
+
+/** Lets the test thread wait for a condition that handlers (or other threads) make true.
+ * Whatever changes the state the condition reads must call `notify` afterwards.
+ */
+class Waiter
+{
+public:
+  /** Wake any waiting thread to re-check its condition. */
+  void
+  notify()
+  {
+    std::unique_lock<std::mutex> lock ( m_mutex );
+    m_condition.notify_all();
+  }
+
+  /** Wait until a condition holds.
+   *
+   * @param predicate Function returning `true` once the condition holds.
+   *
+   * @param timeout Longest time to wait.
+   *
+   * @return The predicate's final value.
+   */
+  template < typename _Predicate >
+  bool
+  wait(_Predicate predicate, std::chrono::milliseconds timeout = std::chrono::seconds(5))
+  {
+    std::unique_lock<std::mutex> lock ( m_mutex );
+    return m_condition.wait_for(lock, timeout, predicate);
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+};
+
+/** A slave and a master node, connected over TCP loopback but not yet launched.  The default
+    SYNC handlers' output is silenced on both.  */
+class NodePair
+{
+  /** Connected socket pair; built before, and moved into, the nodes. */
+  struct Sockets
+  {
+    Sockets(boost::asio::io_service& master_service, boost::asio::io_service& slave_service)
+      : master ( master_service ),
+        slave ( slave_service )
+    {
+      using namespace boost::asio::ip;
+      tcp::acceptor acceptor ( slave_service, tcp::endpoint(address_v4::loopback(), 0) );
+      master.connect(acceptor.local_endpoint());
+      acceptor.accept(slave);
+    }
+
+    boost::asio::ip::tcp::socket master, slave;
+  };
+
+  boost::asio::io_service m_master_service, m_slave_service;
+  Sockets m_sockets;
+
+public:
+  /** Constructor.
+   *
+   * @param master_threads Number of worker threads for the master node.
+   */
+  NodePair(size_t master_threads = NODE_DEFAULT_WORKER_THREADS)
+    : m_master_service ( ),
+      m_slave_service ( ),
+      m_sockets ( m_master_service, m_slave_service ),
+      slave ( std::move(m_sockets.slave), crisp::comms::NodeRole::SLAVE ),
+      master ( std::move(m_sockets.master), crisp::comms::NodeRole::MASTER, nullptr, master_threads )
+  {
+    for ( Node* node : { &slave, &master } )
+      {
+        node->dispatcher.sync.received.clear();
+        node->dispatcher.sync.sent.clear();
+      }
+  }
+
+  /** Launch both nodes, slave first. */
+  void
+  launch()
+  {
+    slave.launch();
+    master.launch();
+  }
+
+  /** Halt both nodes, master first. */
+  void
+  halt()
+  {
+    master.halt();
+    slave.halt();
+  }
+
+  Node slave;
+  Node master;
+};
+
+#endif	/* crisp_tests_node_pair_hh */
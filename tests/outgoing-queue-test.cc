@@ -0,0 +1,166 @@
+/** @file
+ *
+ * Outgoing-queue test.  Checks that latest-value coalescing keeps working for any number of
+ * distinct keys over the life of a queue, that concurrent producers never lose the latest
+ * message for a key or deliver a key's messages out of order, and that they leave every
+ * coalescing slot released.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <crisp/comms/Configuration.hh>
+#include <crisp/comms/ModuleControl.hh>
+#include <crisp/comms/OutgoingQueue.hh>
+
+using namespace crisp::comms;
+
+static const size_t NumFlags ( 8 );
+static const char* flag_names[NumFlags] = { "f0", "f1", "f2", "f3", "f4", "f5", "f6", "f7" };
+
+/** Module with a sequence input, and flag inputs used to give messages distinct keys. */
+static void
+configure(Configuration& config)
+{
+  using namespace crisp::comms::keywords;
+  Module& module ( config.add_module( "test", 1 + NumFlags ) );
+  module.add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  for ( const char* name : flag_names )
+    module.add_input<uint8_t>({ name, { _neutral = 0, _minimum = 0, _maximum = 1 } });
+}
+
+/** Control setting the sequence input and the flags in @p flags, which select its key. */
+static Message
+make_control(const Configuration& config, uint8_t flags, uint32_t sequence)
+{
+  ModuleControl control ( &config.modules[0] );
+  control.set<uint32_t>("sequence", sequence);
+  for ( size_t i ( 0 ); i < NumFlags; ++i )
+    if ( flags & (1 << i) )
+      control.set<uint8_t>(flag_names[i], 1);
+  return Message(control);
+}
+
+static size_t
+check_many_keys(const Configuration& config, OutgoingQueue& queue)
+{
+  size_t failures ( 0 ), keys ( 4 * OUTGOING_QUEUE_COALESCING_SLOTS );
+  size_t coalesced ( queue.get_num_coalesced() );
+
+  /* Far more keys than slots, but never more than one pending at once.  */
+  for ( size_t k ( 0 ); k < keys; ++k )
+    {
+      queue.push(make_control(config, k % 256, 2 * k));
+      queue.push(make_control(config, k % 256, 2 * k + 1));
+
+      Message m;
+      if ( ! queue.try_pop(m) || m.as<ModuleControl>(config).get<uint32_t>("sequence") != 2 * k + 1 ||
+           queue.try_pop(m) )
+        {
+          if ( failures++ < 5 )
+            fprintf(stderr, "FAIL: messages for key %zu not coalesced\n", k);
+        }
+    }
+
+  coalesced = queue.get_num_coalesced() - coalesced;
+  fprintf(stderr, "keys:     %zu keys, %zu messages coalesced\n", keys, coalesced);
+  if ( coalesced != keys || queue.size() != 0 )
+    {
+      fprintf(stderr, "FAIL: coalescing stopped after %zu keys\n", coalesced);
+      ++failures;
+    }
+  return failures;
+}
+
+static size_t
+check_concurrent(const Configuration& config, OutgoingQueue& queue, size_t per_producer)
+{
+  static const size_t NumProducers ( 4 ), KeysPerProducer ( 4 );
+  std::atomic<size_t> done ( 0 );
+
+  /* Producer `p` uses flag bit `p` with each of the lowest flag bits for its keys.  */
+  std::vector<Message> messages[NumProducers];
+  for ( size_t p ( 0 ); p < NumProducers; ++p )
+    for ( size_t i ( 0 ); i < per_producer; ++i )
+      messages[p].push_back(make_control(config, (1 << (NumFlags - 1 - p)) | (i % KeysPerProducer), i));
+
+  std::vector<std::thread> producers;
+  for ( size_t p ( 0 ); p < NumProducers; ++p )
+    producers.emplace_back([&, p]()
+                           {
+                             for ( Message& m : messages[p] )
+                               queue.push(std::move(m));
+                             ++done;
+                           });
+
+  size_t failures ( 0 ), popped ( 0 );
+  std::vector<int64_t> last ( 256, -1 );
+  Message m;
+  while ( done < NumProducers || queue.size() > 0 )
+    if ( queue.try_pop(m) )
+      {
+        ModuleControl control ( m.as<ModuleControl>(config) );
+        uint8_t flags ( control.input_ids >> 1 );
+        int64_t sequence ( control.get<uint32_t>("sequence") );
+        if ( sequence <= last[flags] && failures++ < 5 )
+          fprintf(stderr, "FAIL: key %02x delivered %lld after %lld\n", flags,
+                  static_cast<long long>(sequence), static_cast<long long>(last[flags]));
+        last[flags] = sequence;
+        ++popped;
+      }
+
+  for ( std::thread& t : producers )
+    t.join();
+
+  /* The last message for each key is never coalesced away.  */
+  for ( size_t p ( 0 ); p < NumProducers; ++p )
+    for ( size_t k ( 0 ); k < KeysPerProducer; ++k )
+      if ( last[(1 << (NumFlags - 1 - p)) | k] != static_cast<int64_t>(per_producer - KeysPerProducer + k) )
+        {
+          fprintf(stderr, "FAIL: latest message for producer %zu key %zu lost\n", p, k);
+          ++failures;
+        }
+
+  size_t coalesced ( queue.get_num_coalesced() );
+  fprintf(stderr, "threads:  %zu pushed, %zu popped, %zu coalesced\n",
+          NumProducers * per_producer, popped, coalesced);
+  if ( popped + coalesced != NumProducers * per_producer )
+    {
+      fprintf(stderr, "FAIL: messages lost\n");
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 200000 );
+  Configuration config;
+  configure(config);
+
+  size_t failures ( 0 );
+  {
+    OutgoingQueue queue;
+    failures += check_many_keys(config, queue);
+  }
+
+  /* Check the slots are all released again after concurrent use, too.  */
+  {
+    OutgoingQueue queue;
+    failures += check_concurrent(config, queue, count);
+    failures += check_many_keys(config, queue);
+  }
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Outgoing queue OK.\n");
+  return 0;
+}
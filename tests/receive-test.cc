@@ -0,0 +1,190 @@
+/** @file
+ *
+ * Receive-path test.  Writes a stream of MODULE_CONTROL messages to a slave node over TCP
+ * loopback in randomly-sized pieces -- with a corrupt message and some garbage (each followed
+ * by a SYNC message) thrown in -- and checks that every intact message arrives with the right
+ * contents, and that the node's metrics count the damage.  Every other message is stamped
+ * (see `Message::Stamp`), with one sequence number skipped, to exercise the node's stamp
+ * parsing and loss accounting.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/write.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef BasicNode<boost::asio::ip::tcp> Node;
+
+static void
+append(std::string& stream, const Message& m)
+{
+  Message::Segment segments[Message::MaxSegments];
+  size_t n ( m.get_segments(segments) );
+  for ( size_t i ( 0 ); i < n; ++i )
+    stream.append(static_cast<const char*>(segments[i].data), segments[i].length);
+}
+
+/** Append a message to a stream as a node sending stamped messages would. */
+static void
+append_stamped(std::string& stream, const Message& m, uint32_t sequence)
+{
+  Message::Header header { static_cast<uint16_t>(m.header.length + sizeof(Message::Stamp)),
+                           static_cast<MessageType>(static_cast<uint8_t>(m.header.type) | Message::StampedFlag) };
+  Message::Stamp stamp { sequence, 0, 0 };
+  stream.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream.append(reinterpret_cast<const char*>(&stamp), sizeof(stamp));
+
+  std::string plain;
+  append(plain, m);
+  stream.append(plain, sizeof(Message::Header), std::string::npos);
+}
+
+int
+main(int argc, char* argv[])
+{
+  unsigned int seed ( argc > 1 ? strtoul(argv[1], NULL, 0) : 0x5EED );
+  std::mt19937 rng ( seed );
+
+  using namespace crisp::comms::keywords;
+  namespace ip = boost::asio::ip;
+
+  boost::asio::io_service service;
+  ip::tcp::acceptor acceptor ( service, ip::tcp::endpoint(ip::address_v4::loopback(), 0) );
+  ip::tcp::socket writer ( service ), slave_socket ( service );
+  writer.connect(acceptor.local_endpoint());
+  acceptor.accept(slave_socket);
+
+  Node slave ( std::move(slave_socket), NodeRole::SLAVE );
+  slave.configuration.add_module( "drive", 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_input<int8_t>({ "turn", { _neutral = 0, _minimum = -127, _maximum = 127 } });
+
+  /* Build the stream, remembering which speed values should arrive. */
+  static constexpr int count ( 2000 );
+  std::string stream;
+  std::vector<int8_t> expected;
+  const Message sync ( MessageType::SYNC );
+  uint32_t sequence ( 0 );
+  size_t num_stamped ( 0 ), num_garbage_bytes ( 0 );
+
+  for ( int i ( 0 ); i < count; ++i )
+    {
+      int8_t speed ( static_cast<int8_t>(i % 255 - 127) );
+      ModuleControl control ( &slave.configuration.modules[0] );
+      control.set<int8_t>("speed", speed);
+      control.set<int8_t>("turn", -20);
+      Message m ( std::move(control) );
+
+      if ( i % 500 == 250 )
+        {                       /* Corrupt the checksum. */
+          std::string bad;
+          append(bad, m);
+          bad.back() ^= 0x5A;
+          stream += bad;
+          num_garbage_bytes += bad.size();
+          append(stream, sync);
+        }
+      else if ( i % 500 == 449 )
+        {                       /* Garbage with an invalid message type.  (Not at the very
+                                   end, so that once the last message has arrived, all the
+                                   damage has been counted.)  */
+          stream += std::string("\x10\x00\xEE garbage", 11);
+          num_garbage_bytes += 11;
+          append(stream, sync);
+        }
+      else if ( i % 2 )
+        {
+          /* Skip a sequence number once, as if a message had been lost.  */
+          sequence += i == count / 2 + 1 ? 2 : 1;
+          append_stamped(stream, m, sequence);
+          expected.push_back(speed);
+          ++num_stamped;
+        }
+      else
+        {
+          append(stream, m);
+          expected.push_back(speed);
+        }
+    }
+
+  std::mutex received_mutex;
+  std::vector<int8_t> received;
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl& control)
+     {
+       for ( const ModuleControl::ValuePair& pair : control.values )
+         if ( pair.input->input_id == 0 )
+           {
+             std::unique_lock<std::mutex> lock ( received_mutex );
+             received.push_back(pair.value.get<int8_t>());
+           }
+     });
+  slave.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  slave.dispatcher.handshake.sent.clear();
+
+  slave.launch();
+
+  /* Write the stream in randomly-sized pieces, pausing now and then so that reads see
+     partial messages.  */
+  for ( size_t offset ( 0 ); offset < stream.size(); )
+    {
+      size_t n ( std::min<size_t>(1 + rng() % 64, stream.size() - offset) );
+      boost::asio::write(writer, boost::asio::buffer(stream.data() + offset, n));
+      offset += n;
+      if ( rng() % 16 == 0 )
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+  for ( int i ( 0 ); i < 200; ++i )
+    {
+      {
+        std::unique_lock<std::mutex> lock ( received_mutex );
+        if ( received.size() >= expected.size() )
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+  slave.halt();
+
+  /* Dispatch may reorder messages, so compare the sorted sequences. */
+  std::sort(received.begin(), received.end());
+  std::sort(expected.begin(), expected.end());
+  if ( received != expected )
+    {
+      fprintf(stderr, "FAIL: expected %zu messages, received %zu (or contents differ)\n",
+              expected.size(), received.size());
+      return 1;
+    }
+
+  /* Each corrupt message and each piece of garbage should have been counted once -- and
+     discarded, byte for byte -- and the skipped sequence number counted as one lost
+     message.  */
+  NodeMetrics::Snapshot metrics ( slave.get_metrics() );
+  const size_t num_corrupt ( count / 500 );
+  const NodeMetrics::StampCounts& stamps ( metrics.stamps[static_cast<size_t>(MessageType::MODULE_CONTROL)] );
+  if ( metrics.checksum_failures != num_corrupt || metrics.decode_errors != num_corrupt ||
+       metrics.resyncs != 2 * num_corrupt || metrics.discarded_bytes != num_garbage_bytes ||
+       metrics.incoming[static_cast<size_t>(MessageType::MODULE_CONTROL)].messages != expected.size() ||
+       stamps.received != num_stamped || stamps.lost != 1 || stamps.reordered != 0 )
+    {
+      fprintf(stderr, "FAIL: unexpected metrics:\n");
+      metrics.print(stderr, "    ");
+      return 1;
+    }
+
+  fprintf(stderr, "All %zu intact messages received.\n", expected.size());
+  return 0;
+}
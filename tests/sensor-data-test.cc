@@ -0,0 +1,273 @@
+/** @file
+ *
+ * Sensor-data test.  Checks that batches of sensor samples survive encoding and decoding,
+ * that a batch refuses samples it cannot represent, and that a slave node can stream batches
+ * to a master node over TCP loopback, which decodes them against the configuration it fetched
+ * from the slave.
+ */
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#include <crisp/comms/SensorData.hh>
+#include "node-pair.hh"
+
+using namespace crisp::comms;
+
+static void
+configure(Configuration& config)
+{
+  using namespace crisp::comms::keywords;
+  config.add_module( "drive", 1, 2 )
+    .add_input<int8_t>({ "speed", { _neutral = 0, _minimum = -127, _maximum = 127 } })
+    .add_sensor<uint16_t>({ "front proximity", SensorType::PROXIMITY, { _minimum = 50, _maximum = 500 } })
+    .add_sensor<int32_t>({ "left encoder", SensorType::ROTARY_ENCODER, { } });
+  config.add_module( "arm", 1, 1 )
+    .add_input<float>({ "joint0", { _minimum = -1.5, _maximum = 1.5 } })
+    .add_sensor<float>({ "joint0 position", SensorType::ROTARY_ENCODER, { } });
+}
+
+/** Fill a batch with interleaved runs of samples from every sensor in the configuration.
+ *
+ * @return Number of samples added.
+ */
+static size_t
+fill(SensorData& data, const Configuration& config, uint64_t base, size_t per_sensor)
+{
+  const Module& drive ( config.modules[0] );
+  const Module& arm ( config.modules[1] );
+  size_t added ( 0 );
+  for ( size_t i ( 0 ); i < per_sensor; ++i )
+    {
+      uint64_t t ( base + 1000 * i );
+      added += data.add(drive, drive.sensors[0], t, static_cast<uint16_t>(50 + i));
+      added += data.add(drive, drive.sensors[1], t + 1, static_cast<int32_t>(-i));
+      added += data.add(arm, arm.sensors[0], t + 2, 0.01f * i);
+    }
+  return added;
+}
+
+static size_t
+check_codec(const Configuration& config)
+{
+  size_t failures ( 0 );
+
+  SensorData data ( 1000000 );
+  size_t added ( fill(data, config, 1000000, 100) );
+  Message m ( data );
+  SensorData decoded ( m.as<SensorData>(config) );
+
+  fprintf(stderr, "codec:    %zu samples in %zu bytes\n", decoded.samples.size(), m.body->length);
+  if ( added != 300 || ! (decoded == data) || m.body->length != data.get_encoded_size() )
+    {
+      fprintf(stderr, "FAIL: batch did not survive encoding\n");
+      ++failures;
+    }
+  else if ( decoded.get<int32_t>(decoded.samples[1]) != 0 || decoded.get<float>(decoded.samples[299]) != 0.01f * 99 ||
+            decoded.samples[299].timestamp != 1000000 + 99000 + 2 || decoded.samples[299].module_id != 1 )
+    {
+      fprintf(stderr, "FAIL: decoded sample values are wrong\n");
+      ++failures;
+    }
+
+  /* Samples from one sensor share a single run header. */
+  SensorData runs ( 0 );
+  const Module& drive ( config.modules[0] );
+  for ( uint16_t i ( 0 ); i < 100; ++i )
+    runs.add(drive, drive.sensors[0], i, i);
+  if ( runs.get_encoded_size() != SensorData::HeaderSize + SensorData::RunHeaderSize + 100 * (4 + 2) )
+    {
+      fprintf(stderr, "FAIL: samples of one sensor were not batched into one run\n");
+      ++failures;
+    }
+
+  /* Samples that can't be represented are refused. */
+  SensorData edge ( 5000 );
+  if ( edge.add(drive, drive.sensors[0], 4999, uint16_t(1)) ||
+       edge.add(drive, drive.sensors[0], 5000 + (uint64_t(1) << 32), uint16_t(1)) ||
+       edge.add(drive, drive.sensors[0], 5000, 1.0) )
+    {
+      fprintf(stderr, "FAIL: batch accepted an unrepresentable sample\n");
+      ++failures;
+    }
+
+  size_t n ( 0 );
+  while ( edge.add(drive, drive.sensors[0], 5000 + n, uint16_t(n)) )
+    ++n;
+  if ( edge.get_encoded_size() > SensorData::MaxEncodedSize || edge.has_room_for(0, drive.sensors[0]) ||
+       Message(edge).as<SensorData>(config).samples.size() != n )
+    {
+      fprintf(stderr, "FAIL: full batch (%zu samples) mishandled\n", n);
+      ++failures;
+    }
+
+  /* A batch naming an unknown sensor doesn't decode. */
+  Configuration other;
+  other.add_module( "drive", 1 )
+    .add_input<int8_t>({ "speed", { } });
+  if ( ! m.as<SensorData>(other).samples.empty() )
+    {
+      fprintf(stderr, "FAIL: batch decoded against the wrong configuration\n");
+      ++failures;
+    }
+
+  return failures;
+}
+
+static size_t
+check_nodes(size_t batches)
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  configure(slave.configuration);
+  configure(master.configuration);
+
+  size_t failures ( 0 );
+  std::atomic<size_t> samples ( 0 ), received ( 0 );
+  std::mutex mutex;
+  Waiter waiter;
+  uint64_t last_timestamp ( 0 );
+
+  /* Handlers run in the receive loop, so batches are seen in the order they arrive. */
+  master.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  master.dispatcher.sensor_data.received.connect
+    ([&](Node&, const SensorData& data)
+     {
+       std::unique_lock<std::mutex> lock ( mutex );
+       for ( const SensorData::Sample& sample : data.samples )
+         if ( sample.sensor->id == 1 && sample.module_id == 0 )
+           {
+             if ( sample.timestamp <= last_timestamp && failures++ < 10 )
+               fprintf(stderr, "FAIL: encoder samples out of order\n");
+             last_timestamp = sample.timestamp;
+           }
+       samples += data.samples.size();
+       ++received;
+       waiter.notify();
+     });
+
+  nodes.launch();
+
+  SensorData data;
+  size_t sent ( 0 );
+  for ( size_t i ( 0 ); i < batches; ++i )
+    {
+      uint64_t base ( 1000000 + 100000 * i );
+      data.clear(base);
+      sent += fill(data, slave.configuration, base, 100);
+      slave.send(data);
+    }
+
+  waiter.wait([&]() { return received >= batches; });
+  nodes.halt();
+
+  NodeMetrics::Snapshot metrics ( master.get_metrics() );
+  const NodeMetrics::Counts& counts ( metrics.incoming[static_cast<size_t>(MessageType::SENSOR_DATA)] );
+  fprintf(stderr, "nodes:    master received %zu of %zu samples in %" PRIu64 " messages (%" PRIu64 " bytes)\n",
+          samples.load(), sent, counts.messages, counts.bytes);
+  if ( received != batches || samples != sent || metrics.decode_errors )
+    {
+      fprintf(stderr, "FAIL: sensor data lost\n");
+      ++failures;
+    }
+  return failures;
+}
+
+/** Check that a master that fetched the slave's configuration decodes sensor data against
+ * that, not against its own `configuration` (which user code may replace at any time), and
+ * that the batches it passes to handlers keep the configuration alive.
+ */
+static size_t
+check_remote_configuration(size_t batches)
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  configure(slave.configuration);
+
+  std::atomic<bool> configured ( false );
+  std::atomic<size_t> samples ( 0 ), received ( 0 ), dangling ( 0 );
+  Waiter waiter;
+  master.dispatcher.configuration_response.received.clear();
+  master.dispatcher.configuration_response.received.connect
+    ([&](Node& node, const Configuration&)
+     {
+       /* Leave the master's own configuration empty.  */
+       node.configuration = Configuration();
+       configured = true;
+       waiter.notify();
+     });
+  master.dispatcher.sensor_data.received.connect
+    ([&](Node&, const SensorData& data)
+     {
+       for ( const SensorData::Sample& sample : data.samples )
+         {
+           const Configuration* config ( data.configuration.get() );
+           if ( ! config || sample.module_id >= config->num_modules )
+             ++dangling;
+           else
+             {
+               const Module& module ( config->modules[sample.module_id] );
+               if ( sample.sensor < &module.sensors[0] || sample.sensor >= &module.sensors[0] + module.num_sensors )
+                 ++dangling;
+             }
+         }
+       samples += data.samples.size();
+       ++received;
+       waiter.notify();
+     });
+
+  nodes.launch();
+  master.request_configuration();
+  waiter.wait([&]() { return configured.load(); });
+
+  SensorData data;
+  size_t sent ( 0 );
+  for ( size_t i ( 0 ); i < batches; ++i )
+    {
+      uint64_t base ( 1000000 + 100000 * i );
+      data.clear(base);
+      sent += fill(data, slave.configuration, base, 10);
+      slave.send(data);
+    }
+
+  waiter.wait([&]() { return received >= batches; });
+  nodes.halt();
+
+  fprintf(stderr, "remote:   master received %zu of %zu samples against the slave's configuration\n",
+          samples.load(), sent);
+  size_t failures ( 0 );
+  if ( ! configured || received != batches || samples != sent || dangling )
+    {
+      fprintf(stderr, "FAIL: sensor data not decoded against the remote configuration (%zu stray sensors)\n",
+              dangling.load());
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t batches ( argc > 1 ? strtoul(argv[1], NULL, 0) : 200 );
+
+  Configuration config;
+  configure(config);
+
+  size_t failures ( 0 );
+  failures += check_codec(config);
+  failures += check_nodes(batches);
+  failures += check_remote_configuration(batches);
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Sensor data OK.\n");
+  return 0;
+}
@@ -0,0 +1,258 @@
+/** @file
+ *
+ * Sensor-history test.  Checks that HistoryRing readers never see torn or out-of-order items
+ * while the writer laps them, that SensorSeries decimates readings correctly, that
+ * SensorHistory records only configured sensors, and that a master node records the sensor
+ * data a slave streams to it.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <crisp/comms/SensorHistory.hh>
+#include <crisp/util/HistoryRing.hh>
+#include "node-pair.hh"
+
+using namespace crisp::comms;
+
+struct Item
+{
+  uint64_t index;
+  uint64_t check;
+  uint64_t pad[2];
+};
+
+static inline uint64_t
+check_for(uint64_t index)
+{ return index * 0x9E3779B97F4A7C15ull; }
+
+static size_t
+check_ring(size_t count)
+{
+  crisp::util::HistoryRing<Item> ring ( 64 );
+  std::atomic<bool> done ( false );
+  std::atomic<size_t> failures ( 0 ), reads ( 0 );
+
+  std::vector<std::thread> readers;
+  for ( size_t r ( 0 ); r < 3; ++r )
+    readers.emplace_back
+      ([&]()
+       {
+         std::vector<Item> items;
+         while ( ! done )
+           {
+             uint64_t first ( ring.read(0, items) );
+             for ( size_t i ( 0 ); i < items.size(); ++i )
+               if ( items[i].index != first + i || items[i].check != check_for(items[i].index) )
+                 {
+                   if ( failures++ < 10 )
+                     fprintf(stderr, "FAIL: torn or misplaced item %llu at %llu\n",
+                             static_cast<unsigned long long>(items[i].index),
+                             static_cast<unsigned long long>(first + i));
+                   break;
+                 }
+             ++reads;
+           }
+       });
+
+  for ( uint64_t i ( 0 ); i < count; ++i )
+    ring.push({ i, check_for(i), { } });
+  done = true;
+  for ( std::thread& t : readers )
+    t.join();
+
+  Item last;
+  if ( ring.end() != count || ! ring.get(count - 1, last) || last.index != count - 1 ||
+       ring.get(count - 65, last) || ring.begin() != count - 64 )
+    {
+      fprintf(stderr, "FAIL: ring bounds wrong after %zu pushes\n", count);
+      ++failures;
+    }
+
+  fprintf(stderr, "ring:     %zu pushes, %zu concurrent reads\n", count, reads.load());
+  return failures;
+}
+
+static size_t
+check_series()
+{
+  size_t failures ( 0 );
+  Sensor<> sensor ( Sensor<int16_t>("encoder", SensorType::ROTARY_ENCODER, { }) );
+  SensorSeries series ( 0, sensor, 1000 );
+
+  /* Readings cycle through -25..24, one per millisecond. */
+  for ( int i ( 0 ); i < 1000; ++i )
+    {
+      int16_t v ( i % 50 - 25 );
+      series.record(1000000 + 1000 * i, reinterpret_cast<const uint8_t*>(&v));
+    }
+
+  std::vector<SensorSample> raw;
+  std::vector<SensorSummary> tens, hundreds, last;
+  series.read(0, raw);
+  series.read(HistoryResolution::DECIMATED_10, 0, tens);
+  series.read(HistoryResolution::DECIMATED_100, 0, hundreds);
+  series.read_last(HistoryResolution::RAW, 99000, last);
+
+  fprintf(stderr, "series:   %zu raw, %zu x10, %zu x100, %zu in the last 99 ms\n",
+          raw.size(), tens.size(), hundreds.size(), last.size());
+  if ( raw.size() != 1000 || tens.size() != 100 || hundreds.size() != 10 || last.size() != 100 )
+    {
+      fprintf(stderr, "FAIL: wrong number of entries\n");
+      return 1;
+    }
+
+  /* The first ten readings are -25..-16; each hundred covers the whole cycle twice. */
+  if ( raw[999].value != 24 || raw[999].timestamp != 1000000 + 999000 ||
+       tens[0].minimum != -25 || tens[0].maximum != -16 || tens[0].mean != -20.5 || tens[0].count != 10 ||
+       tens[1].timestamp != 1010000 ||
+       hundreds[3].minimum != -25 || hundreds[3].maximum != 24 || hundreds[3].mean != -0.5 ||
+       hundreds[3].count != 100 || hundreds[3].timestamp != 1300000 )
+    {
+      fprintf(stderr, "FAIL: wrong summaries\n");
+      ++failures;
+    }
+
+  series.read(HistoryResolution::DECIMATED_10, 1500000, tens);
+  if ( tens.size() != 50 || tens[0].timestamp != 1500000 )
+    {
+      fprintf(stderr, "FAIL: time query returned %zu summaries\n", tens.size());
+      ++failures;
+    }
+
+  /* A reading older than the newest (as from a reordered datagram) is dropped.  */
+  int16_t late ( 100 );
+  series.record(1000000 + 998500, reinterpret_cast<const uint8_t*>(&late));
+  series.read(1000000 + 998000, raw);
+  if ( raw.size() != 2 || raw[1].value != 24 || series.latest_timestamp() != 1000000 + 999000 )
+    {
+      fprintf(stderr, "FAIL: out-of-order reading was recorded\n");
+      ++failures;
+    }
+
+  if ( ! SensorSeries::can_record(DataDeclaration<>(DataDeclaration<float>())) ||
+       SensorSeries::can_record(DataDeclaration<>()) )
+    {
+      fprintf(stderr, "FAIL: wrong recordable types\n");
+      ++failures;
+    }
+  return failures;
+}
+
+static size_t
+check_history()
+{
+  Configuration config;
+  config.add_module( "drive", 0, 1 )
+    .add_sensor<int32_t>({ "left encoder", SensorType::ROTARY_ENCODER, { } });
+  const Module& drive ( config.modules[0] );
+
+  SensorData data;
+  data.clear(0);
+  for ( int32_t j ( 0 ); j < 100; ++j )
+    data.add(drive, drive.sensors[0], 1000 * j, j);
+
+  size_t failures ( 0 );
+  SensorHistory history ( 1000 );
+  history.record(data);
+  if ( history.find(0, 0) )
+    {
+      fprintf(stderr, "FAIL: unconfigured sensor has a series\n");
+      ++failures;
+    }
+
+  history.configure(config);
+  history.record(data);
+  std::shared_ptr<const SensorSeries> series ( history.find(0, 0) );
+  std::vector<SensorSample> samples;
+  if ( ! series || series->read(0, samples) != 100 || history.find(0, 1) )
+    {
+      fprintf(stderr, "FAIL: configured sensor's readings were not recorded\n");
+      ++failures;
+    }
+
+  history.configure(config);
+  if ( history.find(0, 0) != series )
+    {
+      fprintf(stderr, "FAIL: reconfiguring replaced an unchanged sensor's series\n");
+      ++failures;
+    }
+
+  history.clear();
+  series = history.find(0, 0);
+  if ( ! series || series->read(0, samples) != 0 )
+    {
+      fprintf(stderr, "FAIL: clear did not leave an empty series\n");
+      ++failures;
+    }
+  return failures;
+}
+
+static size_t
+check_nodes(size_t batches)
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  for ( Configuration* config : { &slave.configuration, &master.configuration } )
+    config->add_module( "drive", 0, 1 )
+      .add_sensor<int32_t>({ "left encoder", SensorType::ROTARY_ENCODER, { } });
+
+  std::atomic<size_t> received ( 0 );
+  Waiter waiter;
+  master.dispatcher.sensor_data.received.connect
+    ([&](Node&, const SensorData&) { ++received; waiter.notify(); });
+
+  master.keep_sensor_history(100000);
+  nodes.launch();
+
+  const Module& drive ( slave.configuration.modules[0] );
+  SensorData data;
+  for ( size_t i ( 0 ); i < batches; ++i )
+    {
+      data.clear(1000 * 100 * i);
+      for ( int32_t j ( 0 ); j < 100; ++j )
+        data.add(drive, drive.sensors[0], 1000 * (100 * i + j), static_cast<int32_t>(100 * i + j));
+      slave.send(data);
+    }
+
+  waiter.wait([&]() { return received >= batches; });
+  nodes.halt();
+
+  size_t failures ( 0 );
+  std::shared_ptr<const SensorSeries> series ( master.get_sensor_history()->find(0, 0) );
+  std::vector<SensorSummary> hundreds;
+  if ( series )
+    series->read(HistoryResolution::DECIMATED_100, 0, hundreds);
+  fprintf(stderr, "nodes:    master recorded %zu x100 summaries\n", hundreds.size());
+  if ( ! series || hundreds.size() != batches || hundreds.back().maximum != 100 * batches - 1 ||
+       slave.get_sensor_history() != nullptr )
+    {
+      fprintf(stderr, "FAIL: master did not record the slave's sensor data\n");
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000 );
+
+  size_t failures ( 0 );
+  failures += check_ring(count);
+  failures += check_series();
+  failures += check_history();
+  failures += check_nodes(100);
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Sensor history OK.\n");
+  return 0;
+}
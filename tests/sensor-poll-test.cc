@@ -0,0 +1,201 @@
+/** @file
+ *
+ * Sensor-poll test.  Checks SensorPoll encoding, that a slave answers a poll of many sensors
+ * with a single batch of readings, and that a master polls sensors at their own rates.
+ */
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <crisp/comms/SensorPoll.hh>
+#include "node-pair.hh"
+
+using namespace crisp::comms;
+
+static const size_t SensorsPerModule ( 20 );
+static char sensor_names[SensorsPerModule][8];
+
+/** Declare two modules of polled proximity sensors. */
+static void
+configure(Configuration& config)
+{
+  for ( size_t i ( 0 ); i < SensorsPerModule; ++i )
+    snprintf(sensor_names[i], sizeof(sensor_names[i]), "prox%zu", i);
+
+  for ( const char* name : { "front", "rear" } )
+    {
+      Module& module ( config.add_module( name, 0, SensorsPerModule ) );
+      for ( size_t i ( 0 ); i < SensorsPerModule; ++i )
+        module.add_sensor<uint16_t>({ sensor_names[i], SensorType::PROXIMITY, { }, SensorReportingMode::POLL });
+    }
+}
+
+static size_t
+check_codec()
+{
+  size_t failures ( 0 );
+
+  SensorPoll poll;
+  for ( uint16_t i ( 0 ); i < 40; i += 3 )
+    poll.add(2, i).add(0, i / 2);
+  poll.add(7, 255).add(2, 3);
+
+  std::vector<uint32_t> seen;
+  poll.for_each([&](uint8_t module_id, uint16_t sensor_id) { seen.push_back(module_id << 16 | sensor_id); });
+
+  Message m ( poll );
+  SensorPoll decoded ( m.as<SensorPoll>() );
+  fprintf(stderr, "codec:    %zu sensors in %zu bytes\n", decoded.size(), m.body->length);
+  if ( ! (decoded == poll) || poll.size() != 14 + 14 + 1 || seen.size() != poll.size() ||
+       m.body->length != 2 + 3 + 2 + 5 + 2 + 32 )
+    {
+      fprintf(stderr, "FAIL: poll did not survive encoding\n");
+      ++failures;
+    }
+  for ( size_t i ( 1 ); i < seen.size(); ++i )
+    if ( seen[i] <= seen[i - 1] )
+      {
+        fprintf(stderr, "FAIL: polled sensors not visited in order\n");
+        ++failures;
+        break;
+      }
+
+  poll.remove(7, 255).remove(2, 39).remove(2, 100);
+  if ( poll.contains(7, 255) || poll.contains(2, 39) || ! poll.contains(2, 36) || poll.modules.size() != 2 ||
+       poll.modules[1].length != 5 )
+    {
+      fprintf(stderr, "FAIL: sensors not removed from poll\n");
+      ++failures;
+    }
+
+  return failures;
+}
+
+static size_t
+check_nodes()
+{
+  NodePair nodes;
+  Node& slave ( nodes.slave );
+  Node& master ( nodes.master );
+  configure(slave.configuration);
+  configure(master.configuration);
+
+  /* Each sensor reads as its module and sensor IDs. */
+  for ( size_t m ( 0 ); m < slave.configuration.num_modules; ++m )
+    for ( size_t s ( 0 ); s < SensorsPerModule; ++s )
+      {
+        uint16_t reading ( m << 8 | s );
+        slave.dispatcher.sensor_readers.set<uint16_t>(slave.configuration.modules[m], slave.configuration.modules[m].sensors[s],
+                                                      [reading]() { return reading; });
+      }
+
+  size_t failures ( 0 );
+  std::mutex mutex;
+  std::vector<size_t> batch_sizes;
+  std::atomic<size_t> front_batches ( 0 ), rear_batches ( 0 );
+  Waiter waiter;
+  master.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  master.dispatcher.sensor_data.received.connect
+    ([&](Node&, const SensorData& data)
+     {
+       std::unique_lock<std::mutex> lock ( mutex );
+       batch_sizes.push_back(data.samples.size());
+       for ( const SensorData::Sample& sample : data.samples )
+         if ( data.get<uint16_t>(sample) != (sample.module_id << 8 | sample.sensor->id) && failures++ < 10 )
+           fprintf(stderr, "FAIL: wrong reading for sensor %u/%u\n", sample.module_id, sample.sensor->id);
+       if ( ! data.samples.empty() )
+         ++(data.samples[0].module_id == 0 ? front_batches : rear_batches);
+       waiter.notify();
+     });
+
+  nodes.launch();
+
+  /* A single poll of every sensor gets a single answer. */
+  SensorPoll all;
+  for ( size_t m ( 0 ); m < 2; ++m )
+    for ( size_t s ( 0 ); s < SensorsPerModule; ++s )
+      all.add(m, s);
+  master.send(all);
+  waiter.wait([&]() { return front_batches + rear_batches > 0; });
+
+  {
+    std::unique_lock<std::mutex> lock ( mutex );
+    fprintf(stderr, "poll:     %zu sensors polled, %zu batch(es) received\n", all.size(), batch_sizes.size());
+    if ( batch_sizes.size() != 1 || batch_sizes[0] != 2 * SensorsPerModule )
+      {
+        fprintf(stderr, "FAIL: poll not answered with a single batch\n");
+        ++failures;
+      }
+    batch_sizes.clear();
+    front_batches = rear_batches = 0;
+  }
+
+  /* Poll each module's sensors at a different rate, counting the batches received in a
+     fixed period.  */
+  using namespace crisp::util::literals;
+  for ( size_t s ( 0 ); s < SensorsPerModule; ++s )
+    {
+      master.poll_sensor(0, s, 50_Hz);
+      master.poll_sensor(1, s, 10_Hz);
+    }
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+  /* Polls sent while the sensors are being removed cover only some of them, so batches
+     received after this point may be smaller.  */
+  size_t complete_batches;
+  {
+    std::unique_lock<std::mutex> lock ( mutex );
+    complete_batches = batch_sizes.size();
+  }
+  for ( size_t s ( 0 ); s < SensorsPerModule; ++s )
+    {
+      master.stop_polling(0, s);
+      master.stop_polling(1, s);
+    }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  size_t front ( front_batches ), rear ( rear_batches );
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  nodes.halt();
+
+  NodeMetrics::Snapshot metrics ( master.get_metrics() );
+  fprintf(stderr, "schedule: %zu front batches at 50 Hz, %zu rear batches at 10 Hz; %" PRIu64 " polls sent\n",
+          front, rear, metrics.outgoing[static_cast<size_t>(MessageType::SENSOR_POLL)].messages);
+  std::unique_lock<std::mutex> lock ( mutex );
+  for ( size_t i ( 0 ); i < batch_sizes.size(); ++i )
+    if ( i < complete_batches ? batch_sizes[i] != SensorsPerModule
+                              : batch_sizes[i] == 0 || batch_sizes[i] > SensorsPerModule )
+      {
+        fprintf(stderr, "FAIL: scheduled poll answered with %zu readings\n", batch_sizes[i]);
+        ++failures;
+        break;
+      }
+  if ( front < 15 || front > 30 || rear < 3 || rear > 7 || front_batches != front || rear_batches != rear )
+    {
+      fprintf(stderr, "FAIL: sensors not polled at their rates\n");
+      ++failures;
+    }
+  return failures;
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t failures ( 0 );
+  failures += check_codec();
+  failures += check_nodes();
+
+  if ( failures )
+    {
+      fprintf(stderr, "%zu failures\n", failures);
+      return 1;
+    }
+
+  fprintf(stderr, "Sensor poll OK.\n");
+  return 0;
+}
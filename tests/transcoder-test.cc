@@ -1,3 +1,4 @@
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <cassert>
@@ -152,6 +153,17 @@ test_message_encode(const _T& x, _Args&&... args)
   for ( size_t i = 0; i < eb.offset; ++i )
     fprintf(stderr, " %02hhX", eb[i]);
   fprintf(stderr, "\n");
+
+  /* The scatter-gather view of the message must match its monolithic encoding. */
+  Message::Segment segments[Message::MaxSegments];
+  size_t num_segments ( m.get_segments(segments) ), segments_offset ( 0 );
+  for ( size_t i = 0; i < num_segments; ++i )
+    {
+      assert(segments_offset + segments[i].length <= eb.offset);
+      assert(! memcmp(eb.data + segments_offset, segments[i].data, segments[i].length));
+      segments_offset += segments[i].length;
+    }
+  assert(segments_offset == eb.offset);
   
   DecodeBuffer db ( eb.buffer );
   Message dm ( Message::decode(db) );
@@ -221,6 +233,8 @@ main(int, char*[])
   fprintf(stderr, "iids %d, speed %d, turn %d\n", ctd.input_ids, ctd.get<int8_t>("speed"), ctd.get<int8_t>("turn"));
   assert(ctd.get<int8_t>("turn") == 3);
   assert(ctd.get<int8_t>("speed") == 127);
+  assert(ctd.get_num_values() == 2 && ctd.values.size == 2 &&
+         ctd.values[0].input->input_id < ctd.values[1].input->input_id);
 
   test_encode(ctd, config);
   
@@ -237,6 +251,32 @@ main(int, char*[])
 
   test_encode(Handshake(0, NodeRole::MASTER));
 
+  /* Handshakes from older nodes lack trailing fields; anything shorter is an error.  */
+  {
+    Handshake full ( 1, NodeRole::SLAVE, Handshake::FEATURE_COMPACT_CONTROL, 0x12345678 ), hs;
+    char bytes[sizeof(Handshake)];
+    memcpy(bytes, &full, sizeof(full));
+    char* data ( bytes );
+    size_t length ( offsetof(Handshake, features) );
+    DecodeBuffer old_db ( data, length );
+    DecodeResult dr ( hs.decode(old_db) );
+    assert(dr == DecodeResult::SUCCESS && hs.version == 1 && hs.role == NodeRole::SLAVE &&
+           hs.features == 0 && hs.configuration_digest == 0);
+
+    /* Older nodes may also send padding after `role`, holding anything.  */
+    memset(bytes + length, 0xFF, 3);
+    DecodeBuffer padded_db ( data, length + 3 );
+    dr = hs.decode(padded_db);
+    assert(dr == DecodeResult::SUCCESS && hs.version == 1 && hs.role == NodeRole::SLAVE &&
+           hs.features == 0 && hs.configuration_digest == 0);
+
+    size_t short_length ( length - 1 );
+    DecodeBuffer short_db ( data, short_length );
+    dr = hs.decode(short_db);
+    assert(dr == DecodeResult::BUFFER_UNDERFLOW && short_db.offset == 0);
+    (void) dr;
+  }
+
   MemoryEncodeBuffer eb ( 7 );
   Message::encode(eb, MessageType::SYNC);
   fprintf(stderr, "\n"
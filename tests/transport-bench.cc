@@ -0,0 +1,127 @@
+/** @file
+ *
+ * Transport benchmark: compares MODULE_CONTROL throughput and one-way latency between a
+ * master and a slave node connected over TCP loopback and over a UNIX-domain stream socket.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/local/stream_protocol.hpp>
+#include <crisp/comms/BasicNode.hh>
+#include <crisp/comms/ModuleControl.hh>
+
+using namespace crisp::comms;
+typedef std::chrono::steady_clock Clock;
+
+template < typename _Protocol >
+static void
+run(const char* label, const typename _Protocol::endpoint& listen_endpoint, size_t count)
+{
+  using namespace crisp::comms::keywords;
+  typedef BasicNode<_Protocol> Node;
+
+  /* Each node gets its own io_service so that neither can starve the other's worker pool. */
+  boost::asio::io_service master_service, slave_service;
+  typename _Protocol::acceptor acceptor ( slave_service, listen_endpoint );
+  typename _Protocol::socket master_socket ( master_service ), slave_socket ( slave_service );
+  master_socket.connect(acceptor.local_endpoint());
+  acceptor.accept(slave_socket);
+
+  Node
+    slave ( std::move(slave_socket), NodeRole::SLAVE ),
+    master ( std::move(master_socket), NodeRole::MASTER );
+
+  slave.configuration.add_module( "drive", 1 )
+    .template add_input<uint32_t>({ "sequence", { _neutral = 0, _minimum = 0, _maximum = UINT32_MAX } });
+  master.configuration = slave.configuration;
+  master.set_queue_policy(MessageType::MODULE_CONTROL, QueuePolicy::FIFO);
+
+  std::atomic<size_t> received ( 0 );
+  std::atomic<int64_t> sent_at ( 0 );
+  std::vector<double> latencies;
+  latencies.reserve(count);
+  std::atomic<bool> record_latency ( false );
+
+  /* Handle messages in the receive loop, so that we measure the transport rather than the
+     worker pool.  */
+  slave.dispatcher.set_dispatch_mode(DispatchMode::SYNCHRONOUS);
+  slave.dispatcher.module_control.received.clear();
+  slave.dispatcher.module_control.received.connect
+    ([&](Node&, const ModuleControl&)
+     {
+       if ( record_latency )
+         latencies.push_back(std::chrono::duration<double, std::micro>
+                             (Clock::now().time_since_epoch() - Clock::duration(sent_at.load())).count());
+       ++received;
+     });
+  master.dispatcher.module_control.sent.clear();
+  slave.dispatcher.sync.received.clear();
+  master.dispatcher.sync.received.clear();
+  slave.dispatcher.sync.sent.clear();
+  master.dispatcher.sync.sent.clear();
+
+  slave.launch();
+  master.launch();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  ModuleControl control ( &master.configuration.modules[0] );
+  control.set<uint32_t>("sequence", 1);
+  const Message message ( std::move(control) );
+
+  /* Throughput. */
+  Clock::time_point start ( Clock::now() );
+  for ( size_t i ( 0 ); i < count; ++i )
+    master.send(message);
+  while ( received < count )
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  std::chrono::duration<double> elapsed ( Clock::now() - start );
+
+  /* Latency: one message in flight at a time. */
+  const size_t latency_count ( std::min<size_t>(count, 20000) );
+  received = 0;
+  record_latency = true;
+  for ( size_t i ( 0 ); i < latency_count; ++i )
+    {
+      sent_at = Clock::now().time_since_epoch().count();
+      master.send(message);
+      while ( received <= i )
+        std::this_thread::yield();
+    }
+  record_latency = false;
+
+  master.halt();
+  slave.halt();
+
+  std::sort(latencies.begin(), latencies.end());
+  printf("%-14s %12.0f %10.1f %10.1f %10.1f\n", label, count / elapsed.count(),
+         latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100], latencies.back());
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t count ( argc > 1 ? strtoul(argv[1], NULL, 0) : 200000 );
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  namespace ip = boost::asio::ip;
+  printf("%-14s %12s %10s %10s %10s\n", "transport", "messages/s", "p50 us", "p99 us", "max us");
+  run<ip::tcp>("TCP loopback", ip::tcp::endpoint(ip::address_v4::loopback(), 0), count);
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+  std::string path ( "/tmp/crisp-transport-bench-" + std::to_string(getpid()) + ".sock" );
+  unlink(path.c_str());
+  run<boost::asio::local::stream_protocol>("UNIX socket", boost::asio::local::stream_protocol::endpoint(path), count);
+  unlink(path.c_str());
+#endif
+
+  return 0;
+}